@@ -235,6 +235,39 @@ vector<float> nnwork::run(vector<float>& data)
     return result;
 }
 
+vector<float> nnwork::runBatch(const vector<float>& data, int count)
+{
+    vector<float> result(output_size * count, 0);
+    if (count <= 0)
+        return result;
+
+    vector<float> hiddenOutputs(hidden_size * count, 0);
+    for (int j = 0; j < hidden_size; j++) {
+        float* sums = &hiddenOutputs[j * count];
+        for (int i = 0; i < input_size; ++i) {
+            float weight = hidden_nodes->nodes[j].weights[i];
+            const float* inputs = &data[i * count];
+            for (int r = 0; r < count; ++r)
+                sums[r] += weight * inputs[r];
+        }
+        for (int r = 0; r < count; ++r)
+            sums[r] = sigmoid(sums[r]);
+    }
+
+    for (int k = 0; k < output_size; ++k) {
+        float* sums = &result[k * count];
+        for (int j = 0; j < hidden_size; ++j) {
+            float weight = output_nodes->nodes[k].weights[j];
+            const float* inputs = &hiddenOutputs[j * count];
+            for (int r = 0; r < count; ++r)
+                sums[r] += weight * inputs[r];
+        }
+        for (int r = 0; r < count; ++r)
+            sums[r] = sigmoid(sums[r]);
+    }
+    return result;
+}
+
 void nnwork::run(float data [], float result [])
 {
     int i, j, k;
@@ -68,6 +68,20 @@ public:
      */
     std::vector<float> run(std::vector<float>& data);
 
+    /**
+     * @brief Run the network over a batch of inputs in one go.
+     * @details The inputs are laid out feature by feature: the i-th value of
+     * the r-th input is expected at `data[i * count + r]`. This lets the
+     * innermost loops walk over contiguous memory, one input per iteration,
+     * so that they can be vectorized. Every output is accumulated in the same
+     * order as the single-input `run` methods, giving identical results.
+     * @param data A matrix of `count` inputs, `input_size * count` in length.
+     * @param count Number of inputs in the batch.
+     * @return A matrix of `count` outputs, `output_size * count` in length,
+     * laid out the same way as the inputs.
+     */
+    std::vector<float> runBatch(const std::vector<float>& data, int count);
+
     /**
      * @brief Legacy function that does the same thing as the other `run` method
      * except this one does update the NN.
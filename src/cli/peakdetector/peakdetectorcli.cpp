@@ -866,18 +866,22 @@ void PeakDetectorCLI::saveCSV(string setName)
                                 ddaGroupExists, includeSetNamesLine,
                                 mavenParameters);
 
+    vector<PeakGroup*> groups;
     for (int i = 0; i < mavenParameters->allgroups.size(); i++) {
         PeakGroup& group = mavenParameters->allgroups[i];
-        csvreports->addGroup(&group);
+        groups.push_back(&group);
     }
+    csvreports->addGroups(groups);
 
     if (csvreports->getErrorReport() != "") {
         _log->info() << "Writing to CSV failed with error - "
                      << csvreports->getErrorReport().toStdString()
                      << "."
                      << std::flush;
+        delete csvreports;
         return;
     }
+    delete csvreports;
 
     _log->info() << "CSV output file: " << fileName << std::flush;
 
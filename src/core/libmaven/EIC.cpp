@@ -1,3 +1,6 @@
+#include <numeric>
+#include <omp.h>
+
 #include "datastructures/adduct.h"
 #include "datastructures/mzSlice.h"
 #include "EIC.h"
@@ -52,7 +55,74 @@ EIC::~EIC()
     peaks.clear();
 }
 
-EIC *EIC::eicMerge(const vector<EIC *> &eics)
+/**
+ * @brief Add the points of EICs that fall within a range of bins of their
+ * merged EIC to the sums of those bins, in the order of EICs and then of
+ * their scans.
+ * @param weights Weight of each EIC's intensities. Empty if intensities are
+ * not weighted.
+ * @param rtSorted Whether the retention times of each EIC are sorted, in
+ * which case only its points within the range are visited. Empty if all
+ * points are to be visited.
+ */
+void _mergeBins(const vector<EIC *> &eics,
+                const vector<float> &weights,
+                const vector<char> &rtSorted,
+                float minRt,
+                float maxRt,
+                unsigned int maxlen,
+                unsigned int binMin,
+                unsigned int binMax,
+                float *intensity,
+                float *mz,
+                int *mzcount)
+{
+    auto binOf = [minRt, maxRt, maxlen](float time) {
+        unsigned int bin = ((time - minRt) / (maxRt - minRt) * maxlen);
+        return bin >= maxlen ? maxlen - 1 : bin;
+    };
+    bool wholeRange = binMin == 0 && binMax == maxlen;
+    for (unsigned int i = 0; i < eics.size(); i++)
+    {
+        EIC *e = eics[i];
+        const float *rt = e->rt.data();
+        const float *y = e->intensity.data();
+        const float *eicMz = e->mz.data();
+        const float *spline = e->spline;
+        bool weighted = !weights.empty();
+        float weight = weighted ? weights[i] : 1.0f;
+
+        // bins grow along with retention times, so the points of a sorted
+        // EIC falling in the range are found by bisection
+        unsigned int first = 0;
+        unsigned int last = e->size();
+        if (!rtSorted.empty() && rtSorted[i]) {
+            first = partition_point(rt, rt + last, [&](float time) {
+                        return binOf(time) < binMin;
+                    }) - rt;
+            last = partition_point(rt + first, rt + last, [&](float time) {
+                       return binOf(time) < binMax;
+                   }) - rt;
+        }
+
+        for (unsigned int j = first; j < last; j++)
+        {
+            unsigned int bin = binOf(rt[j]);
+            if (!wholeRange && (bin < binMin || bin >= binMax))
+                continue;
+
+            float value = spline && spline[j] > 0 ? spline[j] : y[j];
+            intensity[bin] += weighted ? weight * value : value;
+
+            if (eicMz[j] > 0) {
+                mz[bin] += eicMz[j];
+                mzcount[bin]++;
+            }
+        }
+    }
+}
+
+EIC *EIC::eicMerge(const vector<EIC *> &eics, const vector<float> &weights)
 {
     // Merge to 776
     EIC *meic = new EIC();
@@ -73,52 +143,71 @@ EIC *EIC::eicMerge(const vector<EIC *> &eics)
     if (maxlen == 0)
         return meic;
 
-    //create new EIC
+    //create new EIC, accumulating directly into its vectors
     meic->sample = NULL;
-    vector<float> intensity(maxlen, 0);
-    vector<float> rt(maxlen, 0);
-    vector<int> scans(maxlen, 0);
-    vector<float> mz(maxlen, 0);
-    vector<int> mzcount(maxlen, 0);
+    vector<float>& intensity = meic->intensity;
+    vector<float>& rt = meic->rt;
+    vector<float>& mz = meic->mz;
+    intensity.assign(maxlen, 0);
+    rt.resize(maxlen);
+    mz.assign(maxlen, 0);
+    meic->scannum.resize(maxlen);
+
+    // scratch space is kept per thread, as merges run for every slice
+    static thread_local vector<int> mzcount;
+    mzcount.assign(maxlen, 0);
 
     //smoothing   //initalize time array
     for (unsigned int i = 0; i < maxlen; i++)
     {
         rt[i] = minRt + i * ((maxRt - minRt) / maxlen);
-        scans[i] = i;
+        meic->scannum[i] = i;
     }
 
-    //combine intensity data from all pulled eics
-    for (unsigned int i = 0; i < eics.size(); i++)
-    {
-        EIC *e = eics[i];
-        for (unsigned int j = 0; j < e->size(); j++)
-        {
-            unsigned int bin = ((e->rt[j] - minRt) / (maxRt - minRt) * maxlen);
-            if (bin >= maxlen)
-                bin = maxlen - 1;
-
-            if (e->spline and e->spline[j] > 0)
-            {
-                intensity[bin] += e->spline[j];
-            }
-            else
-            {
-                intensity[bin] += e->intensity[j];
-            }
+    // large merges are split into ranges of bins accumulated in parallel,
+    // each bin still summing its points in the order of EICs and scans so
+    // that the result does not depend on the number of threads
+    int numRanges = 1;
+    size_t numPoints = 0;
+    for (auto e : eics)
+        numPoints += e->size();
+    int numThreads = omp_in_parallel() ? 1 : omp_get_max_threads();
+    if (numPoints > 100000 && numThreads > 1)
+        numRanges = min(maxlen, 4u * numThreads);
+    vector<char> rtSorted;
+    if (numRanges > 1) {
+        for (auto e : eics)
+            rtSorted.push_back(is_sorted(e->rt.begin(), e->rt.end()));
+    }
 
-            if (e->mz[j] > 0)
-            {
-                mz[bin] += e->mz[j];
-                mzcount[bin]++;
-            }
-        }
+    float *sumIntensity = intensity.data();
+    float *sumMz = mz.data();
+    int *mzCounts = mzcount.data();
+    unsigned int rangeSize = (maxlen + numRanges - 1) / numRanges;
+#pragma omp parallel for schedule(dynamic) if (numRanges > 1)
+    for (int r = 0; r < numRanges; r++)
+    {
+        unsigned int binMin = r * rangeSize;
+        unsigned int binMax = min(maxlen, binMin + rangeSize);
+        _mergeBins(eics,
+                   weights,
+                   rtSorted,
+                   minRt,
+                   maxRt,
+                   maxlen,
+                   binMin,
+                   binMax,
+                   sumIntensity,
+                   sumMz,
+                   mzCounts);
     }
 
-    unsigned int eicCount = eics.size();
+    float totalWeight = eics.size();
+    if (!weights.empty())
+        totalWeight = accumulate(weights.begin(), weights.end(), 0.0f);
     for (unsigned int i = 0; i < maxlen; i++)
     {
-        intensity[i] /= eicCount;
+        intensity[i] /= totalWeight;
         if (intensity[i] > meic->maxIntensity) {
             meic->maxIntensity = intensity[i];
             meic->rtAtMaxIntensity = rt[i];
@@ -129,13 +218,8 @@ EIC *EIC::eicMerge(const vector<EIC *> &eics)
         meic->totalIntensity += intensity[i];
     }
 
-    //copy to new EIC
     meic->rtmin = minRt;
     meic->rtmax = maxRt;
-    meic->intensity = intensity;
-    meic->rt = rt;
-    meic->scannum = scans;
-    meic->mz = mz;
     meic->sampleName = eics[0]->sampleName;
     meic->sample = eics[0]->sample;
     return meic;
@@ -1030,6 +1114,17 @@ vector<PeakGroup> EIC::groupPeaks(vector<EIC *> &eics,
         pgroups.push_back(grp);
     }
 
+    // RT index over the merged peaks (already sorted by RT). A sample peak
+    // can only be assigned to a merged peak whose RT lies within the grouping
+    // window, so only that range of candidates needs to be scored. The window
+    // is padded slightly to stay clear of float rounding at its edges; the
+    // exact distance check is still applied to every candidate.
+    vector<float> mergedPeakRts;
+    mergedPeakRts.reserve(m->peaks.size());
+    for (const auto& peak : m->peaks)
+        mergedPeakRts.push_back(peak.rt);
+    float searchWindow = mp->grouping_maxRtWindow + 0.001f;
+
     // for every sample
     for (unsigned int i = 0; i < eics.size(); i++) {
         // for every peak in the sample
@@ -1038,16 +1133,17 @@ vector<PeakGroup> EIC::groupPeaks(vector<EIC *> &eics,
             b.groupNum = -1;
             b.groupOverlap = FLT_MIN;
 
-            vector<Peak>::iterator itr = lower_bound(m->peaks.begin(),
-                                                     m->peaks.end(),
-                                                     b,
-                                                     Peak::compRtMin);
-            int lb = (itr - (m->peaks.begin())) - 1;
-            if (lb < 0)
-                lb = 0;
+            auto first = lower_bound(begin(mergedPeakRts),
+                                     end(mergedPeakRts),
+                                     b.rt - searchWindow);
+            auto last = upper_bound(first,
+                                    end(mergedPeakRts),
+                                    b.rt + searchWindow);
+            unsigned int kBegin = distance(begin(mergedPeakRts), first);
+            unsigned int kEnd = distance(begin(mergedPeakRts), last);
 
             // find best matching group
-            for (unsigned int k = 0; k < m->peaks.size(); k++)
+            for (unsigned int k = kBegin; k < kEnd; k++)
             {
                 Peak &a = m->peaks[k];
 
@@ -1122,6 +1218,14 @@ vector<PeakGroup> EIC::groupPeaks(vector<EIC *> &eics,
                                  }),
                   pgroups.end());
 
+    // only blank EICs contribute to a group's blank area, filter them once
+    // instead of once per group
+    vector<EIC*> blankEics;
+    for (auto eic : eics) {
+        if (eic->sample == nullptr || eic->sample->isBlank)
+            blankEics.push_back(eic);
+    }
+
     for (unsigned int i = 0; i < pgroups.size(); i++)
     {
         PeakGroup &grp = pgroups[i];
@@ -1130,7 +1234,7 @@ vector<PeakGroup> EIC::groupPeaks(vector<EIC *> &eics,
         //grp.fillInPeaks(eics);
         //Feng note: fillInPeaks is unecessary
         grp.groupStatistics();
-        grp.computeAvgBlankArea(eics);
+        grp.computeAvgBlankArea(blankEics);
         if (grp.getFragmentationEvents().size()) {
             grp.computeFragPattern(mp->fragmentTolerance);
             grp.matchFragmentation(mp->fragmentTolerance, mp->scoringAlgo);
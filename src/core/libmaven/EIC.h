@@ -302,12 +302,19 @@ class EIC
                shared_ptr<MavenParameters> mp,
                PeakGroup::IntegrationType integrationType = PeakGroup::IntegrationType::Programmatic);
     /**
-         * [eicMerge ]
-         * @method eicMerge
-         * @param  eics     []
-         * @return []
+         * @brief Merge EICs into a single EIC, averaging their intensities
+         * over a common retention time grid.
+         * @details The grid has as many bins as the longest EIC, spread
+         * evenly over the retention time range of all EICs. Merges of many
+         * points are accumulated in parallel over ranges of this grid, which
+         * gives the same result regardless of the number of threads.
+         * @param eics EICs to be merged.
+         * @param weights Optional weight of each EIC, in which case
+         * intensities are a weighted average instead.
+         * @return Merged EIC, owned by the caller.
          */
-    static EIC *eicMerge(const vector<EIC *> &eics);
+    static EIC *eicMerge(const vector<EIC *> &eics,
+                         const vector<float> &weights = {});
 
     /**
          * [remove Low Rank Groups ]
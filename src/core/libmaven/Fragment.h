@@ -174,7 +174,7 @@ class Fragment {
 
         FragmentationMatchScore scoreMatch(Fragment* other, float productPpmTolr);
 
-        inline unsigned int nobs() { return mzValues.size(); }
+        inline unsigned int nobs() const { return mzValues.size(); }
 
         static bool compPrecursorMz(const Fragment* a, const Fragment* b);
         bool operator<(const Fragment* b) const;
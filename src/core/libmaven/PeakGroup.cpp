@@ -84,9 +84,11 @@ PeakGroup::PeakGroup(shared_ptr<MavenParameters> parameters,
     changePValue=0;
     changeFoldRatio=0;
     peaks.resize(0);
+    _indexPeaks();
 }
 
-void PeakGroup::copyObj(const PeakGroup& o)  {
+void PeakGroup::_copyValues(const PeakGroup& o)
+{
     _groupId= o._groupId;
     _metaGroupId= o._metaGroupId;
     clusterId = o.clusterId;
@@ -107,7 +109,6 @@ void PeakGroup::copyObj(const PeakGroup& o)  {
 
     ms2EventCount = o.ms2EventCount;
     fragMatchScore = o.fragMatchScore;
-    fragmentationPattern = o.fragmentationPattern;
 
     blankMax=o.blankMax;
     blankSampleCount=o.blankSampleCount;
@@ -144,28 +145,64 @@ void PeakGroup::copyObj(const PeakGroup& o)  {
     parent = o.parent;
     setSlice(o.getSlice());
 
-    srmId=o.srmId;
     isFocused=o.isFocused;
     label=o.label;
 
     goodPeakCount=o.goodPeakCount;
     _type = o._type;
     _sliceSet = o.hasSlice();
-    tagString = o.tagString;
 
     changeFoldRatio = o.changeFoldRatio;
     changePValue    = o.changePValue;
-    peaks = o.peaks;
-    samples=o.samples;
 
     markedBadByCloudModel = o.markedBadByCloudModel;
     markedGoodByCloudModel = o.markedGoodByCloudModel;
 
+    _integrationType = o.integrationType();
+}
+
+void PeakGroup::copyObj(const PeakGroup& o)  {
+    _copyValues(o);
+    _fragmentationPattern = o._fragmentationPattern;
+    srmId=o.srmId;
+    tagString = o.tagString;
+    peaks = o.peaks;
+    _indexPeaks();
+    samples=o.samples;
     _tableName = o.tableName();
 
+    // parameters are shared with the original, until either group needs to
+    // modify them (see `mutableParameters`)
+    _parameters = o._parameters;
     copyChildren(o);
-    _parameters = make_shared<MavenParameters>(*(o.parameters().get()));
-    _integrationType = o.integrationType();
+}
+
+void PeakGroup::moveObj(PeakGroup&& o)  {
+    _copyValues(o);
+    _fragmentationPattern = std::move(o._fragmentationPattern);
+    srmId = std::move(o.srmId);
+    tagString = std::move(o.tagString);
+    peaks = std::move(o.peaks);
+    _indexPeaks();
+    samples = std::move(o.samples);
+    _tableName = std::move(o._tableName);
+
+    _childIsotopes = std::move(o._childIsotopes);
+    _childAdducts = std::move(o._childAdducts);
+    _childIsotopesBarPlot = std::move(o._childIsotopesBarPlot);
+    for (auto child : _childIsotopes)
+        child->parent = this;
+    for (auto child : _childAdducts)
+        child->parent = this;
+    for (auto child : _childIsotopesBarPlot)
+        child->parent = this;
+    o._childIsotopes.clear();
+    o._childAdducts.clear();
+    o._childIsotopesBarPlot.clear();
+    o.peaks.clear();
+    o._indexPeaks();
+
+    _parameters = std::move(o._parameters);
 }
 
 PeakGroup::~PeakGroup() {
@@ -173,6 +210,33 @@ PeakGroup::~PeakGroup() {
     clear();
 }
 
+MavenParameters* PeakGroup::mutableParameters()
+{
+    if (_parameters && _parameters.use_count() > 1)
+        _parameters = make_shared<MavenParameters>(*_parameters);
+    return _parameters.get();
+}
+
+const Fragment& PeakGroup::fragmentationPattern() const
+{
+    static const Fragment emptyPattern;
+    if (_fragmentationPattern == nullptr)
+        return emptyPattern;
+    return *_fragmentationPattern;
+}
+
+Fragment* PeakGroup::_mutableFragmentationPattern()
+{
+    if (_fragmentationPattern == nullptr) {
+        _fragmentationPattern = make_shared<Fragment>();
+    } else if (_fragmentationPattern.use_count() > 1) {
+        auto pattern = make_shared<Fragment>();
+        *pattern = *_fragmentationPattern;
+        _fragmentationPattern = pattern;
+    }
+    return _fragmentationPattern.get();
+}
+
 void PeakGroup::copyChildren(const PeakGroup& o) {
     _childIsotopes.clear();
     for (auto child : o.childIsotopes())
@@ -235,8 +299,48 @@ void PeakGroup::setCompound(Compound* compound)
 
 void PeakGroup::addPeak(const Peak &peak)
 {
+    bool slotsValid = _peakSlotsValid();
 	peaks.push_back(peak);
     peaks.back().groupNum = _groupId;
+
+    // a table that went stale since it was built cannot be extended, since
+    // its markers would then match the modified peaks again
+    if (!slotsValid) {
+        _indexPeaks();
+        return;
+    }
+    mzSample* sample = peak.getSample();
+    if (sample != nullptr) {
+        size_t index = sample->getSampleIndex();
+        if (index >= _peakSlots.size())
+            _peakSlots.resize(index + 1, -1);
+        if (_peakSlots[index] < 0)
+            _peakSlots[index] = static_cast<int>(peaks.size() - 1);
+    }
+    _peakSlotsCount = peaks.size();
+    _peakSlotsData = peaks.data();
+}
+
+void PeakGroup::_indexPeaks()
+{
+    _peakSlots.clear();
+    for (size_t i = 0; i < peaks.size(); ++i) {
+        mzSample* sample = peaks[i].getSample();
+        if (sample == nullptr)
+            continue;
+        size_t index = sample->getSampleIndex();
+        if (index >= _peakSlots.size())
+            _peakSlots.resize(index + 1, -1);
+        if (_peakSlots[index] < 0)
+            _peakSlots[index] = static_cast<int>(i);
+    }
+    _peakSlotsCount = peaks.size();
+    _peakSlotsData = peaks.data();
+}
+
+bool PeakGroup::_peakSlotsValid() const
+{
+    return _peakSlotsCount == peaks.size() && _peakSlotsData == peaks.data();
 }
 
 void PeakGroup::setSlice(const mzSlice& slice)
@@ -274,11 +378,13 @@ bool PeakGroup::sliceIsZero() const
 
 void PeakGroup::deletePeaks() {
     peaks.clear();
+    _indexPeaks();
 }
 
 bool PeakGroup::deletePeak(unsigned int index) {
     if (index < peakCount()) {
         peaks.erase(peaks.begin()+index);
+        _indexPeaks();
         return true;
     }
     return false;
@@ -375,37 +481,59 @@ vector<float> PeakGroup::getOrderedIntensityVector(vector<mzSample*>& samples, Q
 
     if (samples.size() == 0) { vector<float>x; return x; } //empty vector;
 
-    map<mzSample*,float> sampleOrder;
-    vector<float>maxIntensity(samples.size(),0);
+    return getOrderedIntensityVector(sampleOrderTable(samples),
+                                     samples.size(),
+                                     type);
+}
 
-    for( unsigned int j=0; j < samples.size(); j++) {
-        sampleOrder[samples[j]]=j;
-        maxIntensity[j]=0;
+vector<int> PeakGroup::sampleOrderTable(const vector<mzSample*>& samples)
+{
+    vector<int> sampleOrder;
+    for (size_t j = 0; j < samples.size(); j++) {
+        if (samples[j] == nullptr)
+            continue;
+        size_t index = samples[j]->getSampleIndex();
+        if (index >= sampleOrder.size())
+            sampleOrder.resize(index + 1, -1);
+        sampleOrder[index] = static_cast<int>(j);
     }
+    return sampleOrder;
+}
+
+vector<float> PeakGroup::getOrderedIntensityVector(
+    const vector<int>& sampleOrder,
+    size_t sampleCount,
+    QType type)
+{
+    vector<float>maxIntensity(sampleCount,0);
 
     for( unsigned int j=0; j < peaks.size(); j++) {
         Peak& peak = peaks.at(j);
         mzSample* sample = peak.getSample();
 
-        if ( sampleOrder.count(sample) > 0 ) {
-            int s  = sampleOrder[ sample ];
-            float y = 0;
-            switch (type)  {
-                case AreaTop: y = peak.peakAreaTopCorrected; break;
-                case Area: y = peak.peakAreaCorrected; break;
-                case Height: y = peak.peakIntensity; break;
-                case AreaNotCorrected: y = peak.peakArea; break;
-                case AreaTopNotCorrected: y = peak.peakAreaTop; break;
-                case RetentionTime: y = peak.rt; break;
-                case Quality: y = peak.quality; break;
-                case SNRatio: y = peak.signalBaselineRatio; break;
-                default: y = peak.peakIntensity; break;
-            }
+        if (sample == nullptr
+            || sample->getSampleIndex() >= sampleOrder.size()
+            || sampleOrder[sample->getSampleIndex()] < 0) {
+            continue;
+        }
 
-            //normalize
-            if(sample) y *= sample->getNormalizationConstant();
-            if(maxIntensity[s] < y) { maxIntensity[s]=y;}
+        int s = sampleOrder[sample->getSampleIndex()];
+        float y = 0;
+        switch (type)  {
+            case AreaTop: y = peak.peakAreaTopCorrected; break;
+            case Area: y = peak.peakAreaCorrected; break;
+            case Height: y = peak.peakIntensity; break;
+            case AreaNotCorrected: y = peak.peakArea; break;
+            case AreaTopNotCorrected: y = peak.peakAreaTop; break;
+            case RetentionTime: y = peak.rt; break;
+            case Quality: y = peak.quality; break;
+            case SNRatio: y = peak.signalBaselineRatio; break;
+            default: y = peak.peakIntensity; break;
         }
+
+        //normalize
+        y *= sample->getNormalizationConstant();
+        if(maxIntensity[s] < y) { maxIntensity[s]=y;}
     }
     return maxIntensity;
 }
@@ -429,7 +557,20 @@ void PeakGroup::computeAvgBlankArea(const vector<EIC*>& eics) {
     for(unsigned int i=0; i < eics.size(); i++ ) {
         EIC* eic = eics[i];
         if(eic->sample != NULL && eic->sample->isBlank == false) continue;
-        for(unsigned int pos=0; pos < eic->intensity.size(); pos++ ) {
+
+        // when retention times are sorted, visit only the points in range;
+        // these need not be sorted after alignment
+        unsigned int pos = 0;
+        unsigned int last = eic->intensity.size();
+        if (is_sorted(eic->rt.begin(), eic->rt.end())) {
+            auto first = lower_bound(eic->rt.begin(), eic->rt.end(), rtmin);
+            auto end = upper_bound(first, eic->rt.end(), rtmax);
+            pos = distance(eic->rt.begin(), first);
+            last = min(last,
+                       static_cast<unsigned int>(distance(eic->rt.begin(),
+                                                          end)));
+        }
+        for(; pos < last; pos++ ) {
             if ( eic->rt[pos] >= rtmin && eic->rt[pos] <= rtmax
                     && eic->intensity[pos] > 0) {
                 sum += eic->intensity[pos];
@@ -537,6 +678,7 @@ void PeakGroup::reduce() { // make sure there is only one peak per sample
     }
 
     peaks.clear();
+    _indexPeaks();
     for( itr = maxPeaks.begin(); itr != maxPeaks.end(); ++itr ) {
         const Peak& peak = (*itr).second;
         addPeak(peak);
@@ -634,6 +776,8 @@ double PeakGroup::getExpectedMz(int charge)
 }
 
 void PeakGroup::groupStatistics() {
+    _indexPeaks();
+
     float rtSum = 0;
     float mzSum = 0;
     maxIntensity = 0;
@@ -777,6 +921,17 @@ PeakGroup& PeakGroup::operator=(const PeakGroup& o)  {
     return *this;
 }
 
+PeakGroup::PeakGroup(PeakGroup&& o) noexcept
+{
+    moveObj(std::move(o));
+}
+
+PeakGroup& PeakGroup::operator=(PeakGroup&& o) noexcept {
+    if (this != &o)
+        moveObj(std::move(o));
+    return *this;
+}
+
 
 bool PeakGroup::operator==(const PeakGroup* o)  {
     if ( this == o ) {
@@ -788,6 +943,15 @@ bool PeakGroup::operator==(const PeakGroup* o)  {
 
 Peak* PeakGroup::getPeak(mzSample* s ) {
     if ( s == NULL ) return NULL;
+
+    if (_peakSlotsValid()) {
+        size_t index = s->getSampleIndex();
+        int slot = index < _peakSlots.size() ? _peakSlots[index] : -1;
+        if (slot >= 0 && peaks[slot].getSample() == s)
+            return &peaks[slot];
+    }
+
+    // peaks may have been modified in-place since they were last indexed
     for(unsigned int i=0; i < peaks.size(); i++ ) {
         if ( peaks[i].getSample() == s ) {
             return &peaks[i];
@@ -799,6 +963,7 @@ Peak* PeakGroup::getPeak(mzSample* s ) {
 
 void PeakGroup::reorderSamples() {
     std::sort(peaks.begin(), peaks.end(), Peak::compIntensity);
+    _indexPeaks();
     for(unsigned int i=0; i < peaks.size(); i++ ) {
         mzSample* s = peaks[i].getSample();
         if ( s != NULL ) s->setSampleOrder(i);
@@ -896,7 +1061,7 @@ void PeakGroup::computeFragPattern(float productPpmTolr)
     
     fragment.buildConsensus(productPpmTolr);
     fragment.consensus->sortByMz();
-    fragmentationPattern = fragment.consensus;
+    _fragmentationPattern = make_shared<Fragment>(fragment.consensus);
     ms2EventCount = ms2Events.size();
 }
 
@@ -906,9 +1071,10 @@ Scan* PeakGroup::getAverageFragmentationScan(float productPpmTolr)
     computeFragPattern(productPpmTolr);
     Scan* avgScan = new Scan(NULL, 0, 2, 0, 0, 0);
 
-    for(unsigned int i = 0; i < fragmentationPattern.mzValues.size(); i++) {
-        avgScan->mz.push_back(fragmentationPattern.mzValues[i]);
-        avgScan->intensity.push_back(fragmentationPattern.intensityValues[i]);
+    const Fragment& pattern = fragmentationPattern();
+    for(unsigned int i = 0; i < pattern.mzValues.size(); i++) {
+        avgScan->mz.push_back(pattern.mzValues[i]);
+        avgScan->intensity.push_back(pattern.intensityValues[i]);
     }
 
     avgScan->precursorMz = meanMz;
@@ -923,8 +1089,10 @@ void PeakGroup::matchFragmentation(float ppmTolerance, string scoringAlgo)
         || this->isAdduct()
         || ms2EventCount == 0) return;
 
-    fragMatchScore = getCompound()->scoreCompoundHit(&fragmentationPattern,
-                                                     ppmTolerance);
+    // scoring annotates the experimental pattern, hence the mutable access
+    fragMatchScore = getCompound()->scoreCompoundHit(
+        _mutableFragmentationPattern(),
+        ppmTolerance);
     fragMatchScore.mergedScore = fragMatchScore.getScoreByName(scoringAlgo);
 }
 
@@ -978,7 +1146,16 @@ void PeakGroup::setAdduct(Adduct* adduct)
 
 shared_ptr<PeakGroup> PeakGroup::addAdductChild(const PeakGroup& child)
 {
-    auto childCopy = make_shared<PeakGroup>(child);
+    return _addAdductChild(make_shared<PeakGroup>(child));
+}
+
+shared_ptr<PeakGroup> PeakGroup::addAdductChild(PeakGroup&& child)
+{
+    return _addAdductChild(make_shared<PeakGroup>(std::move(child)));
+}
+
+shared_ptr<PeakGroup> PeakGroup::_addAdductChild(shared_ptr<PeakGroup> childCopy)
+{
     childCopy->parent = this;
     childCopy->_metaGroupId = _groupId;
     auto iter = mzUtils::insertSorted(_childAdducts,
@@ -1008,7 +1185,16 @@ void PeakGroup::setIsotope(Isotope isotope)
 
 shared_ptr<PeakGroup> PeakGroup::addIsotopeChild(const PeakGroup& child)
 {
-    auto childCopy = make_shared<PeakGroup>(child);
+    return _addIsotopeChild(make_shared<PeakGroup>(child));
+}
+
+shared_ptr<PeakGroup> PeakGroup::addIsotopeChild(PeakGroup&& child)
+{
+    return _addIsotopeChild(make_shared<PeakGroup>(std::move(child)));
+}
+
+shared_ptr<PeakGroup> PeakGroup::_addIsotopeChild(shared_ptr<PeakGroup> childCopy)
+{
     childCopy->parent = this;
     childCopy->_metaGroupId = _groupId;
     auto iter = mzUtils::insertSorted(_childIsotopes,
@@ -1022,7 +1208,17 @@ shared_ptr<PeakGroup> PeakGroup::addIsotopeChild(const PeakGroup& child)
 
 shared_ptr<PeakGroup> PeakGroup::addIsotopeChildBarPlot(const PeakGroup& child)
 {
-    auto childCopy = make_shared<PeakGroup>(child);
+    return _addIsotopeChildBarPlot(make_shared<PeakGroup>(child));
+}
+
+shared_ptr<PeakGroup> PeakGroup::addIsotopeChildBarPlot(PeakGroup&& child)
+{
+    return _addIsotopeChildBarPlot(make_shared<PeakGroup>(std::move(child)));
+}
+
+shared_ptr<PeakGroup>
+PeakGroup::_addIsotopeChildBarPlot(shared_ptr<PeakGroup> childCopy)
+{
     childCopy->parent = this;
     childCopy->_metaGroupId = _groupId;
     _childIsotopesBarPlot.push_back(childCopy);
@@ -52,6 +52,8 @@ class PeakGroup{
         PeakGroup(const PeakGroup& o,
                   IntegrationType integrationType = IntegrationType::Inherit);
         PeakGroup& operator=(const PeakGroup& o);
+        PeakGroup(PeakGroup&& o) noexcept;
+        PeakGroup& operator=(PeakGroup&& o) noexcept;
 
         bool operator==(const PeakGroup* o);
         /**
@@ -61,6 +63,15 @@ class PeakGroup{
          */
         void copyObj(const PeakGroup& o);
 
+        /**
+         * @brief Take over the contents of another group, without copying
+         * its peaks, children or parameters.
+         * @details Children are re-parented to this group. The moved-from
+         * group is left empty, but can still be destroyed or assigned to.
+         * @param o Group whose contents will be moved into this one.
+         */
+        void moveObj(PeakGroup&& o);
+
         /**
          * [copy ]
          * @method copy
@@ -110,7 +121,6 @@ class PeakGroup{
         int  ms2EventCount;
 
         FragmentationMatchScore fragMatchScore;
-        Fragment fragmentationPattern;
 
         double minIntensity;
 
@@ -333,18 +343,25 @@ class PeakGroup{
         void addPeak(const Peak& peak);
 
         shared_ptr<PeakGroup> addIsotopeChild(const PeakGroup& child);
+        shared_ptr<PeakGroup> addIsotopeChild(PeakGroup&& child);
 
         shared_ptr<PeakGroup> addAdductChild(const PeakGroup& child);
+        shared_ptr<PeakGroup> addAdductChild(PeakGroup&& child);
 
         shared_ptr<PeakGroup> addIsotopeChildBarPlot(const PeakGroup& child);
+        shared_ptr<PeakGroup> addIsotopeChildBarPlot(PeakGroup&& child);
 
         /**
-         * [getPeak ]
-         * @method getPeak
-         * @param  sample  []
-         * @return []
+         * @brief Find the peak of this group that belongs to a sample.
+         * @details Lookups are done in constant time through a table indexed
+         * by each sample's index, which is kept up-to-date by the methods of
+         * this class that modify peaks. If the peak vector was changed
+         * directly since the table was last built, or the table has no peak
+         * for the sample, a linear search is done instead.
+         * @param sample Sample whose peak is needed.
+         * @return Pointer to the first peak belonging to the sample, or null
+         * if there is no such peak.
          */
-
         Peak* getPeak(mzSample* sample);
 
         GroupType _type;
@@ -491,6 +508,28 @@ class PeakGroup{
 
         vector<float> getOrderedIntensityVector(vector<mzSample*>& samples, QType type);
 
+        /**
+         * @brief Same as `getOrderedIntensityVector(samples, type)`, but for
+         * callers that query many groups against the same sample order.
+         * @param sampleOrder Position of each sample in the output vector, as
+         * created by `sampleOrderTable`.
+         * @param sampleCount Size of the output vector.
+         * @param type Quantity type for the intensities.
+         */
+        vector<float> getOrderedIntensityVector(
+            const vector<int>& sampleOrder,
+            size_t sampleCount,
+            QType type);
+
+        /**
+         * @brief Create a table of sample positions that can be used with
+         * `getOrderedIntensityVector(sampleOrder, sampleCount, type)`.
+         * @param samples Samples in the order their values are needed.
+         * @return A vector, indexed by sample index, holding the position of
+         * each sample (or -1 for samples that are not present).
+         */
+        static vector<int> sampleOrderTable(const vector<mzSample*>& samples);
+
         /**
          * [reorderSamples ]
          * @method reorderSamples
@@ -624,6 +663,24 @@ class PeakGroup{
             return _parameters;
         }
 
+        /**
+         * @brief Obtain a modifiable parameters object for this peak-group.
+         * @details Copies of a group share their parameters object, which is
+         * duplicated here if any other group still refers to it. Changes made
+         * through the returned pointer are therefore never seen by copies.
+         * @return Pointer to a `MavenParameters` object owned by this group.
+         */
+        MavenParameters* mutableParameters();
+
+        /**
+         * @brief Obtain the consensus fragmentation pattern of this group, as
+         * computed by `computeFragPattern`.
+         * @details The pattern is shared by copies of this group until one of
+         * them recomputes or rescores it.
+         * @return Reference to a `Fragment`, empty if no pattern was computed.
+         */
+        const Fragment& fragmentationPattern() const;
+
         IntegrationType integrationType() const { return _integrationType; }
 
         int groupId() const { return _groupId; }
@@ -648,6 +705,38 @@ class PeakGroup{
         shared_ptr<MavenParameters> _parameters;
         IntegrationType _integrationType;
 
+        /**
+         * @brief Consensus fragmentation pattern, shared between copies of
+         * this group (null if none was computed).
+         */
+        shared_ptr<Fragment> _fragmentationPattern;
+
+        Fragment* _mutableFragmentationPattern();
+
         void _updateType();
+
+        /**
+         * @brief Position of the first peak of each sample in `peaks`, indexed
+         * by sample index (-1 for samples without a peak), along with the size
+         * and storage of `peaks` for which it was built.
+         */
+        vector<int> _peakSlots;
+        size_t _peakSlotsCount;
+        const Peak* _peakSlotsData;
+
+        void _indexPeaks();
+        bool _peakSlotsValid() const;
+
+        /**
+         * @brief Copy the values of another group that are the same whether
+         * it is copied or moved from, i.e., all but its peaks, samples,
+         * children, parameters and strings.
+         */
+        void _copyValues(const PeakGroup& o);
+
+        shared_ptr<PeakGroup> _addIsotopeChild(shared_ptr<PeakGroup> child);
+        shared_ptr<PeakGroup> _addAdductChild(shared_ptr<PeakGroup> child);
+        shared_ptr<PeakGroup>
+        _addIsotopeChildBarPlot(shared_ptr<PeakGroup> child);
 };
 #endif
@@ -3,6 +3,18 @@
 
 using namespace mzUtils;
 
+// mark each point as an outlier unless it is kept, with the given chance
+vector<bool> _randomOutliers(size_t count,
+                             double keepFrac,
+                             mt19937& generator)
+{
+	bernoulli_distribution keep(keepFrac);
+	vector<bool> outliers(count);
+	for (size_t i = 0; i < count; i++)
+		outliers[i] = !keep(generator);
+	return outliers;
+}
+
 PolyAligner::PolyAligner(StatisticsVector<float>& subj, StatisticsVector<float>& ref) {
 
 	if( subj.size() != ref.size()) { 
@@ -64,18 +76,7 @@ double PolyAligner::countInliners(AlignmentStats* model, float zValueCutoff) {
 }
 
 void PolyAligner::randomOutliers(double keepFrac) {
-
-	int N = subjVector.size();
-	if(!outlierVector.size()) outlierVector = vector<bool>(N,false);
-
-	for(int i=0; i < N; i++ ) {
-		 double r = randInt(0,1); //random number from 0 to 1
-		 if (r < keepFrac ) {
-			 outlierVector[i]=false;
-		 } else {
-			 outlierVector[i]=true;
-		 }
-	}
+	outlierVector = _randomOutliers(subjVector.size(), keepFrac, _generator);
 }
 
 AlignmentStats* PolyAligner::align(int degree) {
@@ -186,31 +187,138 @@ void PolyAligner::calculateOutliers(int initDegree) {
 }
 
 
-AlignmentStats* PolyAligner::optimalPolynomial(int fromDegree, int toDegree, int sampleSize=0) { 
-
-	float R_best = FLT_MAX;
-    AlignmentStats* bestModel = NULL;
+vector<AlignmentStats*> PolyAligner::_fitDegrees(const vector<bool>& outliers,
+                                                int fromDegree,
+                                                int toDegree)
+{
+	vector<double> x;
+	vector<double> ref;
+	for (unsigned int i = 0; i < subjVector.size(); i++) {
+		if (outliers.empty() || outliers[i] == false) {
+			x.push_back(subjVector[i]);
+			ref.push_back(refVector[i]);
+		}
+	}
+	int N = x.size();
+
+	// sums of powers of x, and of y times powers of x, from which the
+	// normal equations of every degree are formed
+	int maxDegree = min(max(toDegree - 1, 0), 99);
+	if (maxDegree > N / 3)
+		maxDegree = N / 3;
+	vector<double> powerSums(2 * maxDegree + 1, 0.0);
+	vector<double> momentSums(maxDegree + 1, 0.0);
+	for (int i = 0; i < N; i++) {
+		if (x[i] == 0.0)
+			continue;
+		double power = 1.0;
+		for (int k = 0; k <= 2 * maxDegree; k++) {
+			powerSums[k] += power;
+			if (k <= maxDegree)
+				momentSums[k] += power * ref[i];
+			power *= x[i];
+		}
+	}
 
-	for(int deg=fromDegree; deg<toDegree; deg++) { 
-		for(int attempt=0; attempt <= sampleSize; attempt++ ) { 
+	vector<AlignmentStats*> models;
+	for (int deg = fromDegree; deg < toDegree; deg++) {
+		AlignmentStats* stats = new AlignmentStats();
+		stats->poly_align_degree = deg;
+		if (stats->poly_align_degree >= 100) stats->poly_align_degree=99;
+		if (stats->poly_align_degree > N/3) stats->poly_align_degree = N/3;
+		stats->N = N;
+		models.push_back(stats);
+		if (N == 0)
+			continue;
+
+		int size = stats->poly_align_degree + 1;
+		vector<double> w(size * size);
+		vector<double> b(size);
+		vector<double> result(size);
+		for (int k = 0; k < size; k++) {
+			for (int j = 0; j < size; j++)
+				w[size * k + j] = powerSums[k + j];
+			b[k] = momentSums[k];
+		}
+		gauss(size, w.data(), size, b.data(), result.data());
 
-			AlignmentStats* thisModel = this->align(deg); 
-			double R_thismodel = this->calculateR2(thisModel);
-			//double R_thismodel = this->countInliners(thisModel,2.0);
+		for (int ii = 0; ii < N; ii++) {
+			double newrt = leasev(result.data(),
+			                      stats->poly_align_degree,
+			                      x[ii]);
+			if (newrt != newrt || std::isinf(newrt)) {
+				cerr << "Transform failed: " << ii << "\t" << x[ii] << "-> " << newrt << endl;
+				stats->transformedFailed++;
+			} else {
+				stats->R_before += SQUARE(ref[ii] - x[ii]);
+				stats->R_after  += SQUARE(ref[ii] - newrt);
+			}
+		}
+		if (stats->transformedFailed == 0)
+			stats->poly_transform_result = result;
+	}
+	return models;
+}
 
-			randomOutliers(0.35); //new random subset of data
+AlignmentStats* PolyAligner::optimalPolynomial(int fromDegree,
+                                               int toDegree,
+                                               int sampleSize,
+                                               unsigned int seed)
+{
+	const int attemptsPerRound = 8;
+	int numDegrees = max(toDegree - fromDegree, 0);
+	int numAttempts = max(sampleSize + 1, 2);
+
+	double R_best = DBL_MAX;
+	AlignmentStats* bestModel = NULL;
+	int bestIndex = INT_MAX;
+	for (int first = 0; first < numAttempts && numDegrees > 0;
+	     first += attemptsPerRound) {
+		int last = min(first + attemptsPerRound, numAttempts);
+		vector<AlignmentStats*> models((last - first) * numDegrees);
+		vector<double> scores(models.size());
+#pragma omp parallel for schedule(dynamic)
+		for (int attempt = first; attempt < last; attempt++) {
+			// the first attempts fit the inliers of the initial fit and all
+			// points, the others random subsets
+			vector<bool> outliers;
+			if (attempt == 0) {
+				outliers = outlierVector;
+			} else if (attempt > 1) {
+				seed_seq seeds = {seed, static_cast<unsigned int>(attempt)};
+				mt19937 generator(seeds);
+				outliers = _randomOutliers(subjVector.size(), 0.35, generator);
+			}
 
-			if (R_thismodel < R_best ) { 
-                //cerr << "optimalPolynomial() \t attempt=" << attempt << " R2=" << R_thismodel << endl;
-				if (bestModel) delete(bestModel);
-				bestModel = thisModel;
-				R_best = R_thismodel; 
-				continue;
-			}  else {
-				delete(thisModel);
+			auto fitted = _fitDegrees(outliers, fromDegree, toDegree);
+			for (int d = 0; d < numDegrees; d++) {
+				int m = (attempt - first) * numDegrees + d;
+				models[m] = fitted[d];
+				scores[m] = this->calculateR2(fitted[d]);
 			}
+		}
 
+		// models are ranked by degree before attempt, as if they had all
+		// been fitted one after the other
+		bool improved = false;
+		for (int attempt = first; attempt < last; attempt++) {
+			for (int d = 0; d < numDegrees; d++) {
+				int m = (attempt - first) * numDegrees + d;
+				int index = d * numAttempts + attempt;
+				if (scores[m] < R_best
+				    || (scores[m] == R_best && index < bestIndex)) {
+					if (bestModel) delete(bestModel);
+					improved = improved || scores[m] < R_best;
+					bestModel = models[m];
+					R_best = scores[m];
+					bestIndex = index;
+				} else {
+					delete(models[m]);
+				}
+			}
 		}
+		if (!improved)
+			break;
 	}
 
 	if ( bestModel ) return bestModel;
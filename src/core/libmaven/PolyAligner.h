@@ -1,6 +1,8 @@
 #ifndef POLYALIGNER
 #define POLYALIGNER
 
+#include <random>
+
 #include "mzFit.h"
 #include "statistics.h"
 
@@ -60,7 +62,31 @@ class PolyAligner {
 
 
 		AlignmentStats* align(int ideg);
-		AlignmentStats* optimalPolynomial(int fromDegree, int toDegree, int sampleSize);
+
+		/**
+		 * @brief Find the polynomial that best maps subject onto reference
+		 * values, over a range of degrees and subsets of the points.
+		 * @details The first attempt fits the points that were not outliers
+		 * of the initial fit, the second one all points and every other
+		 * attempt a random subset of the points. The polynomials of all
+		 * degrees are fitted to each subset from a single set of
+		 * normal-equation sums. Attempts are evaluated in parallel, in rounds
+		 * of a fixed size, and the search stops after a round that did not
+		 * improve on the best model. The subset of an attempt is drawn from
+		 * a generator seeded with the given seed and the attempt's number,
+		 * so that the result depends only on the seed.
+		 * @param fromDegree Lowest degree to be fitted.
+		 * @param toDegree Degree after the highest one to be fitted.
+		 * @param sampleSize Number of attempts after the first one, of which
+		 * there is at least one.
+		 * @param seed Seed for drawing random subsets.
+		 * @return The model with the lowest error over all points, ties
+		 * going to the lower degree and then to the earlier attempt.
+		 */
+		AlignmentStats* optimalPolynomial(int fromDegree,
+		                                  int toDegree,
+		                                  int sampleSize = 0,
+		                                  unsigned int seed = 0);
 		double calculateR2(AlignmentStats* model) ;
 		void calculateOutliers(int initDegree);
 		double  countInliners(AlignmentStats* model, float zValueCutoff);
@@ -69,10 +95,25 @@ class PolyAligner {
 		void test();
 
 	private:
+		friend class TestMzAligner;
+
 		StatisticsVector<float> subjVector;
 		StatisticsVector<float> refVector;
 		vector<bool> outlierVector;
 
+		/**
+		 * @brief Generator for the subsets of `randomOutliers`.
+		 */
+		mt19937 _generator;
+
+		/**
+		 * @brief Fit polynomials of each degree in [fromDegree, toDegree)
+		 * to the points that are not marked as outliers, in the same way as
+		 * `align` does.
+		 */
+		vector<AlignmentStats*> _fitDegrees(const vector<bool>& outliers,
+		                                    int fromDegree,
+		                                    int toDegree);
 };
 
 #endif
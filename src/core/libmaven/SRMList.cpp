@@ -1,3 +1,5 @@
+#include <numeric>
+
 #include "SRMList.h"
 #include "datastructures/mzSlice.h"
 #include "Compound.h"
@@ -11,12 +13,17 @@ SRMList::SRMList(vector<mzSample*>samples, deque<Compound*> compoundsDB){
 }
 
 vector<mzSlice*> SRMList::getSrmSlices(double amuQ1, double amuQ3, int userPolarity, bool associateCompoundNames) {
-    QMap<QString, Scan*>seenMRMS;
     int countMatches=0;
 
-    vector<mzSlice*>slices;
-    for(int i=0; i < samples.size(); i++ ) {
+    // the most intense scan of each filterline is found for every sample in
+    // parallel, and later ones only replace it if they are strictly more
+    // intense, so that the first such scan across all samples is kept
+    int numSamples = samples.size();
+    vector<unordered_map<string, Scan*>> sampleMRMS(numSamples);
+#pragma omp parallel for
+    for(int i=0; i < numSamples; i++ ) {
         mzSample* sample = samples[i];
+        auto& seen = sampleMRMS[i];
         for( int j=0; j < sample->scans.size(); j++ ) {
             Scan* scan = sample->getScan(j);
             if (!scan) continue;
@@ -24,23 +31,31 @@ vector<mzSlice*> SRMList::getSrmSlices(double amuQ1, double amuQ3, int userPolar
             // skipping empty scans
             if (scan->totalIntensity() == 0) continue;
 
-            QString filterLine(scan->filterLine.c_str());
-
-            if (filterLine.isEmpty()) continue;
-
-            if (seenMRMS.contains(filterLine)){
-                if(scan->intensity[0] <= seenMRMS.value(filterLine)->intensity[0]) continue;
-            }
+            if (scan->filterLine.empty()) continue;
 
-            seenMRMS.insert(filterLine, scan);
+            auto inserted = seen.emplace(scan->filterLine, scan);
+            if (!inserted.second
+                && scan->intensity[0] > inserted.first->second->intensity[0])
+                inserted.first->second = scan;
         }
     }
 
-    for (auto filterLine: seenMRMS.keys()){
+    map<string, Scan*> seenMRMS;
+    for (auto& seen : sampleMRMS) {
+        for (auto& entry : seen) {
+            auto inserted = seenMRMS.insert(entry);
+            if (!inserted.second
+                && entry.second->intensity[0] > inserted.first->second->intensity[0])
+                inserted.first->second = entry.second;
+        }
+    }
 
-        Scan* scan = seenMRMS.value(filterLine);
+    vector<mzSlice*>slices;
+    for (auto& entry : seenMRMS) {
+        const string& filterLine = entry.first;
+        Scan* scan = entry.second;
         mzSlice* s = new mzSlice(0,0,0,0);
-        s->srmId = scan->filterLine.c_str();
+        s->srmId = filterLine;
         slices.push_back(s);
 
         if (associateCompoundNames) {
@@ -55,11 +70,11 @@ vector<mzSlice*> SRMList::getSrmSlices(double amuQ1, double amuQ3, int userPolar
             if (userPolarity) polarity=userPolarity;  //user specified ionization mode
 
             if ( precursorMz == 0 ) {
-                precursorMz = getPrecursorOfSrm(filterLine.toStdString());
+                precursorMz = getPrecursorOfSrm(filterLine);
             }
 
             if (productMz == 0) {
-                productMz = getProductOfSrm(filterLine.toStdString());
+                productMz = getProductOfSrm(filterLine);
             }
 
             if (precursorMz != 0 && productMz != 0 ) {
@@ -72,12 +87,13 @@ vector<mzSlice*> SRMList::getSrmSlices(double amuQ1, double amuQ3, int userPolar
                                                   collisionEnergy);
             }
 
-            if (annotation[string(filterLine.toStdString())]) {
-                compound = annotation[filterLine.toStdString()];
+            auto annotated = annotation.find(filterLine);
+            if (annotated != annotation.end() && annotated->second) {
+                compound = annotated->second;
             }
 
             if (compound) {
-                compound->srmId() = filterLine.toStdString();
+                compound->srmId() = filterLine;
                 s->compound = compound;
                 s->rt = compound->expectedRt();
                 countMatches++;
@@ -87,6 +103,103 @@ vector<mzSlice*> SRMList::getSrmSlices(double amuQ1, double amuQ3, int userPolar
     return slices;
 }
 
+// cells are clamped to a range that comfortably fits in half of a key, any
+// transitions beyond it share the outermost cells
+int64_t _gridCell(float mz, double width)
+{
+    double cell = floor(mz / width);
+    const double limit = 1 << 30;
+    if (cell < -limit)
+        return -limit;
+    if (cell > limit)
+        return limit;
+    return static_cast<int64_t>(cell);
+}
+
+int64_t _gridKey(int64_t q1Cell, int64_t q3Cell)
+{
+    return static_cast<int64_t>((static_cast<uint64_t>(q1Cell) << 32)
+                                ^ static_cast<uint32_t>(q3Cell));
+}
+
+// widening the cells beyond the tolerances keeps float rounding, in the
+// distances as well as in the cell positions, from pushing a compound within
+// tolerance out of the neighbouring cells
+double _gridWidth(double tolerance)
+{
+    return max(tolerance * 1.01, 0.001);
+}
+
+void SRMList::_indexCompounds(double amuQ1, double amuQ3)
+{
+    double q1Width = _gridWidth(amuQ1);
+    double q3Width = _gridWidth(amuQ3);
+    if (_gridCompoundCount == compoundsDB.size()
+        && _gridQ1Width == q1Width
+        && _gridQ3Width == q3Width) {
+        return;
+    }
+
+    _transitionGrid.clear();
+    _unbucketedCompounds.clear();
+    for (unsigned int i = 0; i < compoundsDB.size(); i++) {
+        float precursorMz = compoundsDB[i]->precursorMz();
+        float productMz = compoundsDB[i]->productMz();
+        if (precursorMz == 0) continue;
+
+        // undefined m/z values have no cell but pass tolerance checks
+        if (!isfinite(precursorMz) || !isfinite(productMz)) {
+            _unbucketedCompounds.push_back(i);
+            continue;
+        }
+
+        int64_t key = _gridKey(_gridCell(precursorMz, q1Width),
+                               _gridCell(productMz, q3Width));
+        _transitionGrid[key].push_back(i);
+    }
+    _gridQ1Width = q1Width;
+    _gridQ3Width = q3Width;
+    _gridCompoundCount = compoundsDB.size();
+}
+
+vector<unsigned int> SRMList::_candidateCompounds(float precursorMz,
+                                                  float productMz,
+                                                  double amuQ1,
+                                                  double amuQ3)
+{
+    // without finite tolerances and m/z there are no cells to look into
+    vector<unsigned int> candidates;
+    if (!(amuQ1 >= 0.0 && isfinite(amuQ1))
+        || !(amuQ3 >= 0.0 && isfinite(amuQ3))
+        || !isfinite(precursorMz)
+        || !isfinite(productMz)) {
+        candidates.resize(compoundsDB.size());
+        iota(candidates.begin(), candidates.end(), 0);
+        return candidates;
+    }
+
+    _indexCompounds(amuQ1, amuQ3);
+    int64_t q1Cell = _gridCell(precursorMz, _gridQ1Width);
+    int64_t q3Cell = _gridCell(productMz, _gridQ3Width);
+    candidates = _unbucketedCompounds;
+    for (int64_t i = q1Cell - 1; i <= q1Cell + 1; i++) {
+        for (int64_t j = q3Cell - 1; j <= q3Cell + 1; j++) {
+            auto cell = _transitionGrid.find(_gridKey(i, j));
+            if (cell == _transitionGrid.end()) continue;
+            candidates.insert(candidates.end(),
+                              cell->second.begin(),
+                              cell->second.end());
+        }
+    }
+
+    // compounds are compared in the order of the database, so that ties
+    // are broken as they would be by a scan over all of them
+    sort(candidates.begin(), candidates.end());
+    candidates.erase(unique(candidates.begin(), candidates.end()),
+                     candidates.end());
+    return candidates;
+}
+
 Compound* SRMList::findSpeciesByPrecursor(float precursorMz,
                                           float productMz,
                                           float rt,
@@ -99,7 +212,7 @@ Compound* SRMList::findSpeciesByPrecursor(float precursorMz,
     float distMz=FLT_MAX;
     float distRt=FLT_MAX;
 
-    for(unsigned int i=0; i < compoundsDB.size(); i++ ) {
+    for(auto i : _candidateCompounds(precursorMz, productMz, amuQ1, amuQ3)) {
             if (compoundsDB[i]->precursorMz() == 0 ) continue;
             //cerr << polarity << " " << compoundsDB[i]->charge << endl;
             if ((int) compoundsDB[i]->charge() != polarity && compoundsDB[i]->charge() != 0) continue;
@@ -184,7 +297,7 @@ deque<Compound*> SRMList::getMatchedCompounds(string srmId, double amuQ1, double
     float precursorMz = getPrecursorOfSrm(srmId);
     float productMz = getProductOfSrm(srmId);
 
-    for(unsigned int i=0; i < compoundsDB.size(); i++ ) {
+    for(auto i : _candidateCompounds(precursorMz, productMz, amuQ1, amuQ3)) {
         if ((int) compoundsDB[i]->charge() != polarity && compoundsDB[i]->charge() != 0) continue;
         if (compoundsDB[i]->precursorMz() == 0 ) continue;
         float a = abs(compoundsDB[i]->precursorMz() - precursorMz);
@@ -1,6 +1,8 @@
 #ifndef SRMLIST_H
 #define SRMLIST_H
 
+#include <unordered_map>
+
 #include <QMap>
 
 #include "standardincludes.h"
@@ -50,6 +52,9 @@ class SRMList{
     /**
      * @brief Get nearest compound to precursor m/z, product m/z and
      * expected rt
+     * @details Only compounds lying in the cells of the transition grid
+     * around the given precursor and product m/z are compared, the nearest
+     * one being the same as if every compound had been.
      * @param precursorMz Mass by charge ratio of precursor
      * @param productMz Mass by charge ratio of product
      * @param rt Rt of slice
@@ -112,6 +117,38 @@ class SRMList{
      */
     map<string, Compound*> annotation;
 
+    /**
+     * @brief Compounds that have a precursor m/z, bucketed by their
+     * precursor and product m/z
+     * @details Cells are slightly wider than the Q1 and Q3 tolerances, so
+     * that any compound within tolerance of a transition lies in the cell
+     * of that transition or in one of its eight neighbours. Each cell lists
+     * indices into compoundsDB in increasing order, while compounds whose
+     * m/z is not finite are listed on their own and always compared. The
+     * grid is rebuilt whenever the tolerances or the number of compounds
+     * change.
+     */
+    unordered_map<int64_t, vector<unsigned int>> _transitionGrid;
+    vector<unsigned int> _unbucketedCompounds;
+    double _gridQ1Width = 0.0;
+    double _gridQ3Width = 0.0;
+    size_t _gridCompoundCount = 0;
+
+    /**
+     * @brief Build the transition grid for the given tolerances, unless
+     * it has already been built for them
+     */
+    void _indexCompounds(double amuQ1, double amuQ3);
+
+    /**
+     * @brief Indices (in increasing order) of compounds that may lie within
+     * tolerance of the given transition. Polarity and collision energy are
+     * left to be checked by the caller.
+     */
+    vector<unsigned int> _candidateCompounds(float precursorMz,
+                                             float productMz,
+                                             double amuQ1,
+                                             double amuQ3);
   };
 
 #endif
@@ -56,8 +56,16 @@ void ClassifierNeuralNet::loadModel(string filename) {
     }
 }
 
-vector<float> ClassifierNeuralNet::getFeatures(Peak& p) {
-	vector<float> set(num_features, 0);
+/**
+ * @brief Compute the classifier features of a peak.
+ * @param p Peak whose features are needed.
+ * @param features Memory where the features will be written.
+ * @param stride Distance between consecutive features in `features`, which
+ * allows them to be written directly into a column of a feature matrix.
+ */
+void _writePeakFeatures(Peak& p, float* features, size_t stride)
+{
+	float set[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
 	if (p.width > 0) {
 		set[0] = p.peakAreaFractional;
 		set[1] = p.noNoiseFraction;
@@ -75,6 +83,13 @@ vector<float> ClassifierNeuralNet::getFeatures(Peak& p) {
 		//cerr << "tiny=" << set[8] << " " << set[7] << " " << p.symmetry << endl;
 		//set[7] =  ((float) (p.baseLineRightCleanCount >= 5) +  (int) (p.baseLineLeftCleanCount >= 5))/2;
 	}
+	for (size_t i = 0; i < 9; i++)
+		features[i * stride] = set[i];
+}
+
+vector<float> ClassifierNeuralNet::getFeatures(Peak& p) {
+	vector<float> set(num_features, 0);
+	_writePeakFeatures(p, set.data(), 1);
 	return set;
 }
 
@@ -83,20 +98,54 @@ void ClassifierNeuralNet::classify(PeakGroup* grp) {
 	if (brain == NULL)
 		return;
 
-    for (unsigned int j=0; j < grp->peaks.size(); j++ ) {
-        grp->peaks[j].quality=scorePeak(grp->peaks[j]);
+	vector<Peak*> peaks;
+	for (auto& peak : grp->peaks)
+		peaks.push_back(&peak);
+	scorePeaks(peaks);
+}
+
+void ClassifierNeuralNet::classify(vector<PeakGroup*>& groups) {
+
+	if (brain == NULL)
+		return;
+
+	vector<Peak*> peaks;
+	for (auto group : groups) {
+		for (auto& peak : group->peaks)
+			peaks.push_back(&peak);
 	}
+	scorePeaks(peaks);
 }
 
 void ClassifierNeuralNet::scoreEICs(vector<EIC*> &eics)
 {
+	vector<Peak*> peaks;
+	for (auto eic : eics) {
+		for (auto& peak : eic->peaks)
+			peaks.push_back(&peak);
+	}
+	scorePeaks(peaks);
+}
 
-	for (unsigned int i = 0; i < eics.size(); i++)
-	{
-		for (unsigned int j = 0; j < eics[i]->peaks.size(); j++ ) {
-			eics[i]->peaks[j].quality = scorePeak(eics[i]->peaks[j]);
-		}
+void ClassifierNeuralNet::scorePeaks(vector<Peak*>& peaks)
+{
+	if (peaks.empty())
+		return;
+
+	if (brain == NULL) {
+		for (auto peak : peaks)
+			peak->quality = 0.1;
+		return;
 	}
+
+	size_t count = peaks.size();
+	vector<float> featureMatrix(num_features * count);
+	for (size_t i = 0; i < count; i++)
+		_writePeakFeatures(*peaks[i], &featureMatrix[i], count);
+
+	auto results = brain->runBatch(featureMatrix, count);
+	for (size_t i = 0; i < count; i++)
+		peaks[i]->quality = results[i];
 }
 
 float ClassifierNeuralNet::scorePeak(Peak& p) {
@@ -13,6 +13,13 @@ public:
 	ClassifierNeuralNet();
 	~ClassifierNeuralNet();
 	void classify(PeakGroup* grp);
+
+	/**
+	 * @brief Score all peaks of the given groups in a single pass through
+	 * the network.
+	 * @param groups Groups whose peaks will be assigned a quality.
+	 */
+	void classify(vector<PeakGroup*>& groups);
 	void train(vector<PeakGroup*>& groups);
 	void refineModel(PeakGroup* grp);
 	void saveModel(string filename);
@@ -21,6 +28,15 @@ public:
     vector<float> getFeatures(Peak& p);
 	float scorePeak(Peak& p);
 	void scoreEICs(vector<EIC*> &eics);
+
+	/**
+	 * @brief Score a batch of peaks, setting their quality.
+	 * @details Features of all peaks are gathered into one matrix, which is
+	 * then run through the network at once. The scores are identical to
+	 * those obtained from `scorePeak` for each peak.
+	 * @param peaks Peaks to be scored.
+	 */
+	void scorePeaks(vector<Peak*>& peaks);
 private:
 	
 
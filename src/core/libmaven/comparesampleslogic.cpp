@@ -1,3 +1,6 @@
+#include <numeric>
+#include <random>
+
 #include "comparesampleslogic.h"
 #include "mzSample.h"
 #include "mzUtils.h"
@@ -6,6 +9,89 @@
 CompareSamplesLogic::CompareSamplesLogic() {
 }
 
+// count, sum and sum of squares of a set of values
+struct _Moments {
+    int count;
+    double sum;
+    double sumSquares;
+};
+
+// same as `mzUtils::ttest`, from the moments of both sets, where variances
+// not above `minVariance` are replaced by 1, as `mzUtils::ttest` does for
+// zero standard deviations
+double _tTest(const _Moments& a, const _Moments& b, double minVariance)
+{
+    if (a.count == 0 && b.count == 0)
+        return 0;
+    if (a.count == 0 || b.count == 0)
+        return 1000;
+
+    auto variance = [minVariance](const _Moments& m) {
+        double var = 0;
+        if (m.count > 1)
+            var = (m.sumSquares - m.sum * m.sum / m.count) / (m.count - 1);
+        return var > minVariance ? var : 1.0;
+    };
+    double meanDiff = a.sum / a.count - b.sum / b.count;
+    return meanDiff / sqrt(variance(a) / a.count + variance(b) / b.count);
+}
+
+// absolute t-statistics of the first `n1` values against the remaining `n2`,
+// for the given values and for random permutations of them
+float _permutationScores(const float* values,
+                         int n1,
+                         int n2,
+                         int permutations,
+                         mt19937& generator,
+                         float* scores)
+{
+    // values are centred on their mean, which keeps their sums of squares
+    // accurate enough to derive variances from
+    int n = n1 + n2;
+    double mean = 0;
+    for (int i = 0; i < n; ++i)
+        mean += values[i];
+    mean /= n;
+
+    vector<double> centred(n);
+    _Moments a = {n1, 0, 0};
+    _Moments total = {n, 0, 0};
+    for (int i = 0; i < n; ++i) {
+        centred[i] = values[i] - mean;
+        total.sum += centred[i];
+        total.sumSquares += centred[i] * centred[i];
+        if (i < n1) {
+            a.sum += centred[i];
+            a.sumSquares += centred[i] * centred[i];
+        }
+    }
+    double minVariance = 1e-9 * total.sumSquares / n;
+    auto complement = [&](const _Moments& m) {
+        return _Moments{n - m.count,
+                        total.sum - m.sum,
+                        total.sumSquares - m.sumSquares};
+    };
+    float score = abs(_tTest(a, complement(a), minVariance));
+
+    // only the smaller set is drawn, by a partial Fisher-Yates shuffle that
+    // continues from the previous permutation, the larger set being the rest
+    int drawn = min(n1, n2);
+    vector<int> order(n);
+    iota(begin(order), end(order), 0);
+    for (int p = 0; p < permutations; ++p) {
+        _Moments smaller = {drawn, 0, 0};
+        for (int i = 0; i < drawn; ++i) {
+            uniform_int_distribution<int> pick(i, n - 1);
+            swap(order[i], order[pick(generator)]);
+            double value = centred[order[i]];
+            smaller.sum += value;
+            smaller.sumSquares += value * value;
+        }
+        scores[p] = abs(_tTest(smaller, complement(smaller), minVariance));
+    }
+    return score;
+}
+
 int CompareSamplesLogic::countBelow(vector<float>& y, float ymax)
 {
     vector<float> temp = y;
@@ -16,61 +102,6 @@ int CompareSamplesLogic::countBelow(vector<float>& y, float ymax)
 
 }
 
-void CompareSamplesLogic::shuffle(StatisticsVector<float>& groupA,
-		StatisticsVector<float>& groupB) {
-	int n1 = groupA.size();
-	int n2 = groupB.size();
-	int n3 = n1 + n2;
-	if (n1 == 0 || n2 == 0)
-		return;
-
-	//combine two sets
-	//cerr << "N3=" << n3 << endl;
-	StatisticsVector<float> groupC(n1 + n2);
-	for (int i = 0; i < n1; i++)
-		groupC[i] = groupA[i];
-	for (int i = 0; i < n2; i++)
-		groupC[n1 + i] = groupB[i];
-	//for(int i=0; i < n3; i++ ) cerr << groupC[i] << " "; cerr << endl;
-
-	//float realT = ttest(groupA,ratio>100groupB);
-
-	for (int s = 0; s < 10; s++) {
-		//shuffle combined set
-		for (int i = 0; i < n3; i++) {
-			int r = randInt(0,n3 - 1);
-			assert(r <= n3 - 1);
-			if (i == r)
-				continue;
-			float tmp = groupC[i];
-			groupC[i] = groupC[r];
-			groupC[r] = tmp; //swap
-		}
-
-		//split random vector
-		StatisticsVector<float> tmpA(n1);
-		StatisticsVector<float> tmpB(n2);
-		for (int i = 0; i < n1; i++)
-			tmpA[i] = groupC[i];
-		for (int i = 0; i < n2; i++)
-			tmpB[i] = groupC[n1 + i];
-
-		//for(int i=0; i < n1; i++ ) cerr << tmpA[i] << " "; cerr << endl;
-		//for(int i=0; i < n2; i++ ) cerr << tmpB[i] << " "; cerr << endl;
-
-		//ttest
-		float randT = abs(mzUtils::ttest(tmpA, tmpB));
-		//cerr << "RealT=" << realT << "  RandT=" << randT << endl;
-		rand_scores.push_back(randT);
-	}
-	/*
-	 std::sort(rand_scores.begin(), rand_scores.end());
-	 int rank = countBelow(rand_scores,  ttest(groupA,groupB));
-	 cerr << "Q=" << rank << " p-value=" << 1.0-(float) rank / rand_scores.size() << endl;
-	 */
-
-}
-
 void CompareSamplesLogic::FDRCorrection(QList<shared_ptr<PeakGroup>> allgroups,
                                         int correction)
 {
@@ -103,55 +134,99 @@ void CompareSamplesLogic::FDRCorrection(QList<shared_ptr<PeakGroup>> allgroups,
 void CompareSamplesLogic::computeMinPValue(QList<shared_ptr<PeakGroup>> allgroups) {
 
 	std::sort(rand_scores.begin(), rand_scores.end()); //sort random scores,
-    for (auto group : allgroups) {
+    int numGroups = allgroups.size();
+#pragma omp parallel for
+    for (int i = 0; i < numGroups; ++i) {
+        auto group = allgroups.at(i).get();
 		if (group->changeFoldRatio == 0)
 			continue;
-		int rank = countBelow(rand_scores, group->changePValue); //calculate p-value
-		//cerr << group->changePValue << " " <<  ((float) rank)/rand_scores.size() << endl;
+		//calculate p-value, random scores being sorted already
+		int rank = lower_bound(rand_scores.begin(),
+		                       rand_scores.end(),
+		                       group->changePValue)
+		           - rand_scores.begin();
 		group->changePValue = 1 - ((float) rank) / rand_scores.size();
-
 	}
 }
 
-void CompareSamplesLogic::computeStats(PeakGroup* group,
-		vector<mzSample*> sampleSet, vector<mzSample*> sset1,
-		vector<mzSample*> sset2, float _missingValue) {
-	group->changeFoldRatio = 0;		//TODO why?
-	group->changePValue = 1;		//TODO why?
-
-    //group->groupStatistics();
-	vector<float> yvalues = group->getOrderedIntensityVector(sampleSet,
-			PeakGroup::AreaTop);
-
-	StatisticsVector<float> groupA(sset1.size());
-	StatisticsVector<float> groupB(sset2.size());
-
-	// Was missing - Kiran
-	// TODO: misingSet1 and 2 is not used anywhere - Kiran
-    int missingSet1=0;
-	int missingSet2=0;
-	for(unsigned int i=0; i < sset1.size(); i++ ) { groupA[i]=yvalues[i]; if (groupA[i] == 0) missingSet1++; }
-	for(unsigned int i=0; i < sset2.size(); i++ ) { groupB[i]=yvalues[ sset1.size()+i ]; if (groupB[i] ==0 ) missingSet2++; }
-	
-	for (unsigned int i = 0; i < groupA.size(); i++)
-		if (groupA[i] < _missingValue)
-			groupA[i] = _missingValue;
-	for (unsigned int i = 0; i < groupB.size(); i++)
-		if (groupB[i] < _missingValue)
-			groupB[i] = _missingValue;
-
-    //skip empty
-	float meanA = abs(groupA.mean());
-	float meanB = abs(groupB.mean());
-
-    //Equation Updated -Kiran
-    if (meanA <= 0)
-		meanA = 1;
-	if (meanB <= 0)
-		meanB = 1;
-
-    //Equation Updated -Kiran
-    group->changeFoldRatio = log2(meanA/meanB);
-	group->changePValue = abs(mzUtils::ttest(groupA, groupB));
-	shuffle(groupA, groupB);
+float CompareSamplesLogic::tScore(const vector<float>& groupA,
+                                  const vector<float>& groupB)
+{
+    if (groupA.empty() && groupB.empty())
+        return 0;
+
+    vector<float> values(groupA);
+    values.insert(end(values), begin(groupB), end(groupB));
+    mt19937 generator;
+    return _permutationScores(values.data(),
+                              groupA.size(),
+                              groupB.size(),
+                              0,
+                              generator,
+                              nullptr);
+}
+
+void CompareSamplesLogic::compareGroups(
+    const QList<shared_ptr<PeakGroup>>& allgroups,
+    const vector<mzSample*>& sset1,
+    const vector<mzSample*>& sset2,
+    float missingValue,
+    int correction,
+    unsigned int seed,
+    int permutations)
+{
+    rand_scores.clear();
+    int n1 = sset1.size();
+    int n2 = sset2.size();
+    if (n1 == 0 || n2 == 0)
+        return;
+
+    // intensities of each group form a row of the matrix, with the samples
+    // of the first set followed by those of the second one
+    vector<mzSample*> sampleSet(sset1);
+    sampleSet.insert(end(sampleSet), begin(sset2), end(sset2));
+    auto sampleOrder = PeakGroup::sampleOrderTable(sampleSet);
+    int numGroups = allgroups.size();
+    int n = n1 + n2;
+    vector<float> intensities(static_cast<size_t>(numGroups) * n);
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int i = 0; i < numGroups; ++i) {
+        auto yvalues = allgroups.at(i)->getOrderedIntensityVector(
+            sampleOrder,
+            n,
+            PeakGroup::AreaTop);
+        float* row = intensities.data() + static_cast<size_t>(i) * n;
+        for (int j = 0; j < n; ++j)
+            row[j] = max(yvalues[j], missingValue);
+    }
+
+    rand_scores.resize(static_cast<size_t>(numGroups) * permutations);
+#pragma omp parallel for schedule(dynamic, 16)
+    for (int i = 0; i < numGroups; ++i) {
+        auto group = allgroups.at(i).get();
+        const float* row = intensities.data() + static_cast<size_t>(i) * n;
+
+        double sumA = accumulate(row, row + n1, 0.0);
+        double sumB = accumulate(row + n1, row + n, 0.0);
+        float meanA = abs(sumA / n1);
+        float meanB = abs(sumB / n2);
+        if (meanA <= 0)
+            meanA = 1;
+        if (meanB <= 0)
+            meanB = 1;
+        group->changeFoldRatio = log2(meanA / meanB);
+
+        seed_seq seeds = {seed, static_cast<unsigned int>(i)};
+        mt19937 generator(seeds);
+        size_t offset = static_cast<size_t>(i) * permutations;
+        group->changePValue = _permutationScores(row,
+                                                 n1,
+                                                 n2,
+                                                 permutations,
+                                                 generator,
+                                                 rand_scores.data() + offset);
+    }
+
+    computeMinPValue(allgroups);
+    FDRCorrection(allgroups, correction);
 }
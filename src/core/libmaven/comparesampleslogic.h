@@ -14,16 +14,46 @@ class CompareSamplesLogic {
 public:
 	CompareSamplesLogic();
 
-	void shuffle(StatisticsVector<float>& groupA,
-			StatisticsVector<float>& groupB);
     void FDRCorrection(QList<std::shared_ptr<PeakGroup> > allgroups, int correction);
     void computeMinPValue(QList<std::shared_ptr<PeakGroup> > allgroups);
-        void computeStats(PeakGroup* group, std::vector<mzSample*> sampleSet,
-                        std::vector<mzSample*> sset1, std::vector<mzSample*> sset2,
-			float _missingValue);
+
+    /**
+     * @brief Compare the intensities of all groups between two sets of
+     * samples, assigning each group its fold change and corrected p-value.
+     * @details Intensities of all groups are gathered into a single matrix,
+     * after which groups are compared in parallel. The p-value of a group is
+     * the fraction of t-statistics, over random permutations of the samples
+     * of all groups, that are at least as large as its own. Each group's
+     * permutations are drawn from a generator seeded with the given seed and
+     * the group's position, so that results do not depend on the number of
+     * threads used.
+     * @param allgroups Groups to be compared.
+     * @param sset1 Samples of the first set.
+     * @param sset2 Samples of the second set.
+     * @param missingValue Lower bound for intensities of either set.
+     * @param correction Type of multiple testing correction, as accepted by
+     * `FDRCorrection`.
+     * @param seed Seed for the random permutations.
+     * @param permutations Number of random permutations per group.
+     */
+    void compareGroups(const QList<std::shared_ptr<PeakGroup>>& allgroups,
+                       const std::vector<mzSample*>& sset1,
+                       const std::vector<mzSample*>& sset2,
+                       float missingValue,
+                       int correction,
+                       unsigned int seed = 0,
+                       int permutations = 10);
+
+    /**
+     * @brief Absolute t-statistic of two sets of values, computed in the
+     * same way as for the groups compared by `compareGroups`. This equals
+     * the absolute value of `mzUtils::ttest` up to rounding.
+     */
+    static float tScore(const std::vector<float>& groupA,
+                        const std::vector<float>& groupB);
+
         int countBelow(std::vector<float>& y, float ymax);
 	StatisticsVector<float> rand_scores;
 	StatisticsVector<float> real_scores;
-
 };
 #endif // COMPARESAMPLESLOGIC_H
@@ -0,0 +1,325 @@
+#include <numeric>
+#include <tuple>
+
+#include "compoundSearchIndex.h"
+
+// trigrams are keyed over a reduced alphabet of 64 symbols, collisions only
+// add candidates that are then rejected when verified
+const size_t _numTrigramKeys = 1 << 18;
+
+uint32_t _symbol(unsigned char c)
+{
+    if (c >= 'a' && c <= 'z')
+        return 1 + (c - 'a');
+    if (c >= '0' && c <= '9')
+        return 27 + (c - '0');
+    return 37 + c % 27;
+}
+
+uint32_t _trigramKey(const char* text)
+{
+    return (_symbol(text[0]) << 12)
+           | (_symbol(text[1]) << 6)
+           | _symbol(text[2]);
+}
+
+// only ASCII letters are folded, non-ASCII queries are not answered by the
+// index (see `CompoundSearchIndex::isLiteralQuery`)
+string _foldCase(const string& text)
+{
+    string folded(text);
+    for (auto& c : folded) {
+        if (c >= 'A' && c <= 'Z')
+            c = c - 'A' + 'a';
+    }
+    return folded;
+}
+
+size_t _find(const char* text,
+             size_t length,
+             const string& pattern,
+             size_t from)
+{
+    auto end = text + length;
+    auto match = search(text + from, end, begin(pattern), std::end(pattern));
+    if (match == end && !pattern.empty())
+        return string::npos;
+    return match - text;
+}
+
+size_t _findLast(const char* text, size_t length, const string& pattern)
+{
+    if (pattern.empty())
+        return length;
+    auto end = text + length;
+    auto match = find_end(text, end, begin(pattern), std::end(pattern));
+    if (match == end)
+        return string::npos;
+    return match - text;
+}
+
+vector<string> _querySegments(const string& query)
+{
+    vector<string> segments;
+    size_t begin = 0;
+    while (true) {
+        size_t end = query.find(".*", begin);
+        if (end == string::npos) {
+            segments.push_back(query.substr(begin));
+            break;
+        }
+        segments.push_back(query.substr(begin, end - begin));
+        begin = end + 2;
+    }
+    return segments;
+}
+
+void CompoundSearchIndex::addEntry(const string& name,
+                                   const string& id,
+                                   const string& formula,
+                                   const vector<string>& categories)
+{
+    _addField(name, Name);
+    _addField(id, Id);
+    _addField(formula, Formula);
+    for (const auto& category : categories)
+        _addField(category, Category);
+    _entryFields.push_back(_fields.size());
+
+    _postingsValid = false;
+    _lastMatchesValid = false;
+}
+
+void CompoundSearchIndex::clear()
+{
+    _text.clear();
+    _fields.clear();
+    _entryFields = {0};
+    _postingOffsets.clear();
+    _postings.clear();
+    _postingsValid = false;
+    _lastMatches.clear();
+    _lastMatchesValid = false;
+}
+
+void CompoundSearchIndex::_addField(const string& text, Field type)
+{
+    if (text.empty())
+        return;
+
+    FieldText field;
+    field.begin = _text.size();
+    field.length = text.size();
+    field.type = type;
+    _text.append(_foldCase(text));
+    _fields.push_back(field);
+}
+
+void CompoundSearchIndex::_buildPostings()
+{
+    // the trigrams of each entry are gathered twice, first to count the
+    // entries per trigram and then to place them, which avoids holding all
+    // (trigram, entry) pairs in memory at once
+    vector<uint32_t> keys;
+    vector<bool> seen(_numTrigramKeys, false);
+    auto entryKeys = [&](size_t entry) {
+        for (auto key : keys)
+            seen[key] = false;
+        keys.clear();
+        for (size_t f = _entryFields[entry]; f < _entryFields[entry + 1]; ++f) {
+            const auto& field = _fields[f];
+            const char* text = _text.data() + field.begin;
+            for (size_t i = 0; i + 3 <= field.length; ++i) {
+                uint32_t key = _trigramKey(text + i);
+                if (!seen[key]) {
+                    seen[key] = true;
+                    keys.push_back(key);
+                }
+            }
+        }
+    };
+
+    _postingOffsets.assign(_numTrigramKeys + 1, 0);
+    for (size_t entry = 0; entry < size(); ++entry) {
+        entryKeys(entry);
+        for (auto key : keys)
+            ++_postingOffsets[key + 1];
+    }
+    for (size_t key = 0; key < _numTrigramKeys; ++key)
+        _postingOffsets[key + 1] += _postingOffsets[key];
+
+    _postings.resize(_postingOffsets.back());
+    vector<uint32_t> cursors(begin(_postingOffsets), end(_postingOffsets) - 1);
+    for (size_t entry = 0; entry < size(); ++entry) {
+        entryKeys(entry);
+        for (auto key : keys)
+            _postings[cursors[key]++] = entry;
+    }
+    _postingsValid = true;
+}
+
+vector<uint32_t>
+CompoundSearchIndex::_candidates(const vector<string>& segments)
+{
+    if (!_postingsValid)
+        _buildPostings();
+
+    vector<uint32_t> keys;
+    for (const auto& segment : segments) {
+        for (size_t i = 0; i + 3 <= segment.size(); ++i)
+            keys.push_back(_trigramKey(segment.data() + i));
+    }
+    sort(begin(keys), end(keys));
+    keys.erase(unique(begin(keys), end(keys)), end(keys));
+
+    vector<uint32_t> candidates;
+    if (keys.empty()) {
+        candidates.resize(size());
+        iota(begin(candidates), end(candidates), 0);
+        return candidates;
+    }
+
+    // intersect postings starting from the shortest one
+    auto postingSize = [this](uint32_t key) {
+        return _postingOffsets[key + 1] - _postingOffsets[key];
+    };
+    sort(begin(keys), end(keys), [&](uint32_t a, uint32_t b) {
+        return postingSize(a) < postingSize(b);
+    });
+    candidates.assign(begin(_postings) + _postingOffsets[keys[0]],
+                      begin(_postings) + _postingOffsets[keys[0] + 1]);
+    vector<uint32_t> intersection;
+    for (size_t k = 1; k < keys.size() && !candidates.empty(); ++k) {
+        intersection.clear();
+        set_intersection(begin(candidates),
+                         end(candidates),
+                         begin(_postings) + _postingOffsets[keys[k]],
+                         begin(_postings) + _postingOffsets[keys[k] + 1],
+                         back_inserter(intersection));
+        candidates.swap(intersection);
+    }
+    return candidates;
+}
+
+bool CompoundSearchIndex::_matchEntry(size_t entry,
+                                      const vector<string>& segments,
+                                      int fields,
+                                      RankedMatch& ranked) const
+{
+    for (int type : {Name, Id, Formula, Category}) {
+        if (!(fields & type))
+            continue;
+
+        for (size_t f = _entryFields[entry]; f < _entryFields[entry + 1]; ++f) {
+            const auto& field = _fields[f];
+            if (field.type != type)
+                continue;
+
+            // the first segment is matched at its leftmost occurrence and
+            // the ones in between as early as possible after it, while
+            // ".*" being greedy stretches the match up to the rightmost
+            // occurrence of the last segment
+            const char* text = _text.data() + field.begin;
+            size_t start = _find(text, field.length, segments[0], 0);
+            if (start == string::npos)
+                continue;
+
+            size_t end = start + segments[0].size();
+            bool found = true;
+            for (size_t s = 1; s + 1 < segments.size() && found; ++s) {
+                size_t position = _find(text, field.length, segments[s], end);
+                found = position != string::npos;
+                end = position + segments[s].size();
+            }
+            if (!found)
+                continue;
+
+            if (segments.size() > 1) {
+                const string& last = segments.back();
+                size_t position = _findLast(text, field.length, last);
+                if (position == string::npos || position < end)
+                    continue;
+                end = position + last.size();
+            }
+
+            ranked.match.entry = entry;
+            ranked.match.field = field.type;
+            ranked.match.position = start;
+            ranked.match.length = end - start;
+            ranked.fieldLength = field.length;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CompoundSearchIndex::isLiteralQuery(const string& query)
+{
+    const string special = "\\^$.|?*+()[]{}";
+    for (size_t i = 0; i < query.size(); ++i) {
+        if (static_cast<unsigned char>(query[i]) >= 0x80)
+            return false;
+        if (special.find(query[i]) == string::npos)
+            continue;
+        if (query[i] == '.' && i + 1 < query.size() && query[i + 1] == '*') {
+            ++i;
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
+
+vector<CompoundSearchIndex::Match>
+CompoundSearchIndex::search(const string& query, int fields, size_t limit)
+{
+    string folded = _foldCase(query);
+    auto segments = _querySegments(folded);
+
+    vector<RankedMatch> matches;
+    RankedMatch ranked;
+    if (_lastMatchesValid
+        && fields == _lastFields
+        && folded.compare(0, _lastQuery.size(), _lastQuery) == 0) {
+        // anything matching an extension of the last query also matched it
+        for (const auto& last : _lastMatches) {
+            if (_matchEntry(last.match.entry, segments, fields, ranked))
+                matches.push_back(ranked);
+        }
+    } else {
+        for (auto entry : _candidates(segments)) {
+            if (_matchEntry(entry, segments, fields, ranked))
+                matches.push_back(ranked);
+        }
+    }
+    _lastQuery = folded;
+    _lastFields = fields;
+    _lastMatches = matches;
+    _lastMatchesValid = true;
+
+    auto rankedBefore = [](const RankedMatch& a, const RankedMatch& b) {
+        return make_tuple(a.match.position != 0,
+                          a.match.field,
+                          a.fieldLength,
+                          a.match.entry)
+               < make_tuple(b.match.position != 0,
+                            b.match.field,
+                            b.fieldLength,
+                            b.match.entry);
+    };
+    if (limit > 0 && limit < matches.size()) {
+        partial_sort(begin(matches),
+                     begin(matches) + limit,
+                     end(matches),
+                     rankedBefore);
+        matches.resize(limit);
+    } else {
+        sort(begin(matches), end(matches), rankedBefore);
+    }
+
+    vector<Match> results;
+    results.reserve(matches.size());
+    for (const auto& match : matches)
+        results.push_back(match.match);
+    return results;
+}
@@ -0,0 +1,125 @@
+#ifndef COMPOUNDSEARCHINDEX_H
+#define COMPOUNDSEARCHINDEX_H
+
+#include "standardincludes.h"
+
+using namespace std;
+
+/**
+ * @brief The CompoundSearchIndex class answers case-insensitive substring
+ * queries over the names, IDs, formulae and categories of a compound library.
+ * @details Each entry's fields are stored case-folded and every trigram
+ * occurring in them is indexed, so that a query only needs to verify entries
+ * that contain all of its trigrams. Queries are literal text, optionally
+ * split by ".*" into segments that must occur in order within a single field,
+ * which is the subset of regular expressions the search boxes generate when
+ * users type words separated by spaces. The index is built lazily, on the
+ * first search after entries were added, and is not safe to be searched from
+ * multiple threads at once.
+ */
+class CompoundSearchIndex
+{
+public:
+    enum Field {
+        Name = 1,
+        Id = 2,
+        Formula = 4,
+        Category = 8,
+        AllFields = Name | Id | Formula | Category
+    };
+
+    /**
+     * @brief Location of a query's match within an entry. The position and
+     * length are in bytes and correspond to the leftmost (and for ".*",
+     * longest) match that a regular expression would have found.
+     */
+    struct Match {
+        size_t entry;
+        Field field;
+        size_t position;
+        size_t length;
+    };
+
+    /**
+     * @brief Add an entry to the index, which will be identified by the
+     * number of entries added before it.
+     */
+    void addEntry(const string& name,
+                  const string& id,
+                  const string& formula,
+                  const vector<string>& categories);
+
+    /**
+     * @brief Remove all entries.
+     */
+    void clear();
+
+    /**
+     * @brief Number of entries added so far.
+     */
+    size_t size() const { return _entryFields.size() - 1; }
+
+    /**
+     * @brief Check whether a query can be answered by this index. Queries
+     * containing regular expression syntax, other than ".*" between
+     * segments of text, need to be matched by the caller itself.
+     * @details Case is only folded for ASCII letters, so queries containing
+     * any non-ASCII character are also left to the caller, to be matched
+     * with a Unicode-aware case-insensitive search.
+     */
+    static bool isLiteralQuery(const string& query);
+
+    /**
+     * @brief Find entries that match the given literal query.
+     * @details Matches are ranked by whether they occur at the start of a
+     * field, then by the field they were found in (in the order of `Field`),
+     * then by the length of that field and lastly by the order in which
+     * entries were added. A query that extends the previous one is only
+     * verified against the matches of the previous query.
+     * @param query Literal query, as accepted by `isLiteralQuery`.
+     * @param fields Bitwise OR of the fields to be searched.
+     * @param limit Maximum number of matches to return, zero for all.
+     * @return Best matches, in order of their rank.
+     */
+    vector<Match> search(const string& query,
+                         int fields = AllFields,
+                         size_t limit = 0);
+
+private:
+    struct FieldText {
+        uint32_t begin;
+        uint32_t length;
+        Field type;
+    };
+
+    string _text;
+    vector<FieldText> _fields;
+    vector<size_t> _entryFields = {0};
+
+    // trigram postings, stored as offsets into a single array of entries
+    bool _postingsValid = false;
+    vector<uint32_t> _postingOffsets;
+    vector<uint32_t> _postings;
+
+    struct RankedMatch {
+        Match match;
+        uint32_t fieldLength;
+    };
+
+    // matches of the last query, in the order of entries, used to narrow
+    // down the candidates of the next one
+    string _lastQuery;
+    int _lastFields = 0;
+    vector<RankedMatch> _lastMatches;
+    bool _lastMatchesValid = false;
+
+    void _addField(const string& text, Field type);
+    void _buildPostings();
+    vector<uint32_t> _candidates(const vector<string>& segments);
+    bool _matchEntry(size_t entry,
+                     const vector<string>& segments,
+                     int fields,
+                     RankedMatch& match) const;
+};
+
+#endif  // COMPOUNDSEARCHINDEX_H
@@ -1,3 +1,6 @@
+#include <clocale>
+#include <cstdint>
+
 #include "doctest.h"
 #include "testUtils.h"
 #include "csvreports.h"
@@ -25,6 +28,7 @@ CSVReports::CSVReports(string filename,
     samples = insamples;
     _pollyExport = pollyExport;
     sort(samples.begin(), samples.end(), mzSample::compSampleOrder);
+    _indexSampleColumns();
     errorReport = "";
     mavenparameters = mp;
     _qtype = quantType;
@@ -193,14 +197,189 @@ void CSVReports::addGroup(PeakGroup* group)
             _writeGroupInfo(subGroup.get());
         for (auto subGroup : group->childAdducts())
             _writeGroupInfo(subGroup.get());
+        if (_reportStream.is_open())
+            _reportStream.flush();
+    }
+}
+
+void CSVReports::addGroups(const vector<PeakGroup*>& groups)
+{
+    if (_reportType != ReportType::GroupReport) {
+        for (auto group : groups)
+            addGroup(group);
+        return;
+    }
+
+    if (!_reportStream.is_open())
+        return;
+
+    vector<PeakGroup*> rowGroups;
+    for (auto group : groups) {
+        rowGroups.push_back(group);
+        for (auto subGroup : group->childIsotopes())
+            rowGroups.push_back(subGroup.get());
+        for (auto subGroup : group->childAdducts())
+            rowGroups.push_back(subGroup.get());
+    }
+
+    // rows are formatted in parallel, one block at a time, and then written
+    // in their original order
+    const int blockSize = 4096;
+    vector<string> rows(min(rowGroups.size(), static_cast<size_t>(blockSize)));
+    for (size_t blockStart = 0;
+         blockStart < rowGroups.size();
+         blockStart += blockSize) {
+        int blockEnd = static_cast<int>(min(rowGroups.size(),
+                                            blockStart + blockSize));
+        int rowCount = blockEnd - static_cast<int>(blockStart);
+#pragma omp parallel for schedule(dynamic, 64)
+        for (int i = 0; i < rowCount; ++i)
+            rows[i] = _groupInfoRow(rowGroups[blockStart + i]);
+
+        for (int i = 0; i < rowCount; ++i)
+            _reportStream << rows[i];
+    }
+    _reportStream.flush();
+}
+
+void CSVReports::_indexSampleColumns()
+{
+    _sampleOrder = PeakGroup::sampleOrderTable(samples);
+    _sampleColumnsByName.clear();
+    for (size_t i = 0; i < samples.size(); ++i)
+        _sampleColumnsByName[samples[i]->sampleName].push_back(i);
+
+    struct lconv* localeInfo = localeconv();
+    _localeDecimalPoint = localeInfo->decimal_point;
+}
+
+void CSVReports::_appendFixed(string& row, double value, int precision) const
+{
+    char buffer[64];
+    int length = snprintf(buffer, sizeof(buffer), "%.*f", precision, value);
+    if (length < 0)
+        return;
+
+    string number;
+    if (length < static_cast<int>(sizeof(buffer))) {
+        number.assign(buffer, length);
+    } else {
+        number.resize(length + 1);
+        snprintf(&number[0], number.size(), "%.*f", precision, value);
+        number.resize(length);
+    }
+
+    // stream insertion always uses the classic "C" locale, and so must we
+    if (!_localeDecimalPoint.empty() && _localeDecimalPoint != ".") {
+        auto pointAt = number.find(_localeDecimalPoint);
+        if (pointAt != string::npos)
+            number.replace(pointAt, _localeDecimalPoint.size(), ".");
+    }
+    row += number;
+}
+
+void CSVReports::_appendFixed(string& row, float value, int precision) const
+{
+    static const uint64_t powersOfTen[] = {1, 10, 100, 1000, 10000, 100000,
+                                           1000000};
+    if (precision < 0 || precision > 6) {
+        _appendFixed(row, static_cast<double>(value), precision);
+        return;
+    }
+
+    // a float is exactly `mantissa * 2^shift`, which allows us to scale it by
+    // the required power of ten and round it (half to even, like printf) using
+    // integer arithmetic alone
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bool negative = (bits >> 31) != 0;
+    int exponent = (bits >> 23) & 0xff;
+    uint64_t mantissa = bits & 0x7fffff;
+    if (exponent == 0xff || exponent - 150 > 16) {
+        _appendFixed(row, static_cast<double>(value), precision);
+        return;
+    }
+    if (exponent == 0) {
+        exponent = 1;
+    } else {
+        mantissa |= 0x800000;
+    }
+
+    int shift = exponent - 150;
+    uint64_t scaled = mantissa * powersOfTen[precision];
+    uint64_t quotient = 0;
+    if (shift >= 0) {
+        quotient = scaled << shift;
+    } else if (-shift < 64) {
+        int k = -shift;
+        quotient = scaled >> k;
+        uint64_t remainder = scaled & ((uint64_t(1) << k) - 1);
+        uint64_t half = uint64_t(1) << (k - 1);
+        if (remainder > half || (remainder == half && (quotient & 1)))
+            ++quotient;
+    }
+
+    char digits[24];
+    int numDigits = 0;
+    do {
+        digits[numDigits++] = '0' + quotient % 10;
+        quotient /= 10;
+    } while (quotient > 0);
+    while (numDigits <= precision)
+        digits[numDigits++] = '0';
+
+    if (negative)
+        row += '-';
+    for (int i = numDigits - 1; i >= precision; --i)
+        row += digits[i];
+    if (precision > 0) {
+        row += '.';
+        for (int i = precision - 1; i >= 0; --i)
+            row += digits[i];
     }
 }
 
+vector<bool> CSVReports::_sampleColumnsInGroup(PeakGroup* group) const
+{
+    vector<bool> present(samples.size(), false);
+    for (auto sample : group->samples) {
+        auto columnsAt = _sampleColumnsByName.find(sample->sampleName);
+        if (columnsAt == _sampleColumnsByName.end())
+            continue;
+        for (auto column : columnsAt->second)
+            present[column] = true;
+    }
+    return present;
+}
+
 void CSVReports::_writeGroupInfo(PeakGroup* group)
 {
     if (!_reportStream.is_open())
         return;
 
+    _reportStream << _groupInfoRow(group);
+}
+
+string CSVReports::_groupInfoRow(PeakGroup* group)
+{
+    string row;
+
+    // a sample column is written only if the group has any samples at all,
+    // with "NA" for samples that did not participate in the group
+    auto appendSampleValues = [&](const vector<float>& values) {
+        if (group->samples.empty())
+            return;
+        auto present = _sampleColumnsInGroup(group);
+        for (size_t j = 0; j < samples.size(); j++) {
+            row += SEP;
+            if (present[j]) {
+                _appendFixed(row, values[j], 2);
+            } else {
+                row += "NA";
+            }
+        }
+    };
+
     // for exports to Polly, add empty ghost parents as well
     if (group->isGhost() && group->hasCompoundLink() && _pollyExport) {
         auto compoundName = _sanitizeString(
@@ -216,46 +395,38 @@ void CSVReports::_writeGroupInfo(PeakGroup* group)
                 adduct = parentAdduct;
             }
         }
-        _reportStream << ""
-                      << SEP << group->metaGroupId()
-                      << SEP << group->groupId()
-                      << SEP << 0
-                      << fixed << setprecision(6)
-                      << SEP << 0.0
-                      << setprecision(3)
-                      << SEP << 0.0
-                      << setprecision(6)
-                      << SEP << 0.0
-                      << SEP << (adduct == nullptr ? "" : adduct->getName())
-                      << SEP << "C12 PARENT"
-                      << SEP << compoundName
-                      << SEP << compoundId
-                      << SEP << compoundFormula
-                      << SEP << "NA"
-                      << SEP << "NA"
-                      << SEP << 0.0;
+        row += SEP + to_string(group->metaGroupId());
+        row += SEP + to_string(group->groupId());
+        row += SEP + "0";
+        row += SEP;
+        _appendFixed(row, 0.0, 6);
+        row += SEP;
+        _appendFixed(row, 0.0, 3);
+        row += SEP;
+        _appendFixed(row, 0.0, 6);
+        row += SEP + (adduct == nullptr ? "" : adduct->getName());
+        row += SEP + "C12 PARENT";
+        row += SEP + compoundName;
+        row += SEP + compoundId;
+        row += SEP + compoundFormula;
+        row += SEP + "NA";
+        row += SEP + "NA";
+        row += SEP;
+        _appendFixed(row, 0.0, 6);
 
         // if this is a MS2 report, add MS2 specific columns
         if (_prmReport && !_pollyExport) {
-            for (int i = 0; i < 10; ++i)
-                _reportStream << SEP <<  0.0;
-        }
-
-        _reportStream << setprecision(2);
-        for (unsigned int j = 0; j < samples.size(); j++) {
-            for (int i = 0; i < static_cast<int>(group->samples.size()); ++i) {
-                if (samples[j]->sampleName == group->samples[i]->sampleName) {
-                    _reportStream << SEP << 0.0;
-                    break;
-                } else if (i == static_cast<int>(group->samples.size()) - 1) {
-                    _reportStream << SEP << "NA";
-                }
+            for (int i = 0; i < 10; ++i) {
+                row += SEP;
+                _appendFixed(row, 0.0, 6);
             }
         }
-        _reportStream << endl;
-        return;
+
+        appendSampleValues(vector<float>(samples.size(), 0.0f));
+        row += "\n";
+        return row;
     } else if (group->isGhost()) {
-        return;
+        return row;
     }
 
     char label = group->label;
@@ -263,39 +434,39 @@ void CSVReports::_writeGroupInfo(PeakGroup* group)
         label = group->parent->label;
     if (selectionFlag == 2) {
         if (label != 'g')
-            return;
+            return row;
     } else if (selectionFlag == 3) {
         if (label != 'b')
-            return;
+            return row;
     } else if (selectionFlag == 4) {
         if (label == 'b')
-            return;
+            return row;
     }
 
-    vector<float> yvalues = group->getOrderedIntensityVector(samples, _qtype);
+    vector<float> yvalues = group->getOrderedIntensityVector(_sampleOrder,
+                                                             samples.size(),
+                                                             _qtype);
 
     string tagString = group->srmId + group->tagString;
     tagString = _sanitizeString(tagString.c_str()).toStdString();
 
-    char labelStr[2];
-    sprintf(labelStr, "%c", group->label);
-
     string adductName = "";
     if (group->adduct() != nullptr && !group->isIsotope())
         adductName = group->adduct()->getName();
 
-    _reportStream << labelStr
-                  << SEP << group->metaGroupId()
-                  << SEP << group->groupId()
-                  << SEP << group->goodPeakCount
-                  << fixed << setprecision(6)
-                  << SEP << group->meanMz
-                  << setprecision(3)
-                  << SEP << group->meanRt
-                  << setprecision(6)
-                  << SEP << group->maxQuality
-                  << SEP << adductName
-                  << SEP << tagString;
+    if (group->label != '\0')
+        row += group->label;
+    row += SEP + to_string(group->metaGroupId());
+    row += SEP + to_string(group->groupId());
+    row += SEP + to_string(group->goodPeakCount);
+    row += SEP;
+    _appendFixed(row, group->meanMz, 6);
+    row += SEP;
+    _appendFixed(row, group->meanRt, 3);
+    row += SEP;
+    _appendFixed(row, group->maxQuality, 6);
+    row += SEP + adductName;
+    row += SEP + tagString;
 
     string compoundName = "";
     string compoundID = "";
@@ -329,50 +500,44 @@ void CSVReports::_writeGroupInfo(PeakGroup* group)
     string expRtString = expectedRtDiff < 0.0f ? "NA"
                                                : to_string(expectedRtDiff);
     string ppmDistString = ppmDist < 0.0f ? "NA" : to_string(ppmDist);
-    _reportStream << SEP << compoundName
-                  << SEP << compoundID
-                  << SEP << formula
-                  << setprecision(3)
-                  << SEP << expRtString
-                  << setprecision(6)
-                  << SEP << ppmDistString;
+    row += SEP + compoundName;
+    row += SEP + compoundID;
+    row += SEP + formula;
+    row += SEP + expRtString;
+    row += SEP + ppmDistString;
 
+    row += SEP;
     if (group->parent != NULL) {
-        _reportStream << SEP << group->parent->meanMz;
+        _appendFixed(row, group->parent->meanMz, 6);
     } else {
-        _reportStream << SEP << group->meanMz;
+        _appendFixed(row, group->meanMz, 6);
     }
 
     if (group->getCompound()
         && group->getCompound()->type() == Compound::Type::MS2
         && !_pollyExport) {
-        _reportStream << SEP << group->ms2EventCount
-                      << SEP << group->fragMatchScore.numMatches
-                      << SEP << group->fragMatchScore.fractionMatched
-                      << SEP << group->fragMatchScore.ticMatched
-                      << SEP << group->fragMatchScore.dotProduct
-                      << SEP << group->fragMatchScore.weightedDotProduct
-                      << SEP << group->fragMatchScore.hypergeomScore
-                      << SEP << group->fragMatchScore.spearmanRankCorrelation
-                      << SEP << group->fragMatchScore.mzFragError
-                      << SEP << group->fragmentationPattern.purity;
+        row += SEP + to_string(group->ms2EventCount);
+        for (double score : {group->fragMatchScore.numMatches,
+                             group->fragMatchScore.fractionMatched,
+                             group->fragMatchScore.ticMatched,
+                             group->fragMatchScore.dotProduct,
+                             group->fragMatchScore.weightedDotProduct,
+                             group->fragMatchScore.hypergeomScore,
+                             group->fragMatchScore.spearmanRankCorrelation,
+                             group->fragMatchScore.mzFragError,
+                             static_cast<double>(
+                                 group->fragmentationPattern().purity)}) {
+            row += SEP;
+            _appendFixed(row, score, 6);
+        }
     }
 
     // for intensity values, we only write two digits of floating point
     // precision since these values are supposed to be large (in the order of
     // >10^3).
-    _reportStream << setprecision(2);
-    for (unsigned int j = 0; j < samples.size(); j++) {
-        for (int i = 0; i < static_cast<int>(group->samples.size()); ++i) {
-            if (samples[j]->sampleName == group->samples[i]->sampleName) {
-                _reportStream << SEP << yvalues[j];
-                break;
-            } else if (i == static_cast<int>(group->samples.size()) - 1) {
-                _reportStream << SEP << "NA";
-            }
-        }
-    }
-    _reportStream << endl;
+    appendSampleValues(yvalues);
+    row += "\n";
+    return row;
 }
 
 void CSVReports::_writePeakInfo(PeakGroup* group)
@@ -799,6 +964,56 @@ TEST_CASE_FIXTURE(SampleLoadingFixture, "Testing CSV reports")
         remove("peakReport.csv");
     }
 
+    SUBCASE("Testing batched group report")
+    {
+        targetedGroup();
+        auto sample = samples();
+        auto mavenparameter = mavenparameters();
+        auto allgroup = allgroups();
+        vector<PeakGroup*> groups;
+        for (auto& group : allgroup)
+            groups.push_back(&group);
+
+        {
+            CSVReports csvReports("groupReport.csv",
+                                  CSVReports::ReportType::GroupReport,
+                                  sample,
+                                  PeakGroup::AreaTop,
+                                  false,
+                                  true,
+                                  mavenparameter);
+            csvReports.setSelectionFlag(1);
+            for (auto group : groups)
+                csvReports.addGroup(group);
+        }
+        {
+            CSVReports csvReports("batchGroupReport.csv",
+                                  CSVReports::ReportType::GroupReport,
+                                  sample,
+                                  PeakGroup::AreaTop,
+                                  false,
+                                  true,
+                                  mavenparameter);
+            csvReports.setSelectionFlag(1);
+            csvReports.addGroups(groups);
+        }
+
+        // both reports should be byte-identical
+        ifstream groupFile("groupReport.csv", ios::binary);
+        ifstream batchGroupFile("batchGroupReport.csv", ios::binary);
+        stringstream groupContents;
+        stringstream batchGroupContents;
+        groupContents << groupFile.rdbuf();
+        batchGroupContents << batchGroupFile.rdbuf();
+        REQUIRE(!groupContents.str().empty());
+        REQUIRE(groupContents.str() == batchGroupContents.str());
+
+        groupFile.close();
+        batchGroupFile.close();
+        remove("groupReport.csv");
+        remove("batchGroupReport.csv");
+    }
+
     SUBCASE("Testing write for polly")
     {
         targetedGroup();
@@ -4,6 +4,8 @@
 #include <QString>
 #include <QStringList>
 
+#include <unordered_map>
+
 #include "PeakGroup.h"
 
 using namespace std;
@@ -77,6 +79,17 @@ class CSVReports
          */
         void addGroup(PeakGroup* group);
 
+        /**
+         * @brief Add a number of groups (along with their children) to the
+         * report at once.
+         * @details For group reports, rows are formatted on multiple threads
+         * and written in the same order as they would have been by calling
+         * `addGroup` for each of the groups. The output is flushed only once,
+         * at the end.
+         * @param groups Top-level groups to be written.
+         */
+        void addGroups(const vector<PeakGroup*>& groups);
+
         QString getErrorReport(void)
         {
             /**
@@ -109,6 +122,14 @@ class CSVReports
          *@brief-  helper function to write group info
          */
         void _writeGroupInfo(PeakGroup* group);
+
+        /**
+         * @brief Format the group report row for the given group.
+         * @return The row, including its line ending. An empty string is
+         * returned if the group should not be reported.
+         */
+        string _groupInfoRow(PeakGroup* group);
+
         /**
          *@brief-  helper function to write peak info
          */
@@ -149,6 +170,33 @@ class CSVReports
          */
         vector<mzSample*> samples;
 
+        /**
+         * @brief Column index of each report sample, and the columns for each
+         * sample name, built once per report.
+         */
+        vector<int> _sampleOrder;
+        unordered_map<string, vector<size_t>> _sampleColumnsByName;
+
+        /**
+         * @brief Decimal point of the C library's current locale, which has to
+         * be replaced when formatting numbers with `snprintf`.
+         */
+        string _localeDecimalPoint = ".";
+
+        void _indexSampleColumns();
+
+        /**
+         * @brief Append a number in fixed notation, exactly as a stream with
+         * `fixed` and `setprecision(precision)` would have written it.
+         */
+        void _appendFixed(string& row, double value, int precision) const;
+        void _appendFixed(string& row, float value, int precision) const;
+
+        /**
+         * @brief Find the report columns of samples that are part of a group.
+         */
+        vector<bool> _sampleColumnsInGroup(PeakGroup* group) const;
+
         /**
          *@param -  user quant type, represents intensity of peaks
          */
@@ -1,3 +1,6 @@
+#include <cstdint>
+#include <QFile>
+
 #include "doctest.h"
 #include "Compound.h"
 #include "constants.h"
@@ -13,20 +16,51 @@ using namespace mzUtils;
 
 void Database::removeDatabase(string dbName)
 {
-    auto iter = begin(_compoundsDB);
-    while (iter < end(_compoundsDB)) {
-        auto compound = *iter;
-        if (compound->db() == dbName) {
-            _compoundIdenticalCount.erase(compound->id() + compound->name() + dbName);
-            _compoundIdNameDbMap.erase(compound->id() + compound->name() + dbName);
-            iter = _compoundsDB.erase(iter);
-            delete compound;
-        } else {
-            ++iter;
-        }
+    auto partition = _partitions.find(dbName);
+    if (partition == end(_partitions))
+        return;
+
+    set<Compound*> removed(begin(partition->second.compounds),
+                           end(partition->second.compounds));
+    auto isRemoved = [&removed](Compound* compound) {
+        return removed.count(compound) > 0;
+    };
+    _compoundsDB.erase(remove_if(begin(_compoundsDB),
+                                 end(_compoundsDB),
+                                 isRemoved),
+                       end(_compoundsDB));
+    _compoundsWithZeroCharge.erase(remove_if(begin(_compoundsWithZeroCharge),
+                                             end(_compoundsWithZeroCharge),
+                                             isRemoved),
+                                   end(_compoundsWithZeroCharge));
+    _partitions.erase(partition);
+
+    for (auto compound : removed) {
+        _compoundIdenticalCount.erase(compound->id() + compound->name() + dbName);
+        _compoundIdNameDbMap.erase(compound->id() + compound->name() + dbName);
+        delete compound;
     }
 }
 
+void Database::_indexCompound(Compound* compound)
+{
+    auto& partition = _partitions[compound->db()];
+    partition.compounds.push_back(compound);
+    partition.byId[compound->id()].push_back(compound);
+    partition.byName[compound->name()].push_back(compound);
+    partition.searchIndex.addEntry(compound->name(),
+                                   compound->id(),
+                                   compound->formula(),
+                                   compound->category());
+}
+
+void Database::_rebuildIndexes()
+{
+    _partitions.clear();
+    for (auto compound : _compoundsDB)
+        _indexCompound(compound);
+}
+
 Adduct* Database::findAdductByName(string name)
 {
     if(name == "[M+H]+") {
@@ -121,6 +155,7 @@ bool Database::addCompound(Compound* newCompound)
                         + newCompound->name()
                         + newCompound->db()] = newCompound;
     _compoundsDB.push_back(newCompound);
+    _indexCompound(newCompound);
     if (newCompound->charge() == 0)
         _compoundsWithZeroCharge.push_back(newCompound);
     return true;
@@ -136,35 +171,65 @@ Compound* Database::findSpeciesByIdAndName(string id,
 }
 
 vector<Compound*> Database::findSpeciesById(string id, string dbName) {
-    vector<Compound*> matches;
+    auto partition = _partitions.find(dbName);
+    if (partition == end(_partitions))
+        return {};
+
+    auto matches = partition->second.byId.find(id);
+    if (matches == end(partition->second.byId))
+        return {};
+    return matches->second;
+}
+
+vector<Compound*> Database::findSpeciesByName(string name, string dbname)
+{
+    auto partition = _partitions.find(dbname);
+    if (partition == end(_partitions))
+        return {};
+
+    auto matches = partition->second.byName.find(name);
+    if (matches == end(partition->second.byName))
+        return {};
+    return matches->second;
+}
+
+set<Compound*> Database::findSpeciesByMass(float mz, MassCutoff* massCutoff)
+{
+    set<Compound*> matches;
+    float cutoff = static_cast<float>(massCutoff->massCutoffValue(mz));
+    float mzMin = mz - cutoff;
+    float mzMax = mz + cutoff;
     for (auto compound : _compoundsDB) {
-        if (compound->id() == id && compound->db() == dbName) {
-            matches.push_back(compound);
-        }
+        if (compound->mz() >= mzMin && compound->mz() <= mzMax)
+            matches.insert(compound);
     }
-
     return matches;
 }
 
-vector<Compound*> Database::findSpeciesByName(string name, string dbname)
+vector<pair<Compound*, CompoundSearchIndex::Match>>
+Database::searchCompounds(string query,
+                          string dbName,
+                          int fields,
+                          size_t limit)
 {
-    vector<Compound*> set;
-    for (unsigned int i = 0; i < _compoundsDB.size(); i++) {
-        if (_compoundsDB[i]->name() == name && _compoundsDB[i]->db() == dbname) {
-            set.push_back(_compoundsDB[i]);
-        }
-    }
-    return set;
+    vector<pair<Compound*, CompoundSearchIndex::Match>> results;
+    auto partition = _partitions.find(dbName);
+    if (partition == end(_partitions))
+        return results;
+
+    auto& compounds = partition->second.compounds;
+    auto matches = partition->second.searchIndex.search(query, fields, limit);
+    results.reserve(matches.size());
+    for (const auto& match : matches)
+        results.push_back(make_pair(compounds[match.entry], match));
+    return results;
 }
 
 vector<Compound*> Database::getCompoundsSubset(string dbname) {
-	vector<Compound*> subset;
-	for (unsigned int i=0; i < _compoundsDB.size(); i++ ) {
-        if (_compoundsDB[i]->db() == dbname) {
-		    subset.push_back(_compoundsDB[i]);
-		}
-	}
-	return subset;
+    auto partition = _partitions.find(dbname);
+    if (partition == end(_partitions))
+        return {};
+    return partition->second.compounds;
 }
 
 vector<Compound*> Database::getKnowns() {
@@ -172,34 +237,13 @@ vector<Compound*> Database::getKnowns() {
 }
 
 map<string,int> Database::getDatabaseNames() {
-	map<string,int>dbnames;
-        for (unsigned int i=0; i < _compoundsDB.size(); i++ )
-            dbnames[ _compoundsDB[i]->db() ]++;
-	return dbnames;
+    map<string,int>dbnames;
+    for (const auto& partition : _partitions)
+        dbnames[partition.first] = partition.second.compounds.size();
+    return dbnames;
 }
 
 
-bool Database::_startsWith(string line, string text)
-{
-    transform(line.begin(), line.end(), line.begin(), ::tolower);
-    transform(text.begin(), text.end(), text.begin(), ::tolower);
-    for( size_t i = 0; i < text.size(); i++){
-        if(line[i] != text[i])
-            return false;
-    }
-    return true;
-}
-
-bool Database::_contain(string line, string text)
-{
-    transform(line.begin(), line.end(), line.begin(), ::tolower);
-    transform(text.begin(), text.end(), text.begin(), ::tolower);
-    if(boost::algorithm::contains(line, text))
-        return true;
-    else
-        return false;
-}
-
 bool Database::isSpectralLibrary(string dbName) {
     auto compounds = getCompoundsSubset(dbName);
     if (compounds.size() > 0) {
@@ -345,147 +389,209 @@ void Database::loadAdducts(string line, int lineCount)
     
 }
 
-int Database::loadNISTLibrary(string fileName,
-                              bsignal::signal<void (string, int, int)>* signal)
+// case-insensitive check for whether the line [begin, end) starts with `text`
+bool _lineStartsWith(const char* begin, const char* end, const char* text)
 {
-    if (signal)
-        (*signal)("Preprocessing database " + fileName, 0, 0);
-
-    cerr << "Counting number of lines in NIST Libary file…" << fileName << endl;
-    ifstream file(fileName);
-    if(!file.is_open())
-        return 0; 
-
-    file.unsetf(ios_base::skipws); // do not skip newlines
-    unsigned lineCount = std::count(istream_iterator<char>(file),
-                                    istream_iterator<char>(),
-                                    '\n');
-    
-    file.close();
-    
-    cerr << "Loading NIST Libary: " << fileName << endl;
-    
-    regex whiteSpace("\\s+");
-    regex formulaMatch("Formula\\=(C\\d+H\\d+\\S*)");
-    regex retentionTimeMatch("AvgRt\\=(\\S+)");
-    regex keyValuePattern("\\\"([^=\\\"]*)=([^\\\"]*)\\\"");
-
-    string dbName = mzUtils::cleanFilename(fileName);
-    Compound* currentCompound = nullptr;
-    bool capturePeaks = false;
-    int compoundCount = 0;
-    int currentLine = 0;
-
-    file.open(fileName, ios::in);
-
-    while (!file.eof()) {
+    for (; *text != '\0'; ++text, ++begin) {
+        if (begin == end
+            || tolower(static_cast<unsigned char>(*begin))
+                   != tolower(static_cast<unsigned char>(*text))) {
+            return false;
+        }
+    }
+    return true;
+}
 
-        string line;
-        getline(file,line);
+// case-insensitive check for whether the line [begin, end) contains `text`
+bool _lineContains(const char* begin, const char* end, const char* text)
+{
+    auto equalsIgnoreCase = [](char a, char b) {
+        return tolower(static_cast<unsigned char>(a))
+               == tolower(static_cast<unsigned char>(b));
+    };
+    return search(begin, end, text, text + strlen(text), equalsIgnoreCase)
+           != end;
+}
 
-        if (_startsWith(line, "NAME:")) {
-            // before reading the next record or ending stream, save the
-            // compound created from last record
-            if (currentCompound and !currentCompound->name().empty()) {
-                if (!currentCompound->formula().empty()) {
-                    auto formula = currentCompound->formula();
-                    auto exactMass = MassCalculator::computeMass(formula, 0);
-                    currentCompound->setMz(exactMass);
-                }
-                if (addCompound(currentCompound)){
-                    ++compoundCount;
-                }
-            }
+// the line [begin, end) with its first `offset` characters dropped
+string _lineValue(const char* begin, const char* end, size_t offset)
+{
+    if (static_cast<size_t>(end - begin) <= offset)
+        return "";
+    return string(begin + offset, end);
+}
 
-            // we need to check this again before creating a new compound,
-            // otherwise it would create one at stream end as well
-            if (_startsWith(line, "NAME:")) {
-                // new compound
-                string name = line.substr(6, line.length());
-                currentCompound = new Compound(name, name, "", 0);
-                currentCompound->setDb (dbName);
-                capturePeaks = false;
-            }
+// position and length of the first match of the pattern "<key>(\S+)", where
+// `requireFormula` further requires the value to look like "C\d+H\d+\S*"
+bool _findCommentValue(const string& comment,
+                       const string& key,
+                       bool requireFormula,
+                       string& value)
+{
+    auto isSpace = [](char c) {
+        return c == ' ' || c == '\t' || c == '\n'
+               || c == '\v' || c == '\f' || c == '\r';
+    };
+    auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+
+    size_t size = comment.size();
+    for (size_t pos = comment.find(key);
+         pos != string::npos;
+         pos = comment.find(key, pos + 1)) {
+        size_t start = pos + key.size();
+        size_t i = start;
+        if (requireFormula) {
+            if (i >= size || comment[i] != 'C')
+                continue;
+            size_t digitsStart = ++i;
+            while (i < size && isDigit(comment[i]))
+                ++i;
+            if (i == digitsStart || i >= size || comment[i] != 'H')
+                continue;
+            digitsStart = ++i;
+            while (i < size && isDigit(comment[i]))
+                ++i;
+            if (i == digitsStart)
+                continue;
         }
-
-        if(currentCompound == nullptr)
+        while (i < size && !isSpace(comment[i]))
+            ++i;
+        if (i == start)
             continue;
+        value = comment.substr(start, i - start);
+        return true;
+    }
+    return false;
+}
 
-        if (_startsWith(line, "MW:")) {
-            currentCompound->setMz(string2float(line.substr(3, line.length())));
-        
-        } else if (_startsWith(line, "CE:")
-                   || _startsWith(line, "COLLISION ENERGY:")
-                   || _startsWith(line, "COLLISION_ENERGY:")) {
-            currentCompound->setCollisionEnergy(string2float(line.substr(3, line.length())));
+// all `"key=value"` pairs in the comment, as matched in sequence by the
+// pattern `\"([^=\"]*)=([^\"]*)\"`
+vector<pair<string, string>> _commentKeyValuePairs(const string& comment)
+{
+    vector<pair<string, string>> pairs;
+    size_t size = comment.size();
+    size_t pos = comment.find('"');
+    while (pos != string::npos) {
+        size_t separator = comment.find_first_of("=\"", pos + 1);
+        if (separator == string::npos)
+            break;
+        if (comment[separator] == '"') {
+            pos = separator;
+            continue;
+        }
+        size_t close = comment.find('"', separator + 1);
+        if (close == string::npos)
+            break;
+        pairs.push_back(make_pair(comment.substr(pos + 1, separator - pos - 1),
+                                  comment.substr(separator + 1,
+                                                 close - separator - 1)));
+        pos = close + 1 < size ? comment.find('"', close + 1) : string::npos;
+    }
+    return pairs;
+}
 
-        } else if (_startsWith(line, "ID:")) {
-            string id = line.substr(4, line.length());
+// creates a compound from a single NIST library record, spanning from its
+// "NAME:" line up to (not including) the next one; returns null for records
+// without a name
+Compound* _parseNISTRecord(const char* begin,
+                           const char* end,
+                           const string& dbName)
+{
+    const char* lineEnd = static_cast<const char*>(memchr(begin,
+                                                          '\n',
+                                                          end - begin));
+    if (lineEnd == nullptr)
+        lineEnd = end;
+
+    string name = _lineValue(begin, lineEnd, 6);
+    if (name.empty())
+        return nullptr;
+
+    Compound* compound = new Compound(name, name, "", 0);
+    compound->setDb(dbName);
+
+    vector<string> category;
+    vector<float> mzValues;
+    vector<float> intensities;
+    map<int, string> ionTypes;
+    bool capturePeaks = false;
+    for (const char* line = lineEnd + 1; line < end; line = lineEnd + 1) {
+        lineEnd = static_cast<const char*>(memchr(line, '\n', end - line));
+        if (lineEnd == nullptr)
+            lineEnd = end;
+
+        if (_lineStartsWith(line, lineEnd, "MW:")) {
+            compound->setMz(string2float(_lineValue(line, lineEnd, 3)));
+
+        } else if (_lineStartsWith(line, lineEnd, "CE:")
+                   || _lineStartsWith(line, lineEnd, "COLLISION ENERGY:")
+                   || _lineStartsWith(line, lineEnd, "COLLISION_ENERGY:")) {
+            compound->setCollisionEnergy(
+                string2float(_lineValue(line, lineEnd, 3)));
+
+        } else if (_lineStartsWith(line, lineEnd, "ID:")) {
+            string id = _lineValue(line, lineEnd, 4);
             if (id.size() > 0)
-                currentCompound->setId(id);
+                compound->setId(id);
 
-        } else if (_startsWith(line, "LOGP:")) {
-            currentCompound->setLogP(string2float(line.substr(5, line.length())));
+        } else if (_lineStartsWith(line, lineEnd, "LOGP:")) {
+            compound->setLogP(string2float(_lineValue(line, lineEnd, 5)));
 
-        } else if (_startsWith(line, "RT:")) {
-            currentCompound->setExpectedRt(string2float(line.substr(3, line.length())));
+        } else if (_lineStartsWith(line, lineEnd, "RT:")) {
+            compound->setExpectedRt(
+                string2float(_lineValue(line, lineEnd, 3)));
 
-        } else if (_startsWith(line, "SMILE:")) {
-            string smileString = line.substr(7, line.length());
+        } else if (_lineStartsWith(line, lineEnd, "SMILE:")) {
+            string smileString = _lineValue(line, lineEnd, 7);
             if (smileString.size() > 0)
-                currentCompound->setSmileString (smileString);
+                compound->setSmileString(smileString);
 
-        } else if (_startsWith(line, "SMILES:")) {
-             string smileString = line.substr(8, line.length());
+        } else if (_lineStartsWith(line, lineEnd, "SMILES:")) {
+            string smileString = _lineValue(line, lineEnd, 8);
             if (smileString.size() > 0)
-                currentCompound->setSmileString (smileString);
+                compound->setSmileString(smileString);
 
-        } else if (_startsWith(line, "PRECURSORMZ:")) {
-            currentCompound->setPrecursorMz(string2float(line.substr(13, line.length())));
+        } else if (_lineStartsWith(line, lineEnd, "PRECURSORMZ:")) {
+            compound->setPrecursorMz(
+                string2float(_lineValue(line, lineEnd, 13)));
 
-        } else if (_startsWith(line, "EXACTMASS:")) {
-            currentCompound->setMz(string2float(line.substr(10, line.length())));
+        } else if (_lineStartsWith(line, lineEnd, "EXACTMASS:")) {
+            compound->setMz(string2float(_lineValue(line, lineEnd, 10)));
 
-        } else if (_startsWith(line, "FORMULA:")) {
-            string formula = line.substr(9, line.length());
-            boost::replace_all_copy(formula,"\"", "");
+        } else if (_lineStartsWith(line, lineEnd, "FORMULA:")) {
+            string formula = _lineValue(line, lineEnd, 9);
             if (formula.size() > 0)
-                currentCompound->setFormula (formula);
+                compound->setFormula(formula);
 
-        } else if (_startsWith(line, "MOLECULE FORMULA:")) {
-           string formula = line.substr(17, line.length());
-            boost::replace_all_copy(formula, "\"", "");
+        } else if (_lineStartsWith(line, lineEnd, "MOLECULE FORMULA:")) {
+            string formula = _lineValue(line, lineEnd, 17);
             if (formula.size() > 0)
-                currentCompound->setFormula(formula);
-
-        } else if (_startsWith(line, "CATEGORY:")) {
-            auto category = currentCompound->category();
-            category.push_back(line.substr(10, line.length()));
-            currentCompound->setCategory(category);
-
-        } else if (_startsWith(line, "TAG:")) {
-            if (_contain(line, "VIRTUAL"))
-                currentCompound->setVirtualFragmentation(true);
-
-        } else if (_startsWith(line, "ION MODE:")
-                   || _startsWith(line, "ION_MODE:")
-                   || _startsWith(line, "IONMODE:")
-                   || _startsWith(line, "IONIZATION:")) {
-            if (_contain(line, "N"))
-                currentCompound->ionizationMode = Compound::IonizationMode::Negative;
-            if (_contain(line, "P"))
-                currentCompound->ionizationMode = Compound::IonizationMode::Positive;
-
-        } else if (_startsWith(line, "COMMENT:")
-                   || _startsWith(line, "COMMENTS:")) {
-            smatch match;
-            string comment = line.substr(8, line.length());
-            if (regex_search(comment, match, formulaMatch) && match.size() > 1) {
-                currentCompound->setFormula (match.str(1));
-            }
-            if (regex_search(comment, match, retentionTimeMatch) && match.size() > 1) {
-                currentCompound->setExpectedRt(string2float(match.str(1)));
-            }
+                compound->setFormula(formula);
+
+        } else if (_lineStartsWith(line, lineEnd, "CATEGORY:")) {
+            category.push_back(_lineValue(line, lineEnd, 10));
+
+        } else if (_lineStartsWith(line, lineEnd, "TAG:")) {
+            if (_lineContains(line, lineEnd, "VIRTUAL"))
+                compound->setVirtualFragmentation(true);
+
+        } else if (_lineStartsWith(line, lineEnd, "ION MODE:")
+                   || _lineStartsWith(line, lineEnd, "ION_MODE:")
+                   || _lineStartsWith(line, lineEnd, "IONMODE:")
+                   || _lineStartsWith(line, lineEnd, "IONIZATION:")) {
+            if (_lineContains(line, lineEnd, "N"))
+                compound->ionizationMode = Compound::IonizationMode::Negative;
+            if (_lineContains(line, lineEnd, "P"))
+                compound->ionizationMode = Compound::IonizationMode::Positive;
+
+        } else if (_lineStartsWith(line, lineEnd, "COMMENT:")
+                   || _lineStartsWith(line, lineEnd, "COMMENTS:")) {
+            string comment = _lineValue(line, lineEnd, 8);
+            string value;
+            if (_findCommentValue(comment, "Formula=", true, value))
+                compound->setFormula(value);
+            if (_findCommentValue(comment, "AvgRt=", false, value))
+                compound->setExpectedRt(string2float(value));
 
             // the following pattern logic extracts some useful information
             // available as comments in the MoNA public library available at:
@@ -495,42 +601,32 @@ int Database::loadNISTLibrary(string fileName,
             string pubchemId = "";
             string chebi = "";
             string note = "";
-            auto comment_begin = sregex_iterator( 
-                                    comment.begin(), 
-                                    comment.end(), 
-                                    keyValuePattern); 
-  
-            auto comment_end = sregex_iterator();
-
-            for (sregex_iterator k = comment_begin; 
-                k != comment_end; 
-                ++k) { 
-  
-                smatch match = *k; 
-                string key = match.str(1); 
-                string value = match.str(2);
-                
+            for (const auto& keyValue : _commentKeyValuePairs(comment)) {
+                const string& key = keyValue.first;
+                const string& value = keyValue.second;
+                const char* keyBegin = key.data();
+                const char* keyEnd = keyBegin + key.size();
+
                 // replace SMILE if available and not already set
-                if (_contain(key, "SMILE")
-                    && currentCompound->smileString().empty()) {
-                    currentCompound->setSmileString(value);
+                if (_lineContains(keyBegin, keyEnd, "SMILE")
+                    && compound->smileString().empty()) {
+                    compound->setSmileString(value);
                 }
 
                 // replace category if available and not already set
-                if (_contain(key, "compound class")
-                    && currentCompound->category().empty()) {
+                if (_lineContains(keyBegin, keyEnd, "compound class")
+                    && category.empty()) {
                     string categories = value;
-                    currentCompound->setCategory(mzUtils::split(categories,
-                                                                "; "));
+                    category = mzUtils::split(categories, "; ");
                 }
 
-                if (_contain(key, "kegg"))
+                if (_lineContains(keyBegin, keyEnd, "kegg"))
                     keggId = value;
-                if (_contain(key, "hmdb"))
+                if (_lineContains(keyBegin, keyEnd, "hmdb"))
                     hmdbId = value;
-                if (_contain(key, "pubchem"))
+                if (_lineContains(keyBegin, keyEnd, "pubchem"))
                     pubchemId = value;
-                if (_contain(key, "chebi"))
+                if (_lineContains(keyBegin, keyEnd, "chebi"))
                     chebi = value;
 
                 note += key;
@@ -539,66 +635,138 @@ int Database::loadNISTLibrary(string fileName,
 
             if (!keggId.size()) {
                 // KEGG gets precendence over HMDB
-                currentCompound->setId(keggId);
+                compound->setId(keggId);
             } else if (!hmdbId.size()) {
                 // HMDB gets precendence over PubChem
-                currentCompound->setId(hmdbId);
+                compound->setId(hmdbId);
             } else if (!pubchemId.size()) {
                 // PubChem gets precendence over ChEBI
-                currentCompound->setId(pubchemId);
+                compound->setId(pubchemId);
             } else if (!chebi.size()) {
-                currentCompound->setId(chebi);
+                compound->setId(chebi);
             }
 
             // comments are added as a note for the compound
             if (note.size()) {
-                currentCompound->setNote(comment);
+                compound->setNote(comment);
             } else {
-                currentCompound->setNote(note);
+                compound->setNote(note);
             }
 
-        } else if (_startsWith(line, "NUM PEAKS:")
-                   || _startsWith(line, "NUMPEAKS:")) {
+        } else if (_lineStartsWith(line, lineEnd, "NUM PEAKS:")
+                   || _lineStartsWith(line, lineEnd, "NUMPEAKS:")) {
             capturePeaks = true;
+
         } else if (capturePeaks) {
-            vector<string> mzIntensityPair;
-            boost::split(mzIntensityPair, line, boost::is_any_of(" "));
-            if (mzIntensityPair.size() >= 2) {
-                double mz = string2float(mzIntensityPair[0]);
-                double in = string2float(mzIntensityPair[1]);
-                if (mz >= 0.0 && in >= 0.0) {
-                    auto mzValues = currentCompound->fragmentMzValues();
-                    mzValues.push_back(mz);
-                    currentCompound->setFragmentMzValues(mzValues);
-                    auto intensities = currentCompound->fragmentIntensities();
-                    intensities.push_back(in);
-                    currentCompound->setFragmentIntensities(intensities);
-
-                    int fragIdx = currentCompound->fragmentMzValues().size() - 1;
-                    if (mzIntensityPair.size() >= 3) {
-                        auto ionTypes = currentCompound->fragmentIonTypes();
-                        ionTypes[fragIdx] =
-                            mzIntensityPair.at(2);
-                        currentCompound->setFragmentIonTypes(ionTypes);
-                    }
+            // fields are separated by single spaces: "<mz> <intensity> [type]"
+            const char* mzEnd = find(line, lineEnd, ' ');
+            if (mzEnd == lineEnd)
+                continue;
+            const char* intensityEnd = find(mzEnd + 1, lineEnd, ' ');
+
+            double mz = mzUtils::string2float(line, mzEnd);
+            double in = mzUtils::string2float(mzEnd + 1, intensityEnd);
+            if (mz >= 0.0 && in >= 0.0) {
+                mzValues.push_back(mz);
+                intensities.push_back(in);
+                if (intensityEnd != lineEnd) {
+                    const char* typeEnd = find(intensityEnd + 1, lineEnd, ' ');
+                    ionTypes[mzValues.size() - 1] = string(intensityEnd + 1,
+                                                           typeEnd);
                 }
             }
         }
-        ++currentLine;
-        if (signal) {
-            (*signal)("Loading spectral library: " + fileName,
-                      currentLine,
-                      lineCount);
-        }
     }
-    if (currentCompound and !currentCompound->name().empty()) {
-        if (!currentCompound->formula().empty()) {
-            auto formula = currentCompound->formula();
-            auto exactMass = MassCalculator::computeMass(formula, 0);
-            currentCompound->setMz(exactMass);
+
+    compound->setCategory(category);
+    compound->setFragmentMzValues(mzValues);
+    compound->setFragmentIntensities(intensities);
+    compound->setFragmentIonTypes(ionTypes);
+    if (!compound->formula().empty()) {
+        auto formula = compound->formula();
+        auto exactMass = MassCalculator::computeMass(formula, 0);
+        compound->setMz(exactMass);
+    }
+    return compound;
+}
+
+int Database::loadNISTLibrary(string fileName,
+                              bsignal::signal<void (string, int, int)>* signal)
+{
+    if (signal)
+        (*signal)("Preprocessing database " + fileName, 0, 0);
+
+    // map the library into memory, falling back to reading it in full
+    QFile file(QString::fromStdString(fileName));
+    if (!file.open(QIODevice::ReadOnly))
+        return 0;
+
+    qint64 fileSize = file.size();
+    const char* data = reinterpret_cast<const char*>(file.map(0, fileSize));
+    string contents;
+    if (data == nullptr && fileSize > 0) {
+        ifstream stream(fileName, ios::in | ios::binary);
+        contents.assign(istreambuf_iterator<char>(stream),
+                        istreambuf_iterator<char>());
+        data = contents.data();
+        fileSize = static_cast<qint64>(contents.size());
+    }
+    if (data == nullptr || fileSize == 0)
+        return 0;
+
+    cerr << "Loading NIST Libary: " << fileName << endl;
+
+    // every record begins with a "NAME:" line and runs up to the next one
+    const char* end = data + fileSize;
+    vector<const char*> recordStarts;
+    for (const char* line = data; line < end; ) {
+        const char* lineEnd = static_cast<const char*>(memchr(line,
+                                                               '\n',
+                                                               end - line));
+        if (lineEnd == nullptr)
+            lineEnd = end;
+        if (_lineStartsWith(line, lineEnd, "NAME:"))
+            recordStarts.push_back(line);
+        line = lineEnd + 1;
+    }
+    recordStarts.push_back(end);
+
+    // progress is reported in bytes, scaled down to fit an int if needed
+    qint64 progressScale = fileSize / numeric_limits<int>::max() + 1;
+    int progressTotal = static_cast<int>(fileSize / progressScale);
+
+    // parse records in batches, adding compounds in the order of the file
+    string dbName = mzUtils::cleanFilename(fileName);
+    int compoundCount = 0;
+    size_t recordCount = recordStarts.size() - 1;
+    const size_t batchSize = 4096;
+    vector<Compound*> compounds;
+    for (size_t first = 0; first < recordCount; first += batchSize) {
+        size_t last = min(first + batchSize, recordCount);
+        compounds.assign(last - first, nullptr);
+
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (size_t i = first; i < last; ++i) {
+            compounds[i - first] = _parseNISTRecord(recordStarts[i],
+                                                    recordStarts[i + 1],
+                                                    dbName);
         }
-        if (addCompound(currentCompound)){
-            ++compoundCount;
+
+        for (auto compound : compounds) {
+            if (compound == nullptr)
+                continue;
+            if (addCompound(compound)) {
+                ++compoundCount;
+            } else {
+                delete compound;
+            }
+        }
+
+        if (signal) {
+            qint64 offset = recordStarts[last] - data;
+            (*signal)("Loading spectral library: " + fileName,
+                      static_cast<int>(offset / progressScale),
+                      progressTotal);
         }
     }
 
@@ -702,6 +870,7 @@ int Database::loadCompoundCSVFile(string file,
     }
 
     sort(_compoundsDB.begin(),_compoundsDB.end(), Compound::compMass);
+    _rebuildIndexes();
     return loadCount;
 }
 
@@ -1768,4 +1937,57 @@ TEST_CASE("Testing database class")
 
     }
 
+    SUBCASE("Testing indexed lookups") {
+        Database db;
+        db.loadMascotLibrary("tests/test-libmaven/test_Mascot.mgf");
+        db.loadNISTLibrary("tests/test-libmaven/test_NISTLibrary.msp");
+        db.loadCompoundCSVFile("tests/test-libmaven/test_loadCSV.csv");
+        auto allCompounds = db.compoundsDB();
+        REQUIRE(allCompounds.size() == 30);
+
+        // lookups must agree with a linear scan over all compounds
+        for (auto compound : allCompounds) {
+            vector<Compound*> sameDb, sameId, sameName;
+            for (auto other : allCompounds) {
+                if (other->db() != compound->db())
+                    continue;
+                sameDb.push_back(other);
+                if (other->id() == compound->id())
+                    sameId.push_back(other);
+                if (other->name() == compound->name())
+                    sameName.push_back(other);
+            }
+            REQUIRE(db.getCompoundsSubset(compound->db()) == sameDb);
+            REQUIRE(db.findSpeciesById(compound->id(), compound->db())
+                    == sameId);
+            REQUIRE(db.findSpeciesByName(compound->name(), compound->db())
+                    == sameName);
+        }
+        REQUIRE(db.getCompoundsSubset("test_unknown").empty());
+        REQUIRE(db.findSpeciesById("HMDB00653", "test_unknown").empty());
+        REQUIRE(db.findSpeciesByName("unknown", "test_loadCSV").empty());
+
+        MassCutoff massCutoff;
+        massCutoff.setMassCutoffAndType(10, "ppm");
+        for (auto compound : allCompounds) {
+            float mz = compound->mz();
+            float cutoff = massCutoff.massCutoffValue(mz);
+            set<Compound*> sameMass;
+            for (auto other : allCompounds) {
+                if (other->mz() >= mz - cutoff && other->mz() <= mz + cutoff)
+                    sameMass.insert(other);
+            }
+            REQUIRE(db.findSpeciesByMass(mz, &massCutoff) == sameMass);
+        }
+
+        // indexes must follow removal of a database
+        db.removeDatabase("test_Mascot");
+        REQUIRE(db.getCompoundsSubset("test_Mascot").empty());
+        REQUIRE(db.getCompoundsSubset("test_loadCSV").size() == 10);
+        for (auto compound : db.compoundsDB()) {
+            REQUIRE(db.findSpeciesByMass(compound->mz(), &massCutoff)
+                        .count(compound) == 1);
+        }
+    }
+
 }
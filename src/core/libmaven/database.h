@@ -1,7 +1,9 @@
 #ifndef DATABASE_H
 #define DATABASE_H
 
+#include <unordered_map>
 #include <boost/signals2.hpp>
+#include "compoundSearchIndex.h"
 #include "standardincludes.h"
 #include "mzUtils.h"
 
@@ -133,9 +135,11 @@ class Database
 
         /**
          * @brief findSpeciesByMass Finds compound on the basis of mass
+         * @details Compounds are scanned for their current m/z on every call,
+         * since m/z values can be changed in place.
          * @param mz Mass by charge ratio of the compound.
-         * @param massCutoff
-         * @return
+         * @param massCutoff Tolerance within which compound m/z must lie.
+         * @return Set of compounds, from all databases, with m/z in range.
          */
         set<Compound*> findSpeciesByMass(float mz, MassCutoff* massCutoff);
 
@@ -155,6 +159,25 @@ class Database
          */
         vector<Compound*> findSpeciesById(string id, string dbName);
 
+        /**
+         * @brief searchCompounds Finds compounds of a database whose names,
+         * IDs, formulae or categories match a query.
+         * @details Answered using a trigram index of the database, which is
+         * built on the first search after its compounds change.
+         * @param query Case-insensitive literal text, optionally split by
+         * ".*", as checked by `CompoundSearchIndex::isLiteralQuery`.
+         * @param dbName DB whose compounds are to be searched.
+         * @param fields Fields of compounds to be searched.
+         * @param limit Maximum number of compounds to return, zero for all.
+         * @return Matching compounds along with the location of their match,
+         * best ranked first.
+         */
+        vector<pair<Compound*, CompoundSearchIndex::Match>>
+        searchCompounds(string query,
+                        string dbName,
+                        int fields = CompoundSearchIndex::AllFields,
+                        size_t limit = 0);
+
         /**
          * @brief findAdductByName Finds adduct by name in its db.
          * @param name Name of adduct.
@@ -193,6 +216,31 @@ class Database
         const std::string ANYDATABASE;
 
     private:
+        /**
+         * @brief Compounds belonging to a single database, in the order in
+         * which they are stored in `_compoundsDB`, along with lookup tables
+         * for their IDs and names, and a text index over them.
+         */
+        struct CompoundPartition {
+            vector<Compound*> compounds;
+            unordered_map<string, vector<Compound*>> byId;
+            unordered_map<string, vector<Compound*>> byName;
+            CompoundSearchIndex searchIndex;
+        };
+
+        unordered_map<string, CompoundPartition> _partitions;
+
+        /**
+         * @brief Add a compound, already appended to `_compoundsDB`, to the
+         * partition of its database.
+         */
+        void _indexCompound(Compound* compound);
+
+        /**
+         * @brief Rebuild all partitions from `_compoundsDB`, which is needed
+         * whenever compounds are reordered.
+         */
+        void _rebuildIndexes();
 
         vector<Adduct*> _adductsDB;
         vector<Adduct*> _fragmentsDB;
@@ -202,8 +250,6 @@ class Database
         vector<string> _invalidRows;
         vector<string> _notFoundColumns;
         map<string, int> _compoundIdenticalCount;
-        bool _startsWith(string line, string text);
-        bool _contain(string line, string text);
         map<string, Compound*> _compoundIdMap;
 };
 
@@ -44,6 +44,23 @@ void groupClassifier::classify(PeakGroup* grp) {
 	grp->groupQuality=scoreGroup(grp);
 }
 
+void groupClassifier::classify(vector<PeakGroup*>& groups) {
+    if (network == nullptr || groups.empty())
+        return;
+
+    size_t count = groups.size();
+    vector<float> featureMatrix(num_features * count);
+    for (size_t i = 0; i < count; i++) {
+        vector<float> features = getFeatures(groups[i]);
+        for (int k = 0; k < num_features; k++)
+            featureMatrix[k * count + i] = features[k];
+    }
+
+    auto results = network->runBatch(featureMatrix, count);
+    for (size_t i = 0; i < count; i++)
+        groups[i]->groupQuality = results[i];
+}
+
 float groupClassifier::scoreGroup(PeakGroup* grp) {
     float result[1] = {0.1};
     if(network != nullptr) {
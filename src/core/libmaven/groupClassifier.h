@@ -15,6 +15,14 @@ public:
 	groupClassifier();
 	~groupClassifier();
 	void classify(PeakGroup* grp);
+
+	/**
+	 * @brief Score many groups in a single pass through the network.
+	 * @details Features of all groups are gathered into one matrix, giving
+	 * the same scores as classifying each group separately.
+	 * @param groups Groups whose `groupQuality` will be set.
+	 */
+	void classify(vector<PeakGroup*>& groups);
 	float scoreGroup(PeakGroup* grp);
 	void loadModel(string filename);
 	bool hasModel();
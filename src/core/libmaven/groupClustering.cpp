@@ -0,0 +1,220 @@
+#include "EIC.h"
+#include "groupClustering.h"
+#include "mzSample.h"
+#include "mzUtils.h"
+#include "PeakGroup.h"
+
+GroupClustering::GroupClustering(vector<mzSample*> samples,
+                                 const MassCutoff& massCutoff,
+                                 int eicType,
+                                 string filterline)
+    : _samples(samples),
+      _massCutoff(massCutoff),
+      _eicType(eicType),
+      _filterline(filterline),
+      _cancelled(false)
+{
+}
+
+void GroupClustering::cancel()
+{
+    _cancelled = true;
+}
+
+bool GroupClustering::cluster(vector<shared_ptr<PeakGroup>>& groups,
+                              double maxRtDiff,
+                              double minSampleCorrelation,
+                              double minRtCorrelation)
+{
+    stable_sort(begin(groups),
+                end(groups),
+                [](shared_ptr<PeakGroup> a, shared_ptr<PeakGroup> b) {
+                    return a->meanRt < b->meanRt;
+                });
+
+    // clear cluster information
+    for (auto group : groups)
+        group->clusterId = 0;
+
+    // intensities across samples and the sample used to compare peak shapes
+    // do not change during clustering, therefore these are found upfront
+    int numGroups = groups.size();
+    auto sampleOrder = PeakGroup::sampleOrderTable(_samples);
+    vector<vector<float>> intensities(numGroups);
+    vector<mzSample*> largestSamples(numGroups, nullptr);
+#pragma omp parallel for
+    for (int i = 0; i < numGroups; ++i) {
+        auto group = groups[i];
+        intensities[i] = group->getOrderedIntensityVector(sampleOrder,
+                                                          _samples.size(),
+                                                          PeakGroup::AreaTop);
+        float maxIntensity = 0;
+        for (auto& peak : group->peaks) {
+            if (peak.peakIntensity > maxIntensity) {
+                maxIntensity = peak.peakIntensity;
+                largestSamples[i] = peak.getSample();
+            }
+        }
+    }
+
+    int clusterId = 0;
+    map<int, PeakGroup*> parentGroups;
+    vector<map<mzSample*, ShapeEIC>> shapeCache(numGroups);
+    for (int i = 0; i < numGroups; ++i) {
+        if (_cancelled) {
+            for (auto group : groups)
+                group->clusterId = 0;
+            return false;
+        }
+        if (i % 10 == 0)
+            boostSignal("Clustering…", i + 1, numGroups);
+
+        auto group1 = groups[i].get();
+        if (group1->clusterId == 0) {
+            // create new cluster
+            group1->clusterId = ++clusterId;
+            parentGroups[clusterId] = group1;
+            shapeCache[i].clear();
+        }
+
+        // cluster parent
+        PeakGroup* parent = parentGroups[clusterId];
+
+        mzSample* largestSample = largestSamples[i];
+        if (largestSample == nullptr)
+            continue;
+
+        // groups are sorted by RT, so members of this cluster can only be
+        // found within a contiguous range around its parent
+        auto rtTooFar = [&](shared_ptr<PeakGroup> group) {
+            float rtdist = abs(parent->meanRt - group->meanRt);
+            return rtdist > maxRtDiff * 2;
+        };
+        auto first = partition_point(begin(groups),
+                                     end(groups),
+                                     [&](shared_ptr<PeakGroup> group) {
+                                         return group->meanRt < parent->meanRt
+                                                && rtTooFar(group);
+                                     });
+        auto last = partition_point(first,
+                                    end(groups),
+                                    [&](shared_ptr<PeakGroup> group) {
+                                        return group->meanRt <= parent->meanRt
+                                               || !rtTooFar(group);
+                                    });
+
+        vector<int> candidates;
+        for (auto it = first; it != last; ++it) {
+            if ((*it)->clusterId == 0 && !rtTooFar(*it))
+                candidates.push_back(it - begin(groups));
+        }
+        if (candidates.empty())
+            continue;
+
+        EIC* eic1 = _pullEIC(group1,
+                             largestSample,
+                             group1->minRt,
+                             group1->maxRt);
+        vector<char> accepted(candidates.size(), 0);
+#pragma omp parallel for schedule(dynamic)
+        for (int c = 0; c < static_cast<int>(candidates.size()); ++c) {
+            int j = candidates[c];
+            auto group2 = groups[j].get();
+
+            // retention time overlap
+            float rtoverlap = mzUtils::checkOverlap(group1->minRt,
+                                                    group1->maxRt,
+                                                    group2->minRt,
+                                                    group2->maxRt);
+            if (rtoverlap < 0.1)
+                continue;
+
+            // peak intensity correlation
+            float cor = mzUtils::correlation(intensities[i], intensities[j]);
+            if (cor < minSampleCorrelation)
+                continue;
+
+            // peak shape correlation
+            auto intensities2 = _shapeIntensities(shapeCache[j],
+                                                  group2,
+                                                  largestSample,
+                                                  group1->minRt,
+                                                  group1->maxRt,
+                                                  maxRtDiff * 2);
+            float cor2 = mzUtils::correlation(eic1->intensity, intensities2);
+            if (cor2 < minRtCorrelation)
+                continue;
+
+            accepted[c] = 1;
+        }
+        delete eic1;
+
+        // passed all the filters, group1 and group2 into a single metagroup
+        for (size_t c = 0; c < candidates.size(); ++c) {
+            if (accepted[c]) {
+                groups[candidates[c]]->clusterId = group1->clusterId;
+                shapeCache[candidates[c]].clear();
+            }
+        }
+    }
+
+    boostSignal("Clustering done!", numGroups, numGroups);
+    return true;
+}
+
+EIC* GroupClustering::_pullEIC(PeakGroup* group,
+                               mzSample* sample,
+                               float rtMin,
+                               float rtMax)
+{
+    float mz = group->meanMz;
+    float ppm = _massCutoff.massCutoffValue(mz);
+    int msLevel = 1;
+    return sample->getEIC(mz - ppm,
+                          mz + ppm,
+                          rtMin,
+                          rtMax,
+                          msLevel,
+                          _eicType,
+                          _filterline);
+}
+
+vector<float>
+GroupClustering::_shapeIntensities(map<mzSample*, ShapeEIC>& cache,
+                                   PeakGroup* group,
+                                   mzSample* sample,
+                                   float rtMin,
+                                   float rtMax,
+                                   float margin)
+{
+    auto cached = cache.find(sample);
+    if (cached == end(cache)
+        || cached->second.rtMin > rtMin
+        || cached->second.rtMax < rtMax) {
+        ShapeEIC shape;
+        shape.rtMin = rtMin - margin;
+        shape.rtMax = rtMax + margin;
+        if (cached != end(cache)) {
+            shape.rtMin = min(shape.rtMin, cached->second.rtMin);
+            shape.rtMax = max(shape.rtMax, cached->second.rtMax);
+        }
+        EIC* eic = _pullEIC(group, sample, shape.rtMin, shape.rtMax);
+        shape.rt = eic->rt;
+        shape.intensity = eic->intensity;
+        delete eic;
+        cache[sample] = shape;
+        cached = cache.find(sample);
+    }
+
+    // the window is adjusted to the sample's RT range, as done by `getEIC`
+    if (rtMin < sample->minRt)
+        rtMin = sample->minRt;
+    if (rtMax > sample->maxRt && sample->maxRt > rtMin)
+        rtMax = sample->maxRt;
+
+    const ShapeEIC& shape = cached->second;
+    auto lower = lower_bound(begin(shape.rt), end(shape.rt), rtMin);
+    auto upper = upper_bound(lower, end(shape.rt), rtMax);
+    return vector<float>(begin(shape.intensity) + (lower - begin(shape.rt)),
+                         begin(shape.intensity) + (upper - begin(shape.rt)));
+}
@@ -0,0 +1,117 @@
+#ifndef GROUPCLUSTERING_H
+#define GROUPCLUSTERING_H
+
+#include <atomic>
+
+#include <boost/signals2.hpp>
+
+#include "masscutofftype.h"
+#include "standardincludes.h"
+
+class EIC;
+class mzSample;
+class PeakGroup;
+
+using namespace std;
+
+/**
+ * @brief The GroupClustering class puts peak groups that are likely to come
+ * from the same metabolite (isotopes, adducts, in-source fragments) into
+ * clusters, based on their retention times, the correlation of their
+ * intensities across samples and the correlation of their peak shapes.
+ */
+class GroupClustering
+{
+public:
+    boost::signals2::signal<void(const string&, unsigned int, int)>
+        boostSignal;
+
+    /**
+     * @brief Constructor of class GroupClustering.
+     * @param samples Samples across which intensities will be correlated.
+     * @param massCutoff Mass tolerance used to pull EICs for comparing peak
+     * shapes. This is copied, so later edits do not affect clustering.
+     * @param eicType Type of EICs to be pulled (max or sum).
+     * @param filterline Filterline of scans to be used for EICs.
+     */
+    GroupClustering(vector<mzSample*> samples,
+                    const MassCutoff& massCutoff,
+                    int eicType,
+                    string filterline);
+
+    /**
+     * @brief Assign a cluster ID to each of the given groups.
+     * @details Groups are visited in order of their retention time and each
+     * group that is not part of a cluster yet starts a new one. Only groups
+     * whose retention time lies close to the founder of the latest cluster
+     * are considered as members, and these candidates are compared with the
+     * visited group in parallel. The EIC of a candidate is pulled only once
+     * per sample and reused for the rest of its comparisons.
+     * @param groups Groups to be clustered. These will be sorted by their
+     * mean retention time, keeping groups with equal times in their order.
+     * @param maxRtDiff Maximum retention time difference between a cluster's
+     * founder and its members.
+     * @param minSampleCorrelation Minimum correlation of group intensities
+     * across samples.
+     * @param minRtCorrelation Minimum correlation of peak shapes.
+     * @return False if clustering was cancelled, in which case all groups
+     * are left without a cluster, true otherwise.
+     */
+    bool cluster(vector<shared_ptr<PeakGroup>>& groups,
+                 double maxRtDiff,
+                 double minSampleCorrelation,
+                 double minRtCorrelation);
+
+    /**
+     * @brief Request an ongoing or upcoming call to `cluster` to stop. This
+     * can be called from any thread.
+     */
+    void cancel();
+
+private:
+    /**
+     * @brief Intensities of an EIC along with the retention times of its
+     * scans, and the retention time window it was pulled for.
+     */
+    struct ShapeEIC {
+        float rtMin;
+        float rtMax;
+        vector<float> rt;
+        vector<float> intensity;
+    };
+
+    vector<mzSample*> _samples;
+    MassCutoff _massCutoff;
+    int _eicType;
+    string _filterline;
+    atomic<bool> _cancelled;
+
+    /**
+     * @brief Pull the EIC of a group from a sample, over the given retention
+     * time window, in the same way as `mzSample::correlation` does.
+     */
+    EIC* _pullEIC(PeakGroup* group, mzSample* sample, float rtMin, float rtMax);
+
+    /**
+     * @brief Obtain the intensities of a group's EIC within a retention time
+     * window, reusing an earlier pull from the same sample if it covers the
+     * window. These are exactly the intensities that a fresh pull over the
+     * same window would have.
+     * @param cache Earlier pulls for this group, one per sample.
+     * @param group Group whose EIC is needed.
+     * @param sample Sample from which the EIC is needed.
+     * @param rtMin Lower bound of the retention time window.
+     * @param rtMax Upper bound of the retention time window.
+     * @param margin Extra retention time to pull on either side of the
+     * window, when it is not already covered, in anticipation of the next
+     * comparisons.
+     */
+    vector<float> _shapeIntensities(map<mzSample*, ShapeEIC>& cache,
+                                    PeakGroup* group,
+                                    mzSample* sample,
+                                    float rtMin,
+                                    float rtMax,
+                                    float margin);
+};
+
+#endif  // GROUPCLUSTERING_H
@@ -1,9 +1,12 @@
 #include "Compound.h"
 #include "datastructures/adduct.h"
 #include "datastructures/mzSlice.h"
+#include "EIC.h"
 #include "groupFiltering.h"
+#include "masscutofftype.h"
 #include "mavenparameters.h"
 #include "mzSample.h"
+#include "mzUtils.h"
 #include "PeakGroup.h"
 
 GroupFiltering::GroupFiltering(MavenParameters *mavenParameters)
@@ -116,6 +119,32 @@ bool GroupFiltering::filterByMS2(PeakGroup& peakgroup)
     return false;
 }
 
+/**
+ * @brief Pull the intensities of an EIC, with the m/z window used by
+ * `mzSample::correlation`.
+ */
+vector<float> _pullIntensities(mzSample* sample,
+                               float mz,
+                               MassCutoff* massCutoff,
+                               float rtMin,
+                               float rtMax,
+                               int eicType,
+                               string filterline)
+{
+    float ppm = massCutoff->massCutoffValue(mz);
+    int msLevel = 1;
+    EIC* eic = sample->getEIC(mz - ppm,
+                              mz + ppm,
+                              rtMin,
+                              rtMax,
+                              msLevel,
+                              eicType,
+                              filterline);
+    vector<float> intensities = eic->intensity;
+    delete eic;
+    return intensities;
+}
+
 void GroupFiltering::filterBasedOnParent(PeakGroup& parent,
                                          GroupFiltering::ChildFilterType type,
                                          float maxRtDeviation,
@@ -155,23 +184,58 @@ void GroupFiltering::filterBasedOnParent(PeakGroup& parent,
             nonChildren.push_back(child.get());
     }
 
+    // the parent's EIC in each sample is pulled only once, over the same
+    // window as is later used for each of its children
+    auto& samples = _mavenParameters->samples;
+    int numSamples = samples.size();
+    auto deviation = maxRtDeviation / 60.0f; // seconds to minutes
+    vector<Peak*> parentPeaks(numSamples, nullptr);
+    vector<vector<float>> parentIntensities(numSamples);
+#pragma omp parallel for
+    for (int i = 0; i < numSamples; ++i) {
+        parentPeaks[i] = parent.getPeak(samples[i]);
+        if (parentPeaks[i] == nullptr)
+            continue;
+
+        parentIntensities[i] = _pullIntensities(samples[i],
+                                                parent.meanMz,
+                                                massCutoff,
+                                                parentPeaks[i]->rtmin
+                                                    - deviation,
+                                                parentPeaks[i]->rtmax
+                                                    + deviation,
+                                                _mavenParameters->eicType,
+                                                _mavenParameters->filterline);
+    }
+
+    vector<double> correlations(numSamples, 0.0);
     for (auto& child : possibleChildren) {
+#pragma omp parallel for
+        for (int i = 0; i < numSamples; ++i) {
+            if (parentPeaks[i] == nullptr)
+                continue;
+
+            auto childIntensities = _pullIntensities(
+                samples[i],
+                child->meanMz,
+                massCutoff,
+                parentPeaks[i]->rtmin - deviation,
+                parentPeaks[i]->rtmax + deviation,
+                _mavenParameters->eicType,
+                _mavenParameters->filterline);
+            correlations[i] = mzUtils::correlation(parentIntensities[i],
+                                                   childIntensities);
+        }
+
+        // summed in sample order, so that the average does not depend on
+        // how samples were distributed across threads
         float corrSum = 0.0f;
         int numSamplesShared = 0;
-        for (auto sample : _mavenParameters->samples) {
-            auto parentPeak = parent.getPeak(sample);
-            if (!parentPeak)
+        for (int i = 0; i < numSamples; ++i) {
+            if (parentPeaks[i] == nullptr)
                 continue;
 
-            auto deviation = maxRtDeviation / 60.0f; // seconds to minutes
-            double corr = sample->correlation(parent.meanMz,
-                                              child->meanMz,
-                                              massCutoff,
-                                              parentPeak->rtmin - deviation,
-                                              parentPeak->rtmax + deviation,
-                                              _mavenParameters->eicType,
-                                              _mavenParameters->filterline);
-            corrSum += corr;
+            corrSum += correlations[i];
             ++numSamplesShared;
         }
         if (numSamplesShared == 0)
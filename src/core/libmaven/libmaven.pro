@@ -84,6 +84,7 @@ SOURCES = base64.cpp \
           mzUtils.cpp \
           peakdetector.cpp \
           statistics.cpp \
+          quantileSketch.cpp \
           elementMass.cpp \
           mzFit.cpp \
           mzAligner.cpp \
@@ -104,12 +105,15 @@ SOURCES = base64.cpp \
           comparesampleslogic.cpp \
           isotopelogic.cpp \
           eiclogic.cpp \
+          compoundSearchIndex.cpp \
           database.cpp \
           PolyAligner.cpp \
           jsonReports.cpp \
           masscutofftype.cpp \
           peakFiltering.cpp \
+          groupClustering.cpp \
           groupFiltering.cpp \
+          mzrollreader.cpp \
           datastructures/adduct.cpp \
           datastructures/mzSlice.cpp \
           groupClassifier.cpp \
@@ -135,6 +139,7 @@ HEADERS += constants.h \
            peakdetector.h \
            standardincludes.h \
            statistics.h \
+           quantileSketch.h \
            SavGolSmoother.h \
            mavenparameters.h\
            classifier.h \
@@ -147,12 +152,15 @@ HEADERS += constants.h \
            EIC.h \
 	       Scan.h \
            SRMList.h \
+           compoundSearchIndex.h \
            database.h \
            PolyAligner.h \
            jsonReports.h \
            masscutofftype.h \
            peakFiltering.h \
+           groupClustering.h \
            groupFiltering.h \
+           mzrollreader.h \
            datastructures/adduct.h \
            datastructures/mzSlice.h \
            settings.h \
@@ -1,3 +1,6 @@
+#include <mutex>
+#include <unordered_map>
+
 #include "datastructures/adduct.h"
 #include "datastructures/isotope.h"
 #include "mzMassCalculator.h"
@@ -29,8 +32,23 @@ double MassCalculator::getElementMass(string elmnt) {
 
 
 
-map<string, int> MassCalculator::getComposition(string formula) {
-
+/**
+ * @brief Parsed form of a formula: the count of each element, ordered by
+ * element symbol, along with their neutral mass and the counts of elements
+ * that can be isotopically labelled.
+ */
+struct MassCalculator::_Composition
+{
+    vector<pair<string, int>> elementCounts;
+    double neutralMass;
+    int carbons;
+    int hydrogens;
+    int nitrogens;
+    int sulfurs;
+};
+
+map<string, int> _parseComposition(const string& formula)
+{
     /* define some variable */
     int SIZE = formula.length();
     map<string, int> atoms;
@@ -61,23 +79,69 @@ map<string, int> MassCalculator::getComposition(string formula) {
         }
 
         /* compute normally if there was no open bracket */
-        // cout << bloc <<  " " << coeff << endl;
         atoms[bloc] += coeff;
     }
 
     return (atoms);
-    /* send back value to main.cpp */
 }
 
-double MassCalculator::computeNeutralMass(string formula) {
-    map<string, int> atoms = getComposition(formula);
-    map<string, int>::iterator itr;
+shared_ptr<const MassCalculator::_Composition>
+MassCalculator::_cachedComposition(const string& formula)
+{
+    // formulas are spread over several independently locked shards so that
+    // threads looking up different formulas rarely wait on each other
+    struct CacheShard
+    {
+        mutex lock;
+        unordered_map<string, shared_ptr<const _Composition>> compositions;
+    };
+    static CacheShard shards[16];
+
+    // entries are dropped all at once if a shard grows beyond this size, so
+    // that memory use stays bounded even for an endless stream of formulas
+    static const size_t maxShardSize = 1 << 16;
+
+    auto& shard = shards[hash<string>()(formula) % 16];
+    {
+        lock_guard<mutex> guard(shard.lock);
+        auto cached = shard.compositions.find(formula);
+        if (cached != end(shard.compositions))
+            return cached->second;
+    }
 
-    double mass = 0;
-    for (itr = atoms.begin(); itr != atoms.end(); itr++) {
-        mass += getElementMass((*itr).first) * (*itr).second;
+    auto composition = make_shared<_Composition>();
+    composition->neutralMass = 0.0;
+    for (const auto& atom : _parseComposition(formula)) {
+        composition->elementCounts.push_back(atom);
+        composition->neutralMass += getElementMass(atom.first) * atom.second;
     }
-    return mass;
+    auto countOf = [&composition](const string& element) {
+        for (const auto& atom : composition->elementCounts) {
+            if (atom.first == element)
+                return atom.second;
+        }
+        return 0;
+    };
+    composition->carbons = countOf(C_STRING_ID);
+    composition->hydrogens = countOf(H_STRING_ID);
+    composition->nitrogens = countOf(N_STRING_ID);
+    composition->sulfurs = countOf(S_STRING_ID);
+
+    lock_guard<mutex> guard(shard.lock);
+    if (shard.compositions.size() >= maxShardSize)
+        shard.compositions.clear();
+    shard.compositions[formula] = composition;
+    return composition;
+}
+
+map<string, int> MassCalculator::getComposition(string formula) {
+    auto composition = _cachedComposition(formula);
+    return map<string, int>(begin(composition->elementCounts),
+                            end(composition->elementCounts));
+}
+
+double MassCalculator::computeNeutralMass(string formula) {
+    return _cachedComposition(formula)->neutralMass;
 }
 
 double MassCalculator::adjustMass(double mass, int charge) {
@@ -99,6 +163,51 @@ double MassCalculator::computeMass(string formula, int charge) {
     return adjustMass(mass, charge);
 }
 
+/**
+ * @brief Factors of the binomial probability of finding k heavy atoms among n
+ * atoms of an element, for every k from 0 to n.
+ */
+struct _IsotopeTerms
+{
+    vector<double> choose;
+    vector<double> lightPowers;
+    vector<double> heavyPowers;
+};
+
+/**
+ * @brief Obtain the (shared, immutable) isotope terms for `atomCount` atoms of
+ * one of the labelled elements, computing them on first use.
+ * @param element Index of the element: 0 for carbon, 1 for nitrogen, 2 for
+ * sulfur and 3 for hydrogen.
+ * @param atomCount Number of atoms of the element in a formula.
+ */
+shared_ptr<const _IsotopeTerms> _isotopeTerms(int element, int atomCount)
+{
+    static const double abundances[4][2] = {{C12_ABUNDANCE, C13_ABUNDANCE},
+                                            {N14_ABUNDANCE, N15_ABUNDANCE},
+                                            {S32_ABUNDANCE, S34_ABUNDANCE},
+                                            {H_ABUNDANCE, H2_ABUNDANCE}};
+    static mutex lock;
+    static map<pair<int, int>, shared_ptr<const _IsotopeTerms>> cache;
+
+    auto key = make_pair(element, atomCount);
+    lock_guard<mutex> guard(lock);
+    auto cached = cache.find(key);
+    if (cached != end(cache))
+        return cached->second;
+
+    auto terms = make_shared<_IsotopeTerms>();
+    double light = abundances[element][0];
+    double heavy = abundances[element][1];
+    for (int k = 0; k <= atomCount; k++) {
+        terms->choose.push_back(mzUtils::nchoosek(atomCount, k));
+        terms->lightPowers.push_back(pow(light, atomCount - k));
+        terms->heavyPowers.push_back(pow(heavy, k));
+    }
+    cache[key] = terms;
+    return terms;
+}
+
 vector<Isotope> MassCalculator::computeIsotopes(string formula,
                                                 int charge,
                                                 bool C13Flag,
@@ -107,14 +216,14 @@ vector<Isotope> MassCalculator::computeIsotopes(string formula,
                                                 bool D2Flag,
                                                 Adduct* adduct)
 {
-    map<string, int> atoms = getComposition(formula);
-    int CatomCount = atoms[C_STRING_ID];
-    int NatomCount = atoms[N_STRING_ID];
-    int SatomCount = atoms[S_STRING_ID];
-    int HatomCount = atoms[H_STRING_ID];
+    auto composition = _cachedComposition(formula);
+    int CatomCount = composition->carbons;
+    int NatomCount = composition->nitrogens;
+    int SatomCount = composition->sulfurs;
+    int HatomCount = composition->hydrogens;
 
     vector<Isotope> isotopes;
-    double parentMass = computeNeutralMass(formula);
+    double parentMass = composition->neutralMass;
 
     Isotope parent(C12_PARENT_LABEL, parentMass);
     isotopes.push_back(parent);
@@ -184,6 +293,10 @@ vector<Isotope> MassCalculator::computeIsotopes(string formula,
         }
     }
 
+    auto carbonTerms = _isotopeTerms(0, CatomCount);
+    auto nitrogenTerms = _isotopeTerms(1, NatomCount);
+    auto sulfurTerms = _isotopeTerms(2, SatomCount);
+    auto hydrogenTerms = _isotopeTerms(3, HatomCount);
     for (unsigned int i = 0; i < isotopes.size(); i++) {
         Isotope& x = isotopes[i];
         int c = x.C13;
@@ -197,77 +310,115 @@ vector<Isotope> MassCalculator::computeIsotopes(string formula,
             isotopes[i].mass = adjustMass(isotopes[i].mass,charge);
         }
 
-        isotopes[i].abundance =
-            mzUtils::nchoosek(CatomCount, c) *
-            pow(C12_ABUNDANCE, CatomCount - c) * pow(C13_ABUNDANCE, c) *
-            mzUtils::nchoosek(NatomCount, n) *
-            pow(N14_ABUNDANCE, NatomCount - n) * pow(N15_ABUNDANCE, n) *
-            mzUtils::nchoosek(SatomCount, s) *
-            pow(S32_ABUNDANCE, SatomCount - s) * pow(S34_ABUNDANCE, s) *
-            mzUtils::nchoosek(HatomCount, d) *
-            pow(H_ABUNDANCE, HatomCount - d) * pow(H2_ABUNDANCE, d);
+        isotopes[i].abundance = carbonTerms->choose[c] *
+                                carbonTerms->lightPowers[c] *
+                                carbonTerms->heavyPowers[c] *
+                                nitrogenTerms->choose[n] *
+                                nitrogenTerms->lightPowers[n] *
+                                nitrogenTerms->heavyPowers[n] *
+                                sulfurTerms->choose[s] *
+                                sulfurTerms->lightPowers[s] *
+                                sulfurTerms->heavyPowers[s] *
+                                hydrogenTerms->choose[d] *
+                                hydrogenTerms->lightPowers[d] *
+                                hydrogenTerms->heavyPowers[d];
     }
 
     return isotopes;
 }
 
-void MassCalculator::enumerateMasses(double inputMass, double charge,
-    MassCutoff *massCutoff, vector<Match*>& matches) {
+/**
+ * @brief Half-width of the mass window around `mass` within which a candidate
+ * can possibly pass the given mass cutoff.
+ * @details For ppm cutoffs the distance is relative to the candidate mass,
+ * therefore the window is widened so that it covers both sides.
+ */
+double _massWindow(double mass, MassCutoff* massCutoff)
+{
+    double cutoff = massCutoff->getMassCutoff();
+    if (massCutoff->getMassCutoffType() == "ppm") {
+        double tolerance = cutoff / 1e6;
+        if (tolerance >= 1.0)
+            return numeric_limits<double>::infinity();
+        return mass * tolerance / (1.0 - tolerance);
+    }
+    return cutoff / 1e3;
+}
+
+vector<MassCalculator::Match>
+MassCalculator::enumerateMasses(double inputMass,
+                                double charge,
+                                MassCutoff* massCutoff)
+{
     if (charge > 0)
         inputMass = inputMass * abs(charge) - H_MASS * abs(charge);
     if (charge < 0)
         inputMass = inputMass * abs(charge) + H_MASS * abs(charge);
 
-    for (int c = 0; c < 30; c++) {  // C
-        if (c * 12 > inputMass) break;
+    double cutoff = massCutoff->getMassCutoff();
+    double window = _massWindow(inputMass, massCutoff);
+    double minMass = inputMass - window;
+    double maxMass = inputMass + window;
+
+    // every carbon count is an independent partition of the search space
+    int maxCarbons = 0;
+    while (maxCarbons < 30 && maxCarbons * 12 <= inputMass)
+        ++maxCarbons;
+    vector<vector<Match>> matchesPerCarbon(maxCarbons);
+
+#ifdef OMP_PARALLEL
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int c = 0; c < maxCarbons; c++) {  // C
+        auto& carbonMatches = matchesPerCarbon[c];
         for (int n = 0; n < 30; n++) {  // N
             if (c * 12 + n * 14 > inputMass) break;
             for (int o = 0; o < 30; o++) {  // O
                 if (c * 12 + n * 14 + o * 16 > inputMass) break;
-                for (int p = 0; p < 6; p++) {	  // P
+                for (int p = 0; p < 6; p++) {  // P
                     for (int s = 0; s < 6; s++) {  // S
-                        int hmax = c * 4 + o * 2 +
-                            n * 4 + p * 3 +
-                            s * 3;
-                        for (int h = 0; h < hmax;
-                                h++) {  // H
-                            double du =
-                                ((c * 2 + n + p) +
-                                 2 - h) /
-                                2;
-                            if (du < -0.5) continue;
-                            if (round(du / 0.5) !=
-                                    (du / 0.5))
-                                continue;
-
-                            double c12 =
-                                c * C12_MASS +
-                                o * O16_MASS +
-                                n * N14_MASS +
-                                p * P31_MASS +
-                                h * H_MASS +
-                                s * S32_MASS;
-                            double diff = massCutoffDist(
-                                    c12, inputMass,massCutoff);
-
-                            if (diff < massCutoff->getMassCutoff()) {
-                                string name =
-                                    prettyName(
-                                            c, h, n,
-                                            o, p,
-                                            s);
-                                MassCalculator::
-                                    Match* m =
-                                    new MassCalculator::
-                                    Match();
-                                m->name = name;
-                                m->mass = c12;
-                                m->diff = diff;
-                                m->compoundLink =
-                                    NULL;
-                                matches
-                                    .push_back(
-                                            m);
+                        // the unsaturation (RDBE) has to be at least zero,
+                        // which bounds hydrogens along with their valences
+                        int hmax = c * 4 + o * 2 + n * 4 + p * 3 + s * 3;
+                        int hUnsaturated = c * 2 + n + p + 4;
+                        int hEnd = min(hmax, hUnsaturated);
+                        if (hEnd <= 0)
+                            continue;
+
+                        // solve for the hydrogens that bring the mass within
+                        // the window, allowing a step of slack on both sides
+                        double baseMass = c * C12_MASS
+                                          + o * O16_MASS
+                                          + n * N14_MASS
+                                          + p * P31_MASS
+                                          + s * S32_MASS;
+                        int hBegin = 0;
+                        double hLow = floor((minMass - baseMass) / H_MASS) - 1;
+                        if (hLow > 0)
+                            hBegin = hLow < hEnd ? static_cast<int>(hLow)
+                                                 : hEnd;
+                        double hHigh = ceil((maxMass - baseMass) / H_MASS) + 2;
+                        if (hHigh < hEnd)
+                            hEnd = hHigh > hBegin ? static_cast<int>(hHigh)
+                                                  : hBegin;
+
+                        for (int h = hBegin; h < hEnd; h++) {  // H
+                            double c12 = c * C12_MASS
+                                         + o * O16_MASS
+                                         + n * N14_MASS
+                                         + p * P31_MASS
+                                         + h * H_MASS
+                                         + s * S32_MASS;
+                            double diff = massCutoffDist(c12,
+                                                         inputMass,
+                                                         massCutoff);
+                            if (diff < cutoff) {
+                                Match m = Match();
+                                m.name = prettyName(c, h, n, o, p, s);
+                                m.mass = c12;
+                                m.diff = diff;
+                                m.compoundLink = nullptr;
+                                carbonMatches.push_back(m);
                             }
                         }
                     }
@@ -275,7 +426,23 @@ void MassCalculator::enumerateMasses(double inputMass, double charge,
             }
         }
     }
-    std::sort(matches.begin(), matches.end(), compDiff);
+
+    vector<Match> matches;
+    for (auto& carbonMatches : matchesPerCarbon) {
+        matches.insert(end(matches),
+                       make_move_iterator(begin(carbonMatches)),
+                       make_move_iterator(end(carbonMatches)));
+    }
+    stable_sort(begin(matches),
+                end(matches),
+                [](const Match& a, const Match& b) { return a.diff < b.diff; });
+    return matches;
+}
+
+void MassCalculator::enumerateMasses(double inputMass, double charge,
+    MassCutoff *massCutoff, vector<Match*>& matches) {
+    for (auto& match : enumerateMasses(inputMass, charge, massCutoff))
+        matches.push_back(new Match(match));
 }
 
 std::string MassCalculator::prettyName(int c, int h, int n, int o, int p,
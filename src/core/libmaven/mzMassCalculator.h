@@ -100,6 +100,22 @@ class MassCalculator {
          */
         void enumerateMasses(double inputMass, double charge, MassCutoff *massCutoff, vector<Match*>& matches);
 
+        /**
+         * @brief Find all CHNOPS formulae whose mass lies within the given
+         * cutoff of an input m/z.
+         * @details Rather than trying every hydrogen count, the range of
+         * hydrogens that can bring a candidate within the cutoff is solved for
+         * directly and bounded by the unsaturation of the rest of the formula.
+         * Carbon counts are searched in parallel.
+         * @param inputMass The m/z to be decomposed.
+         * @param charge Charge of the ion, used to obtain its neutral mass.
+         * @param massCutoff Tolerance within which formulae are accepted.
+         * @return Matching formulae, sorted by their distance from input.
+         */
+        static vector<Match> enumerateMasses(double inputMass,
+                                             double charge,
+                                             MassCutoff* massCutoff);
+
 
         static vector<Isotope> computeIsotopes(string formula,
                                                int charge,
@@ -138,6 +154,19 @@ class MassCalculator {
         static double getElementMass(string elmnt);
         static void generateElementMassMap(string filename);
 
+        struct _Composition;
+
+        /**
+         * @brief Parse a formula, or fetch the result of an earlier parse.
+         * @details Parsed formulas are shared by all threads and are never
+         * modified after being cached, so the returned object can be read
+         * without any locking.
+         * @param formula Formula to be parsed.
+         * @return Element counts and neutral mass of the formula.
+         */
+        static shared_ptr<const _Composition>
+        _cachedComposition(const string& formula);
+
 };
 
 #endif
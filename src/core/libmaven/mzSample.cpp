@@ -11,10 +11,18 @@
 #include "EIC.h"
 #include "Scan.h"
 
+#include <numeric>
+#include <queue>
+
+#include <QFile>
+
 #include <MavenException.h>
 
 // global options
 int mzSample::filter_minIntensity = -1;
+unsigned int mzSample::_nextIndex = 0;
+set<unsigned int> mzSample::_freeIndexes;
+mutex mzSample::_indexMutex;
 bool mzSample::filter_centroidScans = false;
 int mzSample::filter_intensityQuantile = 0;
 int mzSample::filter_polarity = 0;
@@ -23,9 +31,20 @@ int mzSample::filter_mslevel = 0;
 mzSample::mzSample() : _setName(""), injectionOrder(0)
 {
     _id = -1;
+    {
+        lock_guard<mutex> lock(_indexMutex);
+        if (_freeIndexes.empty()) {
+            _index = _nextIndex++;
+        } else {
+            _index = *_freeIndexes.begin();
+            _freeIndexes.erase(_freeIndexes.begin());
+        }
+    }
     _numMS1Scans = 0;
     _numMS2Scans = 0;
     _msMsType = MsMsType::None;
+    _ms2ScansIndexed = false;
+    _summarizedScans = 0;
     maxMz = maxRt = 0;
     minMz = minRt = 0;
     isBlank = false;
@@ -54,6 +73,9 @@ mzSample::~mzSample()
         if (scans[i] != NULL)
             delete (scans[i]);
     scans.clear();
+
+    lock_guard<mutex> lock(_indexMutex);
+    _freeIndexes.insert(_index);
 }
 
 void mzSample::addScan(Scan* s)
@@ -174,6 +196,12 @@ void mzSample::loadSample(string filename)
     // getting the SRM scan type
     enumerateSRMScans();
 
+    // indexing MS2 scans by their precursor
+    indexMs2Scans();
+
+    // summarizing intensities for chromatograms and quantiles
+    summarizeIntensities();
+
     // set min and max values for rt and mz
     calculateMzRtRange();
 
@@ -184,82 +212,218 @@ void mzSample::loadSample(string filename)
     checkSampleBlank(filename.c_str());
 }
 
+void _appendInt(string& out, long value)
+{
+    char digits[24];
+    char* p = digits + sizeof(digits);
+    unsigned long magnitude = value < 0 ? -static_cast<unsigned long>(value)
+                                        : value;
+    do {
+        *--p = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0)
+        *--p = '-';
+    out.append(p, digits + sizeof(digits) - p);
+}
+
+/**
+ * @brief Append a float to a string formatted as `operator<<` would with a
+ * precision of 9 significant digits, which is enough to read every float
+ * back exactly.
+ */
+void _appendFloat(string& out, float value)
+{
+    // special values are told apart by their bits, which are left alone by
+    // fast math optimizations
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if (bits >> 31) {
+        out += '-';
+        value = -value;
+    }
+    if ((bits & 0x7f800000) == 0x7f800000) {
+        out += (bits & 0x007fffff) ? "nan" : "inf";
+        return;
+    }
+    if (value == 0) {
+        out += '0';
+        return;
+    }
+
+    // nine significant digits, as an integer in [1e8, 1e9), along with the
+    // decimal exponent of the first one
+    static const double powersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,
+                                         1e5,  1e6,  1e7,  1e8,  1e9,
+                                         1e10, 1e11, 1e12, 1e13, 1e14,
+                                         1e15, 1e16, 1e17, 1e18, 1e19,
+                                         1e20, 1e21, 1e22};
+    double v = value;
+    int exponent = floor(log10(v));
+    auto scaled = [&](int exponent) {
+        int power = 8 - exponent;
+        if (power >= 0 && power <= 22)
+            return llrint(v * powersOfTen[power]);
+        if (power < 0 && power >= -22)
+            return llrint(v / powersOfTen[-power]);
+        return llrint(v * pow(10.0, power));
+    };
+    long long significand = scaled(exponent);
+    if (significand < 100000000)
+        significand = scaled(--exponent);
+    if (significand >= 1000000000)
+        significand = scaled(++exponent);
+
+    char digits[9];
+    for (int i = 8; i >= 0; i--) {
+        digits[i] = '0' + significand % 10;
+        significand /= 10;
+    }
+    int numDigits = 9;
+    while (numDigits > 1 && digits[numDigits - 1] == '0')
+        numDigits--;
+
+    if (exponent < -4 || exponent >= 9) {
+        out += digits[0];
+        if (numDigits > 1) {
+            out += '.';
+            out.append(digits + 1, numDigits - 1);
+        }
+        out += exponent < 0 ? "e-" : "e+";
+        int magnitude = abs(exponent);
+        if (magnitude < 10)
+            out += '0';
+        _appendInt(out, magnitude);
+    } else if (exponent < 0) {
+        out += "0.";
+        out.append(-exponent - 1, '0');
+        out.append(digits, numDigits);
+    } else {
+        int integerDigits = exponent + 1;
+        out.append(digits, min(numDigits, integerDigits));
+        if (numDigits > integerDigits) {
+            out += '.';
+            out.append(digits + integerDigits, numDigits - integerDigits);
+        } else {
+            out.append(integerDigits - numDigits, '0');
+        }
+    }
+}
+
 void mzSample::parseMzCSV(const char* filename)
 {
     // file structure:
     // scannum,rt,mz,intensity,mslevel,precursorMz,polarity,srmid
-    int lineNum = 0;
 
-    ifstream myfile(filename);
-    if (!myfile.is_open())
+    // map the file into memory, falling back to reading it in full
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
         throw(MavenException(ErrorMsg::FileNotFound));
 
-    std::stringstream ss;
-    std::string line;
-    std::string polarity;
+    qint64 fileSize = file.size();
+    const char* data = reinterpret_cast<const char*>(file.map(0, fileSize));
+    string contents;
+    if (data == nullptr && fileSize > 0) {
+        ifstream stream(filename, ios::in | ios::binary);
+        contents.assign(istreambuf_iterator<char>(stream),
+                        istreambuf_iterator<char>());
+        data = contents.data();
+        fileSize = static_cast<qint64>(contents.size());
+    }
+    if (data == nullptr || fileSize == 0)
+        return;
 
     int lastScanNum = -1;
-    int scannum = 0;
-    float rt = 0;
-    float intensity = 0;
-    float mz = 0;
-    float precursorMz = 0;
-    int mslevel = 0;
-
     Scan* scan = NULL;
     int newscannum = 0;
 
-    while (getline(myfile, line)) {
-        lineNum++;
-        vector<string> fields;
-        fields = mzUtils::split(line, ",");
-        if (fields.size() >= 5 && lineNum > 1) {
-            ss.clear();
-
-            ss << fields[0] << " " << fields[1] << " " << fields[2] << " "
-               << fields[3] << " " << fields[4] << " " << fields[5] << " "
-               << fields[6];
-
-            ss >> scannum >> rt >> mz >> intensity >> mslevel >> precursorMz
-                >> polarity;
-
-            if (scannum != lastScanNum) {
-                newscannum++;
-                if (mslevel <= 0)
-                    mslevel = 1;
-                int scanpolarity = 0;
-                if (polarity.empty() && fields.size() > 7)
-                    polarity = fields[7];
-                if (!polarity.empty() && polarity[0] == '+')
-                    scanpolarity = 1;
-                if (!polarity.empty() && polarity[0] == '-')
-                    scanpolarity = -1;
-                scan = new Scan(this,
-                                newscannum,
-                                mslevel,
-                                rt / 60,
-                                precursorMz,
-                                scanpolarity);
-                if (mslevel > 1)
-                    scan->productMz = mz;
+    // each line is split into fields in place, every field being parsed on
+    // its own as a stream would do with it
+    const int maxFields = 8;
+    const char* fieldBegins[maxFields];
+    const char* fieldEnds[maxFields];
+    const char* end = data + fileSize;
+    bool header = true;
+    for (const char* line = data; line < end; ) {
+        auto newline = static_cast<const char*>(memchr(line,
+                                                       '\n',
+                                                       end - line));
+        const char* lineEnd = newline ? newline : end;
+        const char* next = newline ? newline + 1 : end;
+        if (lineEnd > line && lineEnd[-1] == '\r')
+            lineEnd--;
+        if (header) {
+            header = false;
+            line = next;
+            continue;
+        }
 
-                addScan(scan);
-                if (fields.size() > 7)
-                    scan->filterLine = fields[7];  // last field is srmId
+        int numFields = 0;
+        for (const char* field = line; ; ) {
+            auto comma = static_cast<const char*>(memchr(field,
+                                                         ',',
+                                                         lineEnd - field));
+            if (numFields < maxFields) {
+                fieldBegins[numFields] = field;
+                fieldEnds[numFields] = comma ? comma : lineEnd;
             }
-
-            scan->mz.push_back(mz);
-            scan->intensity.push_back(intensity);
-            lastScanNum = scannum;
+            numFields++;
+            if (comma == nullptr)
+                break;
+            field = comma + 1;
+        }
+        line = next;
+        if (numFields < 5)
+            continue;
+        for (int i = numFields; i < maxFields; i++)
+            fieldBegins[i] = fieldEnds[i] = lineEnd;
+
+        int scannum = mzUtils::string2integer(fieldBegins[0], fieldEnds[0]);
+        float mz = mzUtils::string2float(fieldBegins[2], fieldEnds[2]);
+        float intensity = mzUtils::string2float(fieldBegins[3], fieldEnds[3]);
+        if (scannum != lastScanNum) {
+            newscannum++;
+            float rt = mzUtils::string2float(fieldBegins[1], fieldEnds[1]);
+            int mslevel = mzUtils::string2integer(fieldBegins[4],
+                                                  fieldEnds[4]);
+            float precursorMz = mzUtils::string2float(fieldBegins[5],
+                                                      fieldEnds[5]);
+            if (mslevel <= 0)
+                mslevel = 1;
+
+            // polarity is taken from the srmid column if its own is empty
+            const char* polarity = fieldBegins[6];
+            while (polarity < fieldEnds[6] && isspace(*polarity))
+                polarity++;
+            if (polarity == fieldEnds[6])
+                polarity = fieldBegins[7];
+            int scanpolarity = 0;
+            if (polarity < lineEnd && *polarity == '+')
+                scanpolarity = 1;
+            if (polarity < lineEnd && *polarity == '-')
+                scanpolarity = -1;
+            scan = new Scan(this,
+                            newscannum,
+                            mslevel,
+                            rt / 60,
+                            precursorMz,
+                            scanpolarity);
+            if (mslevel > 1)
+                scan->productMz = mz;
+
+            addScan(scan);
+            if (numFields > 7)  // last field is srmId
+                scan->filterLine.assign(fieldBegins[7], fieldEnds[7]);
         }
+
+        scan->mz.push_back(mz);
+        scan->intensity.push_back(intensity);
+        lastScanNum = scannum;
     }
 }
 
-// void mzSample::writeMzCSV(const char* filename) const {
 void mzSample::writeMzCSV(const char* filename)
 {
-    // TODO naman unused function
-
     ofstream mzCSV;
     mzCSV.open(filename);
     if (!mzCSV.is_open()) {
@@ -267,18 +431,43 @@ void mzSample::writeMzCSV(const char* filename)
         return;
     }
 
-    mzCSV << "scannum,rt,mz,intensity,mslevel,precursorMz,polarity,srmid"
-          << endl;
+    // lines are gathered in a buffer that is written out whenever it fills
+    // up, and the columns shared by all points of a scan are formatted once
+    const size_t bufferSize = 1 << 22;
+    string buffer;
+    buffer.reserve(bufferSize + 1024);
+    buffer = "scannum,rt,mz,intensity,mslevel,precursorMz,polarity,srmid\n";
+    string scanColumns;
+    string scanTrailingColumns;
     for (unsigned int i = 0; i < scans.size(); i++) {
         Scan* scan = scans[i];
+        scanColumns.clear();
+        _appendInt(scanColumns, scan->scannum + 1);
+        scanColumns += ',';
+        _appendFloat(scanColumns, scan->rt * 60);
+        scanColumns += ',';
+
+        scanTrailingColumns = ",";
+        _appendInt(scanTrailingColumns, scan->mslevel);
+        scanTrailingColumns += ',';
+        _appendFloat(scanTrailingColumns, scan->precursorMz);
+        scanTrailingColumns += scan->getPolarity() > 0 ? ",+," : ",-,";
+        scanTrailingColumns += scan->filterLine;
+        scanTrailingColumns += '\n';
+
         for (unsigned int j = 0; j < scan->nobs(); j++) {
-            mzCSV << scan->scannum + 1 << "," << scan->rt * 60 << ","
-                  << scan->mz[j] << "," << scan->intensity[j] << ","
-                  << scan->mslevel << "," << scan->precursorMz << ","
-                  << (scan->getPolarity() > 0 ? "+" : "-") << ","
-                  << scan->filterLine << endl;
+            buffer += scanColumns;
+            _appendFloat(buffer, scan->mz[j]);
+            buffer += ',';
+            _appendFloat(buffer, scan->intensity[j]);
+            buffer += scanTrailingColumns;
+            if (buffer.size() >= bufferSize) {
+                mzCSV.write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
         }
     }
+    mzCSV.write(buffer.data(), buffer.size());
 }
 
 int mzSample::getPolarity()
@@ -1143,6 +1332,116 @@ void mzSample::enumerateSRMScans()
     }
 }
 
+void mzSample::indexMs2Scans()
+{
+    _ms2ScansByPrecursor.clear();
+    for (unsigned int i = 0; i < scans.size(); i++) {
+        if (scans[i]->mslevel == 2)
+            _ms2ScansByPrecursor.push_back(i);
+    }
+    stable_sort(begin(_ms2ScansByPrecursor),
+                end(_ms2ScansByPrecursor),
+                [this](unsigned int a, unsigned int b) {
+                    if (scans[a]->precursorMz != scans[b]->precursorMz)
+                        return scans[a]->precursorMz < scans[b]->precursorMz;
+                    return scans[a]->collisionEnergy < scans[b]->collisionEnergy;
+                });
+    _ms2ScansIndexed = true;
+}
+
+void mzSample::summarizeIntensities()
+{
+    _intensitySummaries.clear();
+    for (unsigned int s = 0; s < scans.size(); s++) {
+        Scan* scan = scans[s];
+        auto& summary = _intensitySummaries[scan->mslevel];
+
+        float maxMz = 0;
+        float maxIntensity = 0;
+        for (unsigned int i = 0; i < scan->intensity.size(); i++) {
+            float intensity = scan->intensity[i];
+            if (intensity > maxIntensity) {
+                maxIntensity = intensity;
+                maxMz = scan->mz[i];
+            }
+            summary.intensities.add(intensity);
+        }
+        summary.scanIndices.push_back(s);
+        summary.totalIntensities.push_back(scan->totalIntensity());
+        summary.basePeakMzs.push_back(maxMz);
+        summary.basePeakIntensities.push_back(maxIntensity);
+    }
+    _summarizedScans = scans.size();
+}
+
+const mzSample::IntensitySummary* mzSample::_intensitySummary(int mslevel)
+{
+    if (_summarizedScans != scans.size())
+        summarizeIntensities();
+
+    auto summary = _intensitySummaries.find(mslevel);
+    if (summary == end(_intensitySummaries))
+        return nullptr;
+    return &(summary->second);
+}
+
+vector<unsigned int> mzSample::_ms2ScanCandidates(float precursorMz,
+                                                  float collisionEnergy,
+                                                  string filterline,
+                                                  float amuQ1)
+{
+    vector<unsigned int> candidates;
+    if (!_ms2ScansIndexed) {
+        candidates.resize(scans.size());
+        iota(begin(candidates), end(candidates), 0);
+        return candidates;
+    }
+
+    if (filterline != "") {
+        auto srmScansForFilterline = srmScans.find(filterline);
+        if (srmScansForFilterline != end(srmScans)) {
+            for (auto i : srmScansForFilterline->second)
+                candidates.push_back(i);
+        }
+        return candidates;
+    }
+
+    if (precursorMz == 0.0f) {
+        candidates = _ms2ScansByPrecursor;
+        sort(begin(candidates), end(candidates));
+        return candidates;
+    }
+
+    // the window is padded to absorb rounding, the exact Q1 check is left to
+    // the caller
+    float padding = 0.001f;
+    float minPrecursorMz = precursorMz - amuQ1 - padding;
+    float maxPrecursorMz = precursorMz + amuQ1 + padding;
+    auto first = lower_bound(begin(_ms2ScansByPrecursor),
+                             end(_ms2ScansByPrecursor),
+                             minPrecursorMz,
+                             [this](unsigned int i, float mz) {
+                                 return scans[i]->precursorMz < mz;
+                             });
+    auto last = upper_bound(first,
+                            end(_ms2ScansByPrecursor),
+                            maxPrecursorMz,
+                            [this](float mz, unsigned int i) {
+                                return mz < scans[i]->precursorMz;
+                            });
+    for (auto it = first; it != last; ++it) {
+        Scan* scan = scans[*it];
+        if (collisionEnergy != 0.0f
+            && scan->collisionEnergy != 0.0f
+            && abs(scan->collisionEnergy - collisionEnergy) > 0.5) {
+            continue;
+        }
+        candidates.push_back(*it);
+    }
+    sort(begin(candidates), end(candidates));
+    return candidates;
+}
+
 Scan* mzSample::getScan(unsigned int scanNum)
 {
     if (scanNum >= scans.size())
@@ -1178,7 +1477,11 @@ EIC* mzSample::getEIC(float precursorMz,
     map<string, EIC*> filterlineEicMap;
     map<string, vector<float>> filterlinePrecursorDeltas;
     map<string, vector<float>> filterlineProductDeltas;
-    for (unsigned int i = 0; i < scans.size(); i++) {
+    auto candidates = _ms2ScanCandidates(precursorMz,
+                                         collisionEnergy,
+                                         filterline,
+                                         amuQ1);
+    for (auto i : candidates) {
         Scan* scan = scans[i];
         if (filterline != "" && scan->filterLine != filterline)
             continue;
@@ -1263,12 +1566,8 @@ EIC* mzSample::getEIC(float precursorMz,
         }
 
         EIC* e = nullptr;
-        vector<float> precursorDeltas;
-        vector<float> productDeltas;
         if (filterlineEicMap.count(eicFilterline) > 0) {
             e = filterlineEicMap[eicFilterline];
-            precursorDeltas = filterlinePrecursorDeltas[eicFilterline];
-            productDeltas = filterlineProductDeltas[eicFilterline];
         } else {
             e = newEic();
             filterlineEicMap[eicFilterline] = e;
@@ -1306,10 +1605,10 @@ EIC* mzSample::getEIC(float precursorMz,
             e->mzAtMaxIntensity = eicMz;
         }
 
-        precursorDeltas.push_back(abs(scan->precursorMz - precursorMz));
-        filterlinePrecursorDeltas[eicFilterline] = precursorDeltas;
-        productDeltas.push_back(abs(eicMz - productMz));
-        filterlineProductDeltas[eicFilterline] = productDeltas;
+        filterlinePrecursorDeltas[eicFilterline].push_back(
+            abs(scan->precursorMz - precursorMz));
+        filterlineProductDeltas[eicFilterline].push_back(
+            abs(eicMz - productMz));
     }
 
     // lambda: make some adjustments to the generated EIC before returning
@@ -1563,9 +1862,6 @@ EIC* mzSample::getTIC(float rtmin, float rtmax, int mslevel)
     if (rtmax > this->maxRt)
         rtmax = this->maxRt;
 
-    // cerr << "getEIC()" << setprecision(7) << mzmin << " " << mzmax << " " <<
-    // rtmin << " " << rtmax << endl;
-
     EIC* e = new EIC();
     e->sampleName = sampleName;
     e->sample = this;
@@ -1574,24 +1870,25 @@ EIC* mzSample::getTIC(float rtmin, float rtmax, int mslevel)
     e->totalIntensity = 0;
     e->maxIntensity = 0;
 
-    int scanCount = scans.size();
-    if (scanCount == 0)
+    auto summary = _intensitySummary(mslevel);
+    if (summary == nullptr)
         return e;
 
-    for (int i = 0; i < scanCount; i++) {
-        if (scans[i]->mslevel == mslevel) {
-            Scan* scan = scans[i];
-            float y = scan->totalIntensity();
-            e->mz.push_back(0);
-            e->scannum.push_back(i);
-            e->rt.push_back(scan->rt);
-            e->intensity.push_back(y);
-            e->totalIntensity += y;
-            if (y > e->maxIntensity) {
-                e->maxIntensity = y;
-                e->rtAtMaxIntensity = scan->rt;
-                e->mzAtMaxIntensity = 0;
-            }
+    size_t scanCount = summary->scanIndices.size();
+    e->mz.assign(scanCount, 0);
+    e->scannum.assign(summary->scanIndices.begin(),
+                      summary->scanIndices.end());
+    e->rt.reserve(scanCount);
+    e->intensity = summary->totalIntensities;
+    for (size_t i = 0; i < scanCount; i++) {
+        float rt = scans[summary->scanIndices[i]]->rt;
+        float y = summary->totalIntensities[i];
+        e->rt.push_back(rt);
+        e->totalIntensity += y;
+        if (y > e->maxIntensity) {
+            e->maxIntensity = y;
+            e->rtAtMaxIntensity = rt;
+            e->mzAtMaxIntensity = 0;
         }
     }
     if (e->rt.size() > 0) {
@@ -1610,9 +1907,6 @@ EIC* mzSample::getBIC(float rtmin, float rtmax, int mslevel)
     if (rtmax > this->maxRt)
         rtmax = this->maxRt;
 
-    // cerr << "getEIC()" << setprecision(7) << mzmin << " " << mzmax << " " <<
-    // rtmin << " " << rtmax << endl;
-
     EIC* e = new EIC();
     e->sampleName = sampleName;
     e->sample = this;
@@ -1621,31 +1915,25 @@ EIC* mzSample::getBIC(float rtmin, float rtmax, int mslevel)
     e->totalIntensity = 0;
     e->maxIntensity = 0;
 
-    int scanCount = scans.size();
-    if (scanCount == 0)
+    auto summary = _intensitySummary(mslevel);
+    if (summary == nullptr)
         return e;
 
-    for (int i = 0; i < scanCount; i++) {
-        if (scans[i]->mslevel == mslevel) {
-            Scan* scan = scans[i];
-            float maxMz = 0;
-            float maxIntensity = 0;
-            for (unsigned int i = 0; i < scan->intensity.size(); i++) {
-                if (scan->intensity[i] > maxIntensity) {
-                    maxIntensity = scan->intensity[i];
-                    maxMz = scan->mz[i];
-                }
-            }
-            e->mz.push_back(maxMz);
-            e->scannum.push_back(i);
-            e->rt.push_back(scan->rt);
-            e->intensity.push_back(maxIntensity);
-            e->totalIntensity += maxIntensity;
-            if (maxIntensity > e->maxIntensity) {
-                e->maxIntensity = maxIntensity;
-                e->rtAtMaxIntensity = scan->rt;
-                e->mzAtMaxIntensity = maxMz;
-            }
+    size_t scanCount = summary->scanIndices.size();
+    e->mz = summary->basePeakMzs;
+    e->scannum.assign(summary->scanIndices.begin(),
+                      summary->scanIndices.end());
+    e->rt.reserve(scanCount);
+    e->intensity = summary->basePeakIntensities;
+    for (size_t i = 0; i < scanCount; i++) {
+        float rt = scans[summary->scanIndices[i]]->rt;
+        float maxIntensity = summary->basePeakIntensities[i];
+        e->rt.push_back(rt);
+        e->totalIntensity += maxIntensity;
+        if (maxIntensity > e->maxIntensity) {
+            e->maxIntensity = maxIntensity;
+            e->rtAtMaxIntensity = rt;
+            e->mzAtMaxIntensity = summary->basePeakMzs[i];
         }
     }
     if (e->rt.size() > 0) {
@@ -1929,50 +2217,170 @@ int mzSample::parseCDF(const char* filename, int is_verbose)
     return 1;
 }
 
+// points of a scan in the order of their m/z bins, as used for averaging
+struct _BinnedScan {
+    const Scan* scan;
+    vector<float> bins;
+    vector<unsigned int> points;  // empty if points are already in bin order
+};
+
+_BinnedScan _binScan(const Scan* scan, float sd)
+{
+    _BinnedScan binned;
+    binned.scan = scan;
+    binned.bins.reserve(scan->mz.size());
+    for (unsigned int i = 0; i < scan->mz.size(); i++)
+        binned.bins.push_back(FLOATROUND(scan->mz[i], sd));
+
+    if (!is_sorted(begin(binned.bins), end(binned.bins))) {
+        // points sharing a bin keep their order, as they are summed in it
+        binned.points.resize(binned.bins.size());
+        iota(begin(binned.points), end(binned.points), 0);
+        stable_sort(begin(binned.points),
+                    end(binned.points),
+                    [&](unsigned int a, unsigned int b) {
+                        return binned.bins[a] < binned.bins[b];
+                    });
+        vector<float> sortedBins;
+        sortedBins.reserve(binned.bins.size());
+        for (auto point : binned.points)
+            sortedBins.push_back(binned.bins[point]);
+        binned.bins = sortedBins;
+    }
+    return binned;
+}
+
+// average the points of all scans whose bins lie in [binMin, binMax), by
+// merging the scans' points in order of their bins; points of a bin are
+// summed scan by scan, in the same order as visiting each scan in turn
+void _averageBins(const vector<_BinnedScan>& binnedScans,
+                  float binMin,
+                  float binMax,
+                  vector<float>& mzs,
+                  vector<float>& intensities)
+{
+    typedef pair<float, unsigned int> Cursor;  // bin and scan of next point
+    priority_queue<Cursor, vector<Cursor>, greater<Cursor>> heap;
+    vector<size_t> positions(binnedScans.size());
+    vector<size_t> ends(binnedScans.size());
+    for (unsigned int s = 0; s < binnedScans.size(); s++) {
+        const auto& bins = binnedScans[s].bins;
+        positions[s] = lower_bound(begin(bins), end(bins), binMin) - begin(bins);
+        ends[s] = lower_bound(begin(bins), end(bins), binMax) - begin(bins);
+        if (positions[s] < ends[s])
+            heap.push(make_pair(bins[positions[s]], s));
+    }
+
+    float currentBin = 0;
+    double totalIntensity = 0;
+    double weightedMz = 0;
+    int count = 0;
+    auto flush = [&]() {
+        if (count == 0)
+            return;
+        double avgMz = weightedMz / totalIntensity;
+        mzs.push_back((float)avgMz);
+        intensities.push_back((float)totalIntensity / count);
+    };
+
+    while (!heap.empty()) {
+        unsigned int s = heap.top().second;
+        float bin = heap.top().first;
+        heap.pop();
+        if (count == 0 || bin != currentBin) {
+            flush();
+            currentBin = bin;
+            totalIntensity = 0;
+            weightedMz = 0;
+            count = 0;
+        }
+
+        const auto& binned = binnedScans[s];
+        size_t& position = positions[s];
+        while (position < ends[s] && binned.bins[position] == bin) {
+            unsigned int i = binned.points.empty() ? position
+                                                   : binned.points[position];
+            totalIntensity += ((double)binned.scan->intensity[i]);
+            weightedMz += ((double)(binned.scan->intensity[i])
+                           * (binned.scan->mz[i]));
+            count++;
+            position++;
+        }
+        if (position < ends[s])
+            heap.push(make_pair(binned.bins[position], s));
+    }
+    flush();
+}
+
 Scan* mzSample::getAverageScan(float rtmin,
                                float rtmax,
                                int mslevel,
                                int polarity,
                                float sd)
 {
-    // TODO naman unused function
-
     float rt = rtmin + (rtmax - rtmin) / 2;
-    int scanCount = 0;
     int scannum = 0;
 
-    map<float, double> mz_intensity_map;
-    map<float, double> mz_bin_map;
-    map<float, int> mz_count;
-
+    vector<const Scan*> selectedScans;
     for (unsigned int s = 0; s < scans.size(); s++) {
         if (scans[s]->getPolarity() != polarity || scans[s]->mslevel != mslevel
             || scans[s]->rt < rtmin || scans[s]->rt > rtmax)
             continue;
-
-        Scan* scan = scans[s];
-        scanCount++;
-        for (unsigned int i = 0; i < scan->mz.size(); i++) {
-            float bin = FLOATROUND(scan->mz[i], sd);
-            mz_intensity_map[bin] += ((double)scan->intensity[i]);
-            mz_bin_map[bin] += ((double)(scan->intensity[i]) * (scan->mz[i]));
-            mz_count[bin]++;
+        selectedScans.push_back(scans[s]);
+    }
+    int scanCount = selectedScans.size();
+
+    vector<_BinnedScan> binnedScans(scanCount);
+    size_t numPoints = 0;
+#pragma omp parallel for reduction(+:numPoints)
+    for (int s = 0; s < scanCount; s++) {
+        binnedScans[s] = _binScan(selectedScans[s], sd);
+        numPoints += binnedScans[s].bins.size();
+    }
+
+    // large sets of points are split into ranges of bins, which hold similar
+    // numbers of points and are averaged in parallel
+    vector<float> boundaries;
+    const size_t pointsPerRange = 100000;
+    if (numPoints > pointsPerRange) {
+        vector<float> sampledBins;
+        for (const auto& binned : binnedScans) {
+            for (size_t i = 0; i < binned.bins.size(); i += 64)
+                sampledBins.push_back(binned.bins[i]);
         }
+        sort(begin(sampledBins), end(sampledBins));
+        size_t numRanges = min(numPoints / pointsPerRange, (size_t)64);
+        for (size_t r = 1; r < numRanges; r++)
+            boundaries.push_back(sampledBins[r * sampledBins.size() / numRanges]);
+        boundaries.erase(unique(begin(boundaries), end(boundaries)),
+                         end(boundaries));
+    }
+    boundaries.insert(begin(boundaries), -FLT_MAX);
+    boundaries.push_back(FLT_MAX);
+
+    int numRanges = boundaries.size() - 1;
+    vector<vector<float>> rangeMzs(numRanges);
+    vector<vector<float>> rangeIntensities(numRanges);
+#pragma omp parallel for schedule(dynamic)
+    for (int r = 0; r < numRanges; r++) {
+        _averageBins(binnedScans,
+                     boundaries[r],
+                     boundaries[r + 1],
+                     rangeMzs[r],
+                     rangeIntensities[r]);
     }
 
     Scan* avgScan =
         new Scan(this, scannum, mslevel, rt / scanCount, 0, polarity);
-
-    map<float, double>::iterator itr;
-    for (itr = mz_intensity_map.begin(); itr != mz_intensity_map.end(); ++itr) {
-        float bin = (*itr).first;
-        double totalIntensity = (*itr).second;
-        double avgMz = mz_bin_map[bin] / totalIntensity;
-        avgScan->mz.push_back((float)avgMz);
-        avgScan->intensity.push_back((float)totalIntensity / mz_count[bin]);
-    }
-    // cout << "getAverageScan() from:" << from << " to:" << to << " scanCount:"
-    // << scanCount << "scans. mzs=" << avgScan->nobs() << endl;
+    for (int r = 0; r < numRanges; r++) {
+        avgScan->mz.insert(end(avgScan->mz),
+                           begin(rangeMzs[r]),
+                           end(rangeMzs[r]));
+        avgScan->intensity.insert(end(avgScan->intensity),
+                                  begin(rangeIntensities[r]),
+                                  end(rangeIntensities[r]));
+    }
+    avgScan->centroided = true;
     return avgScan;
 }
 
@@ -2019,18 +2427,11 @@ vector<Scan*> mzSample::getFragmentationEvents(mzSlice* slice)
 
 vector<float> mzSample::getIntensityDistribution(int mslevel)
 {
-    vector<float> allintensities;
-    for (unsigned int s = 0; s < this->scans.size(); s++) {
-        Scan* scan = this->scans[s];
-        if (scan->mslevel != mslevel)
-            continue;
-
-        for (unsigned int i = 0; i < scan->mz.size(); i++) {
-            allintensities.push_back(scan->intensity[i]);
-        }
-    }
+    auto summary = _intensitySummary(mslevel);
+    if (summary == nullptr)
+        return QuantileSketch().quantileDistribution();
 
-    return (quantileDistribution(allintensities));
+    return (summary->intensities.quantileDistribution());
 }
 
 /*
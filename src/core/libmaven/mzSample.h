@@ -7,8 +7,11 @@
 #include "assert.h"
 #include "mzUtils.h"
 #include "pugixml.hpp"
+#include "quantileSketch.h"
 #include "standardincludes.h"
 
+#include <mutex>
+
 #ifdef ZLIB
 #include <zlib.h>
 #endif
@@ -245,6 +248,8 @@ public:
 
     /**
     * @brief Write mzCSV file
+    * @details Values are written with as many digits as needed for
+    * `parseMzCSV` to read them back exactly.
     * @param char* mzCSV file name
     */
     void writeMzCSV(const char *);
@@ -308,6 +313,26 @@ public:
     */
     void enumerateSRMScans();
 
+    /**
+    * @brief Index MS2 scans by their precursor m/z and collision energy.
+    * @details Once indexed, EICs for precursor-product transitions only
+    * visit the scans whose precursor lies within the Q1 window, instead of
+    * every scan in the sample. Called when a sample is loaded; scans added
+    * afterwards are not part of the index until this is called again.
+    */
+    void indexMs2Scans();
+
+    /**
+    * @brief Summarize the intensities of all scans, for each MS level.
+    * @details The total and base peak intensity of every scan are stored,
+    * along with a sketch of the distribution of all intensities, so that
+    * TIC and BIC chromatograms and intensity quantiles can be obtained
+    * without going over all peaks again. Retention times are not part of
+    * the summaries and are always read from the scans. Called when a sample
+    * is loaded; summaries are rebuilt if the number of scans changes later.
+    */
+    void summarizeIntensities();
+
     /**
     * @brief Find correlation between two EICs
     * @param mz1 m/z for first EIC
@@ -374,6 +399,11 @@ public:
 
     /**
     * @brief Get Average Scan
+    * @details Points of all scans within the retention time window are put
+    * into m/z bins of width 1/resolution, and each bin yields one centroid
+    * with the intensity-weighted mean m/z and the mean intensity of its
+    * points. The scans' points are merged in order of their bins, in
+    * parallel over ranges of bins for large windows.
     * @param rtmin Minimum retention time
     * @param rtmax Maximum retention time
     * @param mslevel MS Level
@@ -497,6 +527,17 @@ public:
      */
     inline void setSampleId(const int id) { _id = id; }
 
+    /**
+     * @brief Obtain the index of this sample, which is assigned when the
+     * sample is created and stays the same for its lifetime.
+     * @details No two live samples share an index. The index of a deleted
+     * sample is handed to the next sample created, lowest first, so indexes
+     * stay below the largest number of samples alive at any one time and can
+     * be used to directly index per-sample tables.
+     * @return Sample index as an unsigned integer.
+     */
+    inline unsigned int getSampleIndex() const { return _index; }
+
     /**
                           * [get Sample Name]
                           * @method getSampleName
@@ -684,6 +725,12 @@ public:
                           */
     static int getFilter_polarity() { return filter_polarity; }
 
+    /**
+     * @brief Percentiles of the intensities of all peaks at an MS level.
+     * @details Estimated from the intensity summary of the sample, with a
+     * relative error of at most 0.4%.
+     * @see QuantileSketch
+     */
     vector<float> getIntensityDistribution(int mslevel);
 
     inline void setMsMsType(MsMsType msMsType) { _msMsType = msMsType; }
@@ -734,10 +781,46 @@ public:
 
   private:
     int _id;
+    unsigned int _index;
+    static unsigned int _nextIndex;
+    static set<unsigned int> _freeIndexes;
+    static mutex _indexMutex;
     unsigned int _numMS1Scans;
     unsigned int _numMS2Scans;
     MsMsType _msMsType;
 
+    // indices of MS2 scans sorted by precursor m/z and collision energy
+    vector<unsigned int> _ms2ScansByPrecursor;
+    bool _ms2ScansIndexed;
+
+    /**
+    * @brief Indices of the MS2 scans that may pass the precursor and
+    * collision energy filters of a transition, in scan order.
+    */
+    vector<unsigned int> _ms2ScanCandidates(float precursorMz,
+                                            float collisionEnergy,
+                                            string filterline,
+                                            float amuQ1);
+
+    /**
+    * @brief Intensities of the scans at one MS level, in scan order.
+    */
+    struct IntensitySummary {
+        vector<unsigned int> scanIndices;
+        vector<float> totalIntensities;
+        vector<float> basePeakMzs;
+        vector<float> basePeakIntensities;
+        QuantileSketch intensities;
+    };
+    map<int, IntensitySummary> _intensitySummaries;
+    size_t _summarizedScans;
+
+    /**
+    * @brief Summary of the given MS level, summarizing the scans first if
+    * they have changed in number. Null if there are no scans at that level.
+    */
+    const IntensitySummary* _intensitySummary(int mslevel);
+
     void sampleNaming(const char *filename);
     void checkSampleBlank(const char *filename);
 
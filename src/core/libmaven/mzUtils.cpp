@@ -1,3 +1,4 @@
+#include <cstdint>
 #include <thread>
 
 #ifdef UNIX
@@ -293,6 +294,80 @@ namespace mzUtils {
         return x;
     }
 
+    int string2integer(const char* begin, const char* end)
+    {
+        // plain numbers too short to overflow are converted directly
+        const char* c = begin;
+        bool negative = (c != end && *c == '-');
+        if (negative)
+            ++c;
+        int digits = 0;
+        int x = 0;
+        for (; c != end && *c >= '0' && *c <= '9' && digits < 9; ++c) {
+            x = x * 10 + (*c - '0');
+            ++digits;
+        }
+        if (digits > 0 && c == end)
+            return negative ? -x : x;
+        return string2integer(string(begin, end));
+    }
+
+    float string2float(const char* begin, const char* end)
+    {
+        static const double powersOfTen[] = {1e0,  1e1,  1e2,  1e3,  1e4,
+                                             1e5,  1e6,  1e7,  1e8,  1e9,
+                                             1e10, 1e11, 1e12, 1e13, 1e14,
+                                             1e15, 1e16, 1e17, 1e18, 1e19,
+                                             1e20, 1e21, 1e22};
+        const char* c = begin;
+        bool negative = (c != end && *c == '-');
+        if (negative)
+            ++c;
+
+        uint64_t mantissa = 0;
+        int digits = 0;
+        int fractionDigits = -1;
+        for (; c != end && digits < 19; ++c) {
+            if (*c >= '0' && *c <= '9') {
+                mantissa = mantissa * 10 + static_cast<uint64_t>(*c - '0');
+                ++digits;
+                if (fractionDigits >= 0)
+                    ++fractionDigits;
+            } else if (*c == '.' && fractionDigits < 0) {
+                fractionDigits = 0;
+            } else {
+                break;
+            }
+        }
+
+        bool terminated = (c == end || *c == '\r' || *c == '\t' || *c == ' ');
+        if (digits > 0
+            && terminated
+            && mantissa <= (uint64_t(1) << 53)
+            && fractionDigits <= 22) {
+            double value = static_cast<double>(mantissa)
+                           / powersOfTen[max(fractionDigits, 0)];
+            if (value == 0.0)
+                return negative ? -0.0f : 0.0f;
+
+            // the 29 low bits of a double's mantissa are dropped when
+            // rounding it to float, with 0x10000000 being the halfway point
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            uint64_t dropped = bits & ((uint64_t(1) << 29) - 1);
+            uint64_t halfway = uint64_t(1) << 28;
+            uint64_t distance = dropped > halfway ? dropped - halfway
+                                                  : halfway - dropped;
+            if (distance > 2
+                && value >= numeric_limits<float>::min()
+                && value <= numeric_limits<float>::max()) {
+                float result = static_cast<float>(value);
+                return negative ? -result : result;
+            }
+        }
+        return string2float(string(begin, end));
+    }
+
     string integer2string(int x)
     {
         std::stringstream i;
@@ -403,6 +403,20 @@ namespace mzUtils
      */
     float string2float(const std::string& s);
 
+    /**
+     * @brief Converts the text within [begin, end) to an integer, exactly as
+     * `string2integer` would, without copying plain numbers to a string.
+     */
+    int string2integer(const char* begin, const char* end);
+
+    /**
+     * @brief Converts the text within [begin, end) to a floating point
+     * number, exactly as `string2float` would. Plain decimals are converted
+     * without copying them to a string, unless they lie too close to halfway
+     * between two floats for their rounding to be certain.
+     */
+    float string2float(const char* begin, const char* end);
+
     /**
      * @brief integer2string Converts interger to string.
      * @param x Integer to be converted.
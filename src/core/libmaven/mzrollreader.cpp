@@ -0,0 +1,470 @@
+#include <omp.h>
+
+#include <QFile>
+#include <QStack>
+
+#include "Compound.h"
+#include "database.h"
+#include "mavenparameters.h"
+#include "mzrollreader.h"
+#include "mzSample.h"
+#include "PeakGroup.h"
+
+MzrollReader::MzrollReader(vector<mzSample*> samples,
+                           MavenParameters* parameters,
+                           Database& db)
+    : _parameters(parameters), _db(db), _mzrollv_0_1_5(false)
+{
+    _samples.samples = samples;
+    for (auto sample : _samples.samples) {
+        QString name = QString::fromStdString(sample->sampleName);
+        cleanString(name);
+        _samples.attributeNames.push_back(name);
+
+        // peaks refer to the first sample of their name
+        _samples.byName.insert(make_pair(sample->sampleName, sample));
+    }
+}
+
+/**
+ * @brief Byte ranges of interest in an mzroll document, found by scanning its
+ * markup without parsing attributes or decoding any text.
+ */
+struct _MzrollOutline {
+    // start tag of the project element
+    const char* projectTag = nullptr;
+    const char* projectTagEnd = nullptr;
+
+    // outermost PeakGroup elements, in document order
+    vector<pair<const char*, const char*>> groups;
+
+    bool hasSamplesUsed = false;
+};
+
+const char* _skipPast(const char* from, const char* end, const char* terminator)
+{
+    size_t length = strlen(terminator);
+    const char* found = search(from, end, terminator, terminator + length);
+    return found == end ? end : found + length;
+}
+
+bool _markupStartsWith(const char* markup, const char* end, const char* prefix)
+{
+    size_t length = strlen(prefix);
+    return static_cast<size_t>(end - markup) >= length
+           && memcmp(markup, prefix, length) == 0;
+}
+
+_MzrollOutline _outlineMzroll(const char* data, const char* end)
+{
+    _MzrollOutline outline;
+    const char* groupStart = nullptr;
+    int groupDepth = 0;
+    const char* cursor = data;
+    while (cursor < end) {
+        const char* tag = static_cast<const char*>(memchr(cursor,
+                                                          '<',
+                                                          end - cursor));
+        if (tag == nullptr)
+            break;
+
+        // '<' cannot occur unescaped anywhere else, except within these
+        if (_markupStartsWith(tag, end, "<!--")) {
+            cursor = _skipPast(tag + 4, end, "-->");
+            continue;
+        }
+        if (_markupStartsWith(tag, end, "<![CDATA[")) {
+            cursor = _skipPast(tag + 9, end, "]]>");
+            continue;
+        }
+        if (_markupStartsWith(tag, end, "<?")) {
+            cursor = _skipPast(tag + 2, end, "?>");
+            continue;
+        }
+        if (_markupStartsWith(tag, end, "<!")) {
+            cursor = _skipPast(tag + 2, end, ">");
+            continue;
+        }
+
+        bool isEndTag = tag + 1 < end && tag[1] == '/';
+        const char* name = tag + (isEndTag ? 2 : 1);
+        const char* nameEnd = name;
+        while (nameEnd < end
+               && *nameEnd != '>'
+               && *nameEnd != '/'
+               && !isspace(static_cast<unsigned char>(*nameEnd))) {
+            ++nameEnd;
+        }
+
+        // attribute values may contain '>', but never their own quote
+        const char* close = nameEnd;
+        char quote = 0;
+        for (; close < end; ++close) {
+            if (quote != 0) {
+                if (*close == quote)
+                    quote = 0;
+            } else if (*close == '"' || *close == '\'') {
+                quote = *close;
+            } else if (*close == '>') {
+                break;
+            }
+        }
+        const char* tagEnd = close < end ? close + 1 : end;
+        bool isEmptyElement = !isEndTag && close < end && close[-1] == '/';
+
+        auto isNamed = [&](const char* elementName) {
+            size_t length = strlen(elementName);
+            return static_cast<size_t>(nameEnd - name) == length
+                   && memcmp(name, elementName, length) == 0;
+        };
+        if (isNamed("PeakGroup")) {
+            if (isEndTag) {
+                if (groupDepth > 0 && --groupDepth == 0)
+                    outline.groups.push_back(make_pair(groupStart, tagEnd));
+            } else if (groupDepth == 0 && isEmptyElement) {
+                outline.groups.push_back(make_pair(tag, tagEnd));
+            } else if (!isEmptyElement) {
+                if (groupDepth++ == 0)
+                    groupStart = tag;
+            }
+        } else if (!isEndTag && isNamed("SamplesUsed")) {
+            outline.hasSamplesUsed = true;
+        } else if (!isEndTag
+                   && isNamed("project")
+                   && outline.projectTag == nullptr) {
+            outline.projectTag = tag;
+            outline.projectTagEnd = tagEnd;
+        }
+        cursor = tagEnd;
+    }
+
+    // let the parser report an element that is left open
+    if (groupDepth > 0)
+        outline.groups.push_back(make_pair(groupStart, end));
+
+    return outline;
+}
+
+/**
+ * @brief Looks up the attributes of an element by their qualified names.
+ * @details Lookups made in the order in which the attributes were written,
+ * as is the case for files saved by El-MAVEN, find each attribute right away
+ * instead of comparing against all the attributes before it.
+ */
+class _AttributeReader
+{
+public:
+    _AttributeReader(const QXmlStreamAttributes& attributes)
+        : _attributes(attributes), _next(0)
+    {
+    }
+
+    QStringRef value(const char* name) { return _find(QLatin1String(name)); }
+    QStringRef value(const QString& name) { return _find(name); }
+
+private:
+    QXmlStreamAttributes _attributes;
+    int _next;
+
+    template<typename Name>
+    QStringRef _find(const Name& name)
+    {
+        int size = _attributes.size();
+        for (int k = 0; k < size; ++k) {
+            int i = (_next + k) % size;
+            const auto& attribute = _attributes.at(i);
+            if (attribute.qualifiedName() == name) {
+                _next = i + 1;
+                return attribute.value();
+            }
+        }
+        return QStringRef();
+    }
+};
+
+void MzrollReader::cleanString(QString& name)
+{
+    name.replace('#', '_');
+    name = 's' + name;
+}
+
+void MzrollReader::_readSamplesXML(QXmlStreamReader& xml,
+                                   PeakGroup* group,
+                                   float mzrollVersion)
+{
+    if (mzrollVersion == 1) {
+        if (xml.name() == "SamplesUsed") {
+            xml.readNextStartElement();
+            while (xml.name() == "sample") {
+                unsigned int id = xml.attributes().value("id").toInt();
+                for (auto sample : _samples.samples) {
+                    if (id == sample->getSampleId()) {
+                        group->samples.push_back(sample);
+                    }
+                }
+                xml.readNextStartElement();
+            }
+        }
+    } else {
+        _AttributeReader attributes(xml.attributes());
+        for (size_t i = 0; i < _samples.samples.size(); ++i) {
+            mzSample* sample = _samples.samples[i];
+            if (xml.name() == "PeakGroup" && _mzrollv_0_1_5
+                && sample->isSelected) {
+                /**
+                 * if mzroll is from old version, just insert sample in group
+                 * from checking whether it is selected or not at time of
+                 * exporting. This can give erroneous result for old version if
+                 * at time of exporting mzroll user has selected diffrent
+                 * samples from samples were used at time of peak finding which
+                 * was inherent problem of old version of ElMaven.
+                 */
+                group->samples.push_back(sample);
+            } else if (xml.name() == "SamplesUsed"
+                       && attributes.value(_samples.attributeNames[i])
+                              == QLatin1String("Used")) {
+                /**
+                 * if mzroll file is of new version, it's sample name will
+                 * precede by 's' and has value of <Used> or <NotUsed>
+                 */
+                group->samples.push_back(sample);
+            }
+        }
+    }
+}
+
+PeakGroup* MzrollReader::_readGroupXML(QXmlStreamReader& xml,
+                                       PeakGroup* parent)
+{
+    PeakGroup* group = new PeakGroup(
+        make_shared<MavenParameters>(*_parameters),
+        PeakGroup::IntegrationType::Programmatic);
+
+    _AttributeReader attributes(xml.attributes());
+    group->setGroupId(attributes.value("groupId").toInt());
+    group->clusterId = attributes.value("clusterId").toInt();
+    group->groupRank = attributes.value("grouRank").toFloat();
+    group->tagIsotope(attributes.value("tagString").toString().toStdString(),
+                      attributes.value("expectedMz").toFloat(),
+                      0.0f);
+    group->label = attributes.value("label").toInt();
+    group->setType(static_cast<PeakGroup::GroupType>(
+        attributes.value("type").toInt()));
+    group->changeFoldRatio = attributes.value("changeFoldRatio").toFloat();
+    group->changePValue = attributes.value("changePValue").toFloat();
+
+    string compoundId =
+        attributes.value("compoundId").toString().toStdString();
+    string compoundDB =
+        attributes.value("compoundDB").toString().toStdString();
+    string compoundName =
+        attributes.value("compoundName").toString().toStdString();
+
+    string srmId = attributes.value("srmId").toString().toStdString();
+    if (!srmId.empty())
+        group->setSrmId(srmId);
+
+    if (!compoundName.empty() && !compoundDB.empty()) {
+        vector<Compound*> matches =
+            _db.findSpeciesByName(compoundName, compoundDB);
+        if (matches.size() > 0)
+            group->setCompound(matches[0]);
+    } else if (!compoundId.empty()) {
+        Compound* c = nullptr;
+
+        if (group->getCompound() && !group->getCompound()->name().empty()) {
+            c = _db.findSpeciesByIdAndName(compoundId,
+                                          group->getCompound()->name(),
+                                          _db.ANYDATABASE);
+        } else if (!compoundDB.empty()) {
+            vector<Compound*> matches = _db.findSpeciesById(compoundId, compoundDB);
+            if (matches.size())
+                c = matches[0];
+        }
+        
+        if (c)
+            group->setCompound(c);
+    }
+
+    if (!group->getCompound()) {
+        if (!compoundId.empty())
+            group->tagString = compoundId;
+        else if (!compoundName.empty())
+            group->tagString = compoundName;
+    }
+
+    if (parent) {
+        parent->addIsotopeChild(*group);
+        if (parent->childIsotopeCount() > 0)
+            group = parent->childIsotopes()[parent->childIsotopeCount() - 1].get();
+    }
+
+    return group;
+}
+
+void MzrollReader::_readPeakXML(QXmlStreamReader& xml, PeakGroup* parent)
+{
+    _AttributeReader attributes(xml.attributes());
+    Peak p;
+    p.pos = attributes.value("pos").toInt();
+    p.minpos = attributes.value("minpos").toInt();
+    p.maxpos = attributes.value("maxpos").toInt();
+    p.splineminpos = attributes.value("splineminpos").toInt();
+    p.splinemaxpos = attributes.value("splinemaxpos").toInt();
+    p.rt = attributes.value("rt").toDouble();
+    p.rtmin = attributes.value("rtmin").toDouble();
+    p.rtmax = attributes.value("rtmax").toDouble();
+    p.mzmin = attributes.value("mzmin").toDouble();
+    p.mzmax = attributes.value("mzmax").toDouble();
+    p.scan = attributes.value("scan").toInt();
+    p.minscan = attributes.value("minscan").toInt();
+    p.maxscan = attributes.value("maxscan").toInt();
+    p.peakArea = attributes.value("peakArea").toDouble();
+    p.peakSplineArea = attributes.value("peakSplineArea").toDouble();
+    p.peakAreaCorrected = attributes.value("peakAreaCorrected").toDouble();
+    p.peakAreaTop = attributes.value("peakAreaTop").toDouble();
+    p.peakAreaTopCorrected = attributes.value("peakAreaTopCorrected").toDouble();
+    p.peakAreaFractional = attributes.value("peakAreaFractional").toDouble();
+    p.peakRank = attributes.value("peakRank").toDouble();
+    p.peakIntensity = attributes.value("peakIntensity").toDouble();
+    p.peakBaseLineLevel = attributes.value("peakBaseLineLevel").toDouble();
+    p.peakMz = attributes.value("peakMz").toDouble();
+    p.medianMz = attributes.value("medianMz").toDouble();
+    p.baseMz = attributes.value("baseMz").toDouble();
+    p.quality = attributes.value("quality").toDouble();
+    p.width = attributes.value("width").toInt();
+    p.gaussFitSigma = attributes.value("gaussFitSigma").toDouble();
+    p.gaussFitR2 = attributes.value("gaussFitR2").toDouble();
+    p.groupNum = attributes.value("groupNum").toInt();
+    p.noNoiseObs = attributes.value("noNoiseObs").toInt();
+    p.noNoiseFraction = attributes.value("noNoiseFraction").toDouble();
+    p.symmetry = attributes.value("symmetry").toDouble();
+    p.signalBaselineRatio = attributes.value("signalBaselineRatio").toDouble();
+    p.groupOverlap = attributes.value("groupOverlap").toDouble();
+    p.groupOverlapFrac = attributes.value("groupOverlapFrac").toDouble();
+    p.localMaxFlag = attributes.value("localMaxFlag").toInt();
+    p.fromBlankSample = attributes.value("fromBlankSample").toInt();
+    p.label = attributes.value("label").toInt();
+
+    string sampleName = attributes.value("sample").toString().toStdString();
+    auto sample = _samples.byName.find(sampleName);
+    if (sample != end(_samples.byName))
+        p.setSample(sample->second);
+
+    parent->addPeak(p);
+}
+
+vector<PeakGroup*>
+MzrollReader::_readGroupFragmentXML(const QByteArray& fragment,
+                                    float mzrollVersion)
+{
+    QXmlStreamReader xml(fragment);
+    vector<PeakGroup*> groups;
+    PeakGroup* group = nullptr;
+    PeakGroup* parent = nullptr;
+    QStack<PeakGroup*> stack;
+
+    while (!xml.atEnd()) {
+        xml.readNext();
+        if (xml.hasError()) {
+            cerr << "Error in xml reading: "
+                 << xml.errorString().toStdString()
+                 << endl;
+        }
+        if (xml.isStartElement()) {
+            if (xml.name() == "PeakGroup") {
+                group = _readGroupXML(xml, parent);
+                if (!group->isIsotope())
+                    groups.push_back(group);
+            }
+            if (xml.name() == "SamplesUsed" && group) {
+                _readSamplesXML(xml, group, mzrollVersion);
+            }
+            if (xml.name() == "Peak" && group) {
+                _readPeakXML(xml, group);
+            }
+            if (xml.name() == "children" && group) {
+                stack.push(group);
+                parent = stack.top();
+            }
+        }
+
+        if (xml.isEndElement()) {
+           if (xml.name() == "children") {
+                if (stack.size() > 0)
+                    parent = stack.pop();
+                if (parent && parent->childIsotopeCount()) {
+                    for (int i = 0; i < parent->childIsotopes().size(); i++) {
+                        parent->childIsotopes()[i]->minQuality =
+                            _parameters->minQuality;
+                        parent->childIsotopes()[i]->groupStatistics();
+                    }
+                }
+                if (stack.size() == 0)
+                    parent = nullptr;
+            }
+            if (xml.name() == "PeakGroup") {
+                if (group) {
+                    group->minQuality = _parameters->minQuality;
+                    group->groupStatistics();
+                }
+                group = nullptr;
+            }
+        }
+    }
+    for (auto group : groups) {
+        if (!group)
+            continue;
+        group->minQuality = _parameters->minQuality;
+        group->groupStatistics();
+    }
+    return groups;
+}
+
+vector<PeakGroup*> MzrollReader::readGroups(QString fileName)
+{
+    QFile data(fileName);
+    vector<PeakGroup*> groups;
+    if ( !data.open(QFile::ReadOnly) ) {
+        cerr << "File open: " << fileName.toStdString() << " failed" << endl;
+        return groups;
+    }
+
+    qint64 fileSize = data.size();
+    const char* contents = reinterpret_cast<const char*>(data.map(0,
+                                                                  fileSize));
+    QByteArray buffer;
+    if (contents == nullptr) {
+        buffer = data.readAll();
+        contents = buffer.constData();
+        fileSize = buffer.size();
+    }
+
+    auto outline = _outlineMzroll(contents, contents + fileSize);
+    _mzrollv_0_1_5 = !outline.hasSamplesUsed;
+
+    float mzrollVersion = 0;
+    if (outline.projectTag != nullptr) {
+        auto tag = QByteArray::fromRawData(outline.projectTag,
+                                           outline.projectTagEnd
+                                               - outline.projectTag);
+        QXmlStreamReader xml(tag);
+        if (xml.readNextStartElement())
+            mzrollVersion = xml.attributes().value("mzrollVersion").toFloat();
+    }
+
+    // every top-level group is read along with its isotopes and peaks, which
+    // never refer to other top-level groups
+    int numFragments = outline.groups.size();
+    vector<vector<PeakGroup*>> fragmentGroups(numFragments);
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < numFragments; ++i) {
+        const auto& range = outline.groups[i];
+        auto fragment = QByteArray::fromRawData(range.first,
+                                                range.second - range.first);
+        fragmentGroups[i] = _readGroupFragmentXML(fragment, mzrollVersion);
+    }
+    for (const auto& fragment : fragmentGroups)
+        groups.insert(end(groups), begin(fragment), end(fragment));
+    return groups;
+}
@@ -0,0 +1,112 @@
+#ifndef MZROLLREADER_H
+#define MZROLLREADER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QXmlStreamReader>
+
+#include "standardincludes.h"
+
+class Database;
+class MavenParameters;
+class mzSample;
+class PeakGroup;
+
+using namespace std;
+
+/**
+ * @brief The MzrollReader class reads the peak groups stored in an mzroll
+ * file, along with their isotope children, peaks, samples and compounds.
+ */
+class MzrollReader
+{
+public:
+    /**
+     * @brief Constructor of class MzrollReader.
+     * @param samples Samples that groups and peaks of a file may refer to.
+     * @param parameters Parameters copied into each group read.
+     * @param db Database in which compounds of the groups are looked up.
+     */
+    MzrollReader(vector<mzSample*> samples,
+                 MavenParameters* parameters,
+                 Database& db);
+
+    /**
+     * @brief Read the peak groups stored in an mzroll file.
+     * @details The file is first scanned for the byte ranges of its
+     * outermost PeakGroup elements, without parsing any attributes. These
+     * elements, along with the isotope groups and peaks nested within them,
+     * are then parsed in parallel and the groups are returned in the order in
+     * which they appear in the file. Groups are expected to be encoded in
+     * UTF-8, the encoding El-MAVEN has always saved them in. The file is
+     * marked as v0.1.5 or older (see `isV015`) when none of its groups lists
+     * the samples it used.
+     * @param fileName Path of the mzroll file.
+     * @return Top-level groups read from the file.
+     */
+    vector<PeakGroup*> readGroups(QString fileName);
+
+    /**
+     * @brief Whether the file last read was saved by El-MAVEN v0.1.5 or
+     * older, in which case groups were assigned the samples selected at the
+     * time of saving.
+     */
+    bool isV015() const { return _mzrollv_0_1_5; }
+
+    /**
+     * @brief Modify name appropriate for xml attribute naming
+     * @details This method makes sample name appropriate for using in
+     * attribute naming in mzroll file It is just replacing '#' with '_' and
+     * adding 's' for letting sample name start with english letter In
+     * future, if sample name has some other special character, we have to
+     * replace those also with appropriate character Error can be seen at
+     * compilation time
+     */
+    static void cleanString(QString& name);
+
+private:
+    friend class TestMzrollReader;
+
+    /**
+     * @brief Samples of the session, arranged for resolving the sample
+     * references made by groups and peaks of an mzroll file. These are
+     * gathered once per file instead of once per element.
+     */
+    struct MzrollSamples {
+        vector<mzSample*> samples;
+        vector<QString> attributeNames;
+        map<string, mzSample*> byName;
+    };
+
+    MzrollSamples _samples;
+    MavenParameters* _parameters;
+    Database& _db;
+    bool _mzrollv_0_1_5;
+
+    /**
+     * @brief Read groups and peaks from a fragment of an mzroll file,
+     * usually a single top-level PeakGroup element. This may be called for
+     * different fragments of the same file in parallel.
+     * @param fragment Text of the fragment.
+     * @param mzrollVersion Version stored in the file's project element.
+     * @return Groups read from the fragment, in order of appearance.
+     */
+    vector<PeakGroup*> _readGroupFragmentXML(const QByteArray& fragment,
+                                             float mzrollVersion);
+
+    /**
+     * @brief It will add samples used to group being generated while
+     * creating from mzroll file
+     * @details This method will add all sample to group being
+     * created from mzroll file. It will read SamplesUsed attribute of a
+     * group and if it's value is "Used", then assign this mzSample to that
+     * group
+     */
+    void _readSamplesXML(QXmlStreamReader& xml,
+                         PeakGroup* group,
+                         float mzrollVersion);
+    PeakGroup* _readGroupXML(QXmlStreamReader& xml, PeakGroup* parent);
+    void _readPeakXML(QXmlStreamReader& xml, PeakGroup* parent);
+};
+
+#endif  // MZROLLREADER_H
@@ -20,6 +20,7 @@
 #include "peakFiltering.h"
 #include "groupFiltering.h"
 #include "mavenparameters.h"
+#include "masscutofftype.h"
 #include "mzMassCalculator.h"
 #include "Scan.h"
 
@@ -272,63 +273,105 @@ void PeakDetector::identifyFeatures(const vector<Compound*>& identificationSet)
         massSlicer.generateCompoundSlices(identificationSet);
     }
 
+    // index target slices by m/z, so that each group only visits the slices
+    // that could lie within the merge mass cutoff of its mean m/z
+    vector<pair<float, size_t>> sliceMzIndex;
+    sliceMzIndex.reserve(massSlicer.slices.size());
+    for (size_t i = 0; i < massSlicer.slices.size(); ++i)
+        sliceMzIndex.push_back(make_pair(massSlicer.slices[i]->mz, i));
+    sort(begin(sliceMzIndex), end(sliceMzIndex));
+
     GroupFiltering groupFilter(_mavenParameters);
+    MassCutoff* massCutoff = _mavenParameters->massCutoffMerge;
+    auto& allgroups = _mavenParameters->allgroups;
     vector<PeakGroup> toBeMerged;
-    auto iter = _mavenParameters->allgroups.begin();
-    while(iter != _mavenParameters->allgroups.end()) {
-        auto& group = *iter;
-        bool matchFound = false;
-        for (auto slice : massSlicer.slices) {
-            if (mzUtils::withinXMassCutoff(slice->mz,
-                                           group.meanMz,
-                                           _mavenParameters->massCutoffMerge)) {
-                PeakGroup groupWithTarget(group);
-                groupWithTarget.setCompound(slice->compound);
-                groupWithTarget.setAdduct(slice->adduct);
-                groupWithTarget.setIsotope(slice->isotope);
-
-                // we should filter the annotated group based on its RT, if the
-                // user has restricted RT range
-                auto rtDiff = groupWithTarget.expectedRtDiff();
-                if (_mavenParameters->identificationMatchRt
-                    && rtDiff > _mavenParameters->identificationRtWindow) {
-                    continue;
-                }
-
-                // since we are creating groups with targets, we should ensure
-                // that the parent ion forms of these groups should at least
-                // pass MS2 filtering criteria, if enabled
-                if (_mavenParameters->matchFragmentationFlag
-                    && groupWithTarget.adduct()->isParent()
-                    && groupWithTarget.isotope().isParent()
-                    && groupWithTarget.ms2EventCount > 0
-                    && groupFilter.filterByMS2(groupWithTarget)) {
-                    continue;
-                }
+    vector<PeakGroup> unmatched;
+    unmatched.reserve(allgroups.size());
+    vector<size_t> candidates;
+    for (size_t groupIndex = 0; groupIndex < allgroups.size(); ++groupIndex) {
+        auto& group = allgroups[groupIndex];
+
+        // a ppm cutoff is relative to the slice m/z, which can at most be
+        // about twice the cutoff away from the group m/z; the exact check is
+        // still done for each candidate
+        float window = 2.0f * massCutoff->massCutoffValue(group.meanMz);
+        auto first = lower_bound(begin(sliceMzIndex),
+                                 end(sliceMzIndex),
+                                 make_pair(group.meanMz - window, size_t(0)));
+        candidates.clear();
+        for (auto iter = first;
+             iter != end(sliceMzIndex) && iter->first <= group.meanMz + window;
+             ++iter) {
+            auto slice = massSlicer.slices[iter->second];
+            if (!mzUtils::withinXMassCutoff(slice->mz,
+                                            group.meanMz,
+                                            massCutoff)) {
+                continue;
+            }
 
-                matchFound = true;
-                toBeMerged.push_back(groupWithTarget);
+            // we should filter the annotated group based on its RT, if the
+            // user has restricted RT range
+            auto compound = slice->compound;
+            float rtDiff = -1.0f;
+            if (compound != nullptr && compound->expectedRt() > 0)
+                rtDiff = abs(compound->expectedRt() - group.meanRt);
+            if (_mavenParameters->identificationMatchRt
+                && rtDiff > _mavenParameters->identificationRtWindow) {
+                continue;
             }
+
+            candidates.push_back(iter->second);
         }
 
-        if (matchFound) {
-            iter = _mavenParameters->allgroups.erase(iter);
-        } else {
-            ++iter;
+        // annotations are appended in the order slices were generated
+        sort(begin(candidates), end(candidates));
+
+        bool matchFound = false;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            auto slice = massSlicer.slices[candidates[i]];
+
+            // since we are creating groups with targets, we should ensure
+            // that the parent ion forms of these groups should at least
+            // pass MS2 filtering criteria, if enabled
+            bool needsMS2Check = _mavenParameters->matchFragmentationFlag
+                                 && slice->adduct->isParent()
+                                 && slice->isotope.isParent()
+                                 && group.ms2EventCount > 0;
+
+            // the last annotation that cannot be rejected can take over the
+            // original group, instead of copying it
+            bool lastCandidate = (i == candidates.size() - 1);
+            PeakGroup groupWithTarget =
+                (lastCandidate && !needsMS2Check) ? std::move(group) : group;
+            groupWithTarget.setCompound(slice->compound);
+            groupWithTarget.setAdduct(slice->adduct);
+            groupWithTarget.setIsotope(slice->isotope);
+
+            if (needsMS2Check && groupFilter.filterByMS2(groupWithTarget))
+                continue;
+
+            matchFound = true;
+            toBeMerged.push_back(std::move(groupWithTarget));
         }
 
+        // compact the unmatched groups, instead of erasing matched ones
+        if (!matchFound)
+            unmatched.push_back(std::move(group));
+
        sendBoostSignal("Identifying features using the given compound set…",
-                       iter - _mavenParameters->allgroups.begin(),
-                       _mavenParameters->allgroups.size());
+                       groupIndex + 1,
+                       allgroups.size());
     }
     delete_all(massSlicer.slices);
 
-    if (!toBeMerged.empty()) {
-        _mavenParameters->allgroups.insert(
-            _mavenParameters->allgroups.begin(),
-            make_move_iterator(toBeMerged.begin()),
-            make_move_iterator(toBeMerged.end()));
-    }
+    allgroups.clear();
+    allgroups.reserve(toBeMerged.size() + unmatched.size());
+    allgroups.insert(allgroups.end(),
+                     make_move_iterator(toBeMerged.begin()),
+                     make_move_iterator(toBeMerged.end()));
+    allgroups.insert(allgroups.end(),
+                     make_move_iterator(unmatched.begin()),
+                     make_move_iterator(unmatched.end()));
 
     performMetaGrouping();
 
@@ -697,395 +740,457 @@ void PeakDetector::processSlices(vector<mzSlice*>& slices,
     }
 }
 
-// filter for top N ranked parent peak-groups per compound
-void _keepNBestRanked(unordered_map<Compound*, vector<size_t>>& compoundGroups,
-                      vector<PeakGroup>& container,
-                      int nBest)
+// group indexes of a single compound, bucketed by their role; each list is
+// kept in container order
+struct _CompoundBucket
+{
+    vector<size_t> parents;
+    vector<size_t> isotopes;
+    vector<size_t> adducts;
+};
+
+// filter for top N ranked parent peak-groups per compound, marking the rest
+// as removed; the kept parents stay in container order
+void _keepNBestRanked(vector<_CompoundBucket>& buckets,
+                      const vector<PeakGroup>& container,
+                      int nBest,
+                      vector<bool>& removed)
 {
-    vector<size_t> indexesToDelete;
-    for (auto& elem : compoundGroups) {
-        vector<size_t>& groupIndexes = elem.second;
+    for (auto& bucket : buckets) {
+        vector<size_t>& groupIndexes = bucket.parents;
         if (groupIndexes.size() <= nBest)
             continue;
 
-        sort(begin(groupIndexes), end(groupIndexes), [&](size_t a, size_t b) {
-            PeakGroup& group = container[a];
-            PeakGroup& otherGroup = container[b];
-            return group.groupRank < otherGroup.groupRank;
-        });
+        stable_sort(begin(groupIndexes),
+                    end(groupIndexes),
+                    [&](size_t a, size_t b) {
+                        return container[a].groupRank
+                               < container[b].groupRank;
+                    });
         for (size_t i = nBest; i < groupIndexes.size(); ++i)
-            indexesToDelete.push_back(groupIndexes[i]);
+            removed[groupIndexes[i]] = true;
         groupIndexes.erase(begin(groupIndexes) + nBest, end(groupIndexes));
+        sort(begin(groupIndexes), end(groupIndexes));
     }
-
-    // we can delete peak-groups only after filtering, to prevent erase-attempt
-    // on invalid indexes
-    mzUtils::eraseIndexes(container, indexesToDelete);
 }
 
-pair<map<size_t, size_t>, vector<size_t>>
-_matchParentsToChildren(vector<size_t>& parentIndexes,
-                        vector<size_t>& childIndexes,
-                        vector<PeakGroup>& container,
-                        function<string(PeakGroup*)> nameFunc)
+// for a set of subjects, each one is assigned its most preferred object, by
+// RT proximity; in case of a clash, the loser moves on to its next preference
+// (an object it has already lost cannot be won back, since objects only ever
+// change hands to a closer subject); one important assumption is that the
+// number of competing subjects is less than (or equal to) the number of
+// available objects, otherwise some subjects remain unassigned; a group that
+// is both a subject and an object is never matched to itself; returns the
+// position of the object matched to each subject (max `size_t` if none)
+vector<size_t> _matchByRt(const vector<size_t>& subjects,
+                          const vector<size_t>& objects,
+                          const vector<float>& rtKeys)
 {
-    map<string, vector<size_t>> nameGroupedChildren;
-    for (auto index : childIndexes) {
-        PeakGroup& child = container[index];
-        string subType = nameFunc(&child);
-        if (nameGroupedChildren.count(subType) == 0)
-            nameGroupedChildren[subType] = {};
-        nameGroupedChildren[subType].push_back(index);
-    }
-
-    // lambda: checks whether the RT difference between the i-th and the k-th
-    // peak-groups is less than that of the j-th and the k-th peak-groups
-    auto lessRtDel = [&container](size_t i, size_t j, size_t k) {
-        return abs(container[i].meanRt - container[k].meanRt)
-               < abs(container[j].meanRt - container[k].meanRt);
+    const size_t npos = numeric_limits<size_t>::max();
+    auto rtDel = [&](size_t subjectPos, size_t objectPos) {
+        return abs(rtKeys[subjects[subjectPos]] - rtKeys[objects[objectPos]]);
     };
 
-    // lambda: sorts object vector based on RT difference b/w object and subject
-    auto sortObjects = [&lessRtDel](vector<size_t>& objects, size_t subject) {
-        sort(begin(objects),
-             end(objects),
-             [&lessRtDel, subject](size_t o1, size_t o2) {
-                 return lessRtDel(o1, o2, subject);
-             });
-    };
+    // object positions sorted by RT difference, for each subject
+    vector<vector<size_t>> priorityLists(subjects.size());
+    for (size_t s = 0; s < subjects.size(); ++s) {
+        auto& priorityList = priorityLists[s];
+        priorityList.reserve(objects.size());
+        for (size_t o = 0; o < objects.size(); ++o) {
+            if (objects[o] != subjects[s])
+                priorityList.push_back(o);
+        }
+        stable_sort(begin(priorityList),
+                    end(priorityList),
+                    [&](size_t o1, size_t o2) {
+                        return rtDel(s, o1) < rtDel(s, o2);
+                    });
+    }
 
-    // lambda: for a given parent or child group (subject), assign the most
-    // preferred child or parent group (object), respectively; in case of a
-    // clash, the loser must select its next preference (recursively); one
-    // important assumption is that the number of competing subjects is less
-    // than (or equal to) the number of available objects
-    function<void(size_t,
-                  map<size_t, size_t>&,
-                  map<size_t, size_t>&,
-                  map<size_t, vector<size_t>>&)> findPreferredMatch;
-    findPreferredMatch =
-        [&lessRtDel, &findPreferredMatch]
-        (size_t subject,
-         map<size_t, size_t>& subjectsWithObjects,
-         map<size_t, size_t>& objectsWithSubjects,
-         map<size_t, vector<size_t>>& priorityLists) -> void {
-            auto priorityList = priorityLists[subject];
-            for (size_t object : priorityList) {
-                if (objectsWithSubjects.count(object)) {
-                    auto competingSubject = objectsWithSubjects[object];
-                    if (lessRtDel(subject, competingSubject, object)) {
-                        subjectsWithObjects[subject] = object;
-                        objectsWithSubjects[object] = subject;
-
-                        auto iter = subjectsWithObjects.find(competingSubject);
-                        if(iter != end(subjectsWithObjects))
-                            subjectsWithObjects.erase(iter);
-                        findPreferredMatch(competingSubject,
-                                           subjectsWithObjects,
-                                           objectsWithSubjects,
-                                           priorityLists);
-                        break;
-                    }
-                } else {
-                    subjectsWithObjects[subject] = object;
-                    objectsWithSubjects[object] = subject;
+    vector<size_t> nextPreference(subjects.size(), 0);
+    vector<size_t> objectHolders(objects.size(), npos);
+    vector<size_t> matches(subjects.size(), npos);
+    for (size_t first = 0; first < subjects.size(); ++first) {
+        size_t subject = first;
+        while (subject != npos) {
+            size_t displaced = npos;
+            auto& priorityList = priorityLists[subject];
+            while (nextPreference[subject] < priorityList.size()) {
+                size_t object = priorityList[nextPreference[subject]++];
+                size_t competingSubject = objectHolders[object];
+                if (competingSubject == npos) {
+                    objectHolders[object] = subject;
+                    matches[subject] = object;
+                    break;
+                }
+                if (rtDel(subject, object) < rtDel(competingSubject, object)) {
+                    objectHolders[object] = subject;
+                    matches[subject] = object;
+                    matches[competingSubject] = npos;
+                    displaced = competingSubject;
                     break;
                 }
             }
-        };
-
-    vector<size_t> orphans;
-    map<size_t, size_t> nonOrphans;
-    for (auto& elem : nameGroupedChildren) {
-        auto& childIndexes = elem.second;
-
-        map<size_t, size_t> childrenWithParents;
-        map<size_t, size_t> parentsWithChildren;
-        map<size_t, vector<size_t>> priorityLists;
-        if (childIndexes.size() <= parentIndexes.size()) {
-            for (size_t childIndex : childIndexes) {
-                vector<size_t> copyOfParentIndexes = parentIndexes;
-                sortObjects(copyOfParentIndexes, childIndex);
-                priorityLists[childIndex] = copyOfParentIndexes;
-            }
-
-            for (size_t childIndex : childIndexes) {
-                findPreferredMatch(childIndex,
-                                   childrenWithParents,
-                                   parentsWithChildren,
-                                   priorityLists);
-            }
-        } else {
-            for (size_t parentIndex : parentIndexes) {
-                vector<size_t> copyOfChildIndexes = childIndexes;
-                sortObjects(copyOfChildIndexes, parentIndex);
-                priorityLists[parentIndex] = copyOfChildIndexes;
-            }
-
-            for (size_t parentIndex : parentIndexes) {
-                findPreferredMatch(parentIndex,
-                                   parentsWithChildren,
-                                   childrenWithParents,
-                                   priorityLists);
-            }
-
-            // keep track of children that could not find parents
-            for (auto childIndex : childIndexes) {
-                if (childrenWithParents.count(childIndex) == 0)
-                    orphans.push_back(childIndex);
-            }
+            subject = displaced;
         }
-        nonOrphans.insert(begin(childrenWithParents), end(childrenWithParents));
     }
-    return make_pair(nonOrphans, orphans);
+    return matches;
 }
 
-// given a compound and its child indexes, clubs them with their most likely
-// parent-group if possible, otherwise adds them to a ghost parent
-unordered_map<size_t, vector<size_t>>
-_makeMeta(Compound* compound,
-          vector<size_t>& childIndexes,
-          unordered_map<Compound*, vector<size_t>>& parentCompounds,
-          function<string(PeakGroup*)> nameFunc,
-          MavenParameters* mp)
+// for the children of a compound, assign their most likely parent-group to
+// each one, in `parentOf`; children sharing a name (isotope label or adduct)
+// compete for the same parents; returns the children that could not be
+// matched to any parent
+vector<size_t> _matchParentsToChildren(const vector<size_t>& parentIndexes,
+                                       const vector<size_t>& childIndexes,
+                                       const vector<float>& rtKeys,
+                                       const vector<string>& childNames,
+                                       vector<size_t>& parentOf)
 {
-    auto& container = mp->allgroups;
-    vector<size_t> orphans;
-    map<size_t, size_t> nonOrphans;
-    if (parentCompounds.count(compound) > 0) {
-        auto& parentIndexes = parentCompounds[compound];
-        auto result = _matchParentsToChildren(parentIndexes,
-                                              childIndexes,
-                                              container,
-                                              nameFunc);
-        nonOrphans = result.first;
-        orphans = result.second;
-    } else {
-        for (auto index : childIndexes)
-            orphans.push_back(index);
-    }
-
-    unordered_map<size_t, vector<size_t>> metaGroups;
-    for (auto& elem : nonOrphans) {
-        size_t parentIndex = elem.second;
-        size_t childIndex = elem.first;
-        if (metaGroups.count(parentIndex) == 0)
-            metaGroups[parentIndex] = {};
-        metaGroups[parentIndex].push_back(childIndex);
+    const size_t npos = numeric_limits<size_t>::max();
+
+    // bucket children by name, buckets in order of first appearance
+    unordered_map<string, size_t> nameBucketIndexes;
+    vector<vector<size_t>> nameBuckets;
+    for (size_t i = 0; i < childIndexes.size(); ++i) {
+        auto inserted = nameBucketIndexes.insert(
+            make_pair(childNames[i], nameBuckets.size()));
+        if (inserted.second)
+            nameBuckets.push_back({});
+        nameBuckets[inserted.first->second].push_back(childIndexes[i]);
     }
 
-    if (!orphans.empty()) {
-        // for orphans, create a ghost, that will act as an empty parent
-        PeakGroup parentGroup(make_shared<MavenParameters>(*mp),
-                              PeakGroup::IntegrationType::Ghost);
-        container.push_back(parentGroup);
-
-        // set an appropriate slice for ghost parent
-        mzSlice slice;
-        slice.compound = compound;
-        slice.calculateMzMinMax(mp->compoundMassCutoffWindow,
-                                mp->getCharge());
-        slice.calculateRTMinMax(false, 0.0f);
-        container.back().setSlice(slice);
-        container.back().setSelectedSamples(mp->samples);
+    vector<size_t> orphans;
+    for (auto& children : nameBuckets) {
+        if (children.size() <= parentIndexes.size()) {
+            auto matches = _matchByRt(children, parentIndexes, rtKeys);
+            for (size_t i = 0; i < children.size(); ++i) {
+                if (matches[i] != npos)
+                    parentOf[children[i]] = parentIndexes[matches[i]];
+            }
+        } else {
+            auto matches = _matchByRt(parentIndexes, children, rtKeys);
+            for (size_t i = 0; i < parentIndexes.size(); ++i) {
+                if (matches[i] != npos)
+                    parentOf[children[matches[i]]] = parentIndexes[i];
+            }
+        }
 
-        size_t totalSize = container.size();
-        container.back().setGroupId(totalSize);
-        metaGroups[totalSize - 1] = {};
-        for (auto child : orphans)
-            metaGroups[totalSize - 1].push_back(child);
+        // keep track of children that could not find parents
+        for (auto childIndex : children) {
+            if (parentOf[childIndex] == npos)
+                orphans.push_back(childIndex);
+        }
     }
-
-    return metaGroups;
+    sort(begin(orphans), end(orphans));
+    return orphans;
 }
 
 void PeakDetector::performMetaGrouping(bool applyGroupFilters,
                                        bool barplotIsotopes)
 {
-    if (_mavenParameters->allgroups.empty())
+    auto& allgroups = _mavenParameters->allgroups;
+    if (allgroups.empty())
         return;
 
     sendBoostSignal("Performing meta-grouping…", 0, 0);
 
-    // lambda: club parent-group indexes based on their compounds
-    auto compoundParentGroups = [this] {
-        unordered_map<Compound*, vector<size_t>> parentCompounds;
-        for (size_t i = 0; i < _mavenParameters->allgroups.size(); ++i) {
-            if (_mavenParameters->stop)
-                return parentCompounds;
-
-            PeakGroup& group = _mavenParameters->allgroups[i];
-            Compound* compound = group.getCompound();
-            if (compound == nullptr)
-                continue;
-
-            bool notAdduct = group.adduct() == nullptr;
-            bool parentAdductAndNotIsotope = (group.adduct() != nullptr
-                                              && group.adduct()->isParent()
-                                              && group.isotope().isNone());
-            bool parentAdductAndParentIsotope = (group.adduct() != nullptr
-                                                 && group.adduct()->isParent()
-                                                 && group.isotope().isParent());
-            if (notAdduct
-                || parentAdductAndNotIsotope
-                || parentAdductAndParentIsotope) {
-                if (parentCompounds.count(compound) == 0)
-                    parentCompounds[compound] = {};
-                parentCompounds[compound].push_back(i);
-            }
-        }
-        return parentCompounds;
-    };
-
-    unordered_map<Compound*, vector<size_t>> parentCompounds =
-        compoundParentGroups();
-
-    if (applyGroupFilters) {
-        // filter for the N-best groups per compound
-        _keepNBestRanked(parentCompounds,
-                         _mavenParameters->allgroups,
-                         _mavenParameters->eicMaxGroups);
-
+    // single pass: precompute RT keys and bucket group indexes by compound
+    // (in order of first appearance) and by their role as parent, isotopologue
+    // or adduct
+    vector<float> rtKeys(allgroups.size());
+    vector<_CompoundBucket> buckets;
+    unordered_map<Compound*, size_t> bucketIndexes;
+    for (size_t i = 0; i < allgroups.size(); ++i) {
         if (_mavenParameters->stop)
             return;
 
-        // after filtering, the container changed and the original indexes will
-        // have to be updated
-        parentCompounds = compoundParentGroups();
-    }
-
-    // put isotopologues and adducts into separate buckets
-    unordered_map<Compound*, vector<size_t>> nonParentIsotopologues;
-    unordered_map<Compound*, vector<size_t>> nonParentAdducts;
-    for (size_t i = 0; i < _mavenParameters->allgroups.size(); ++i) {
-        if (_mavenParameters->stop)
-            return;
-
-        PeakGroup& group = _mavenParameters->allgroups[i];
+        PeakGroup& group = allgroups[i];
+        rtKeys[i] = group.meanRt;
         Compound* compound = group.getCompound();
         if (compound == nullptr)
             continue;
 
+        auto inserted = bucketIndexes.insert(make_pair(compound,
+                                                       buckets.size()));
+        if (inserted.second)
+            buckets.push_back(_CompoundBucket());
+        auto& bucket = buckets[inserted.first->second];
+
+        Adduct* adduct = group.adduct();
+        bool notAdduct = adduct == nullptr;
+        bool parentAdduct = !notAdduct && adduct->isParent();
+        Isotope isotope = group.isotope();
+        if (notAdduct
+            || (parentAdduct && isotope.isNone())
+            || (parentAdduct && isotope.isParent())) {
+            bucket.parents.push_back(i);
+        }
         if (group.isIsotope()) {
-            if (nonParentIsotopologues.count(compound) == 0)
-                nonParentIsotopologues[compound] = {};
-            nonParentIsotopologues[compound].push_back(i);
+            bucket.isotopes.push_back(i);
         } else if (group.isAdduct()) {
-            if (nonParentAdducts.count(compound) == 0)
-                nonParentAdducts[compound] = {};
-            nonParentAdducts[compound].push_back(i);
+            bucket.adducts.push_back(i);
         }
     }
 
+    // groups are only removed from the container at the very end, so that the
+    // indexes (and relative order) of all groups remain stable until then
+    vector<bool> removed(allgroups.size(), false);
+    if (applyGroupFilters) {
+        // filter for the N-best groups per compound
+        _keepNBestRanked(buckets,
+                         allgroups,
+                         _mavenParameters->eicMaxGroups,
+                         removed);
+    }
+
+    // lambda: compacts the container, keeping order, by dropping groups that
+    // have been marked for removal
+    auto compactGroups = [&allgroups](const vector<bool>& toBeRemoved) {
+        size_t kept = 0;
+        for (size_t i = 0; i < allgroups.size(); ++i) {
+            if (i < toBeRemoved.size() && toBeRemoved[i])
+                continue;
+            if (kept != i)
+                allgroups[kept] = std::move(allgroups[i]);
+            ++kept;
+        }
+        allgroups.erase(begin(allgroups) + kept, end(allgroups));
+    };
+
     // enumerate group IDs for all remaining peak-groups
     int groupId = 1;
-    for (auto& group : _mavenParameters->allgroups)
-        group.setGroupId(groupId++);
+    bool childrenFound = false;
+    for (size_t i = 0; i < allgroups.size(); ++i) {
+        if (!removed[i])
+            allgroups[i].setGroupId(groupId++);
+    }
+    for (auto& bucket : buckets) {
+        auto isRemoved = [&removed](size_t index) { return removed[index]; };
+        bucket.isotopes.erase(remove_if(begin(bucket.isotopes),
+                                        end(bucket.isotopes),
+                                        isRemoved),
+                              end(bucket.isotopes));
+        bucket.adducts.erase(remove_if(begin(bucket.adducts),
+                                       end(bucket.adducts),
+                                       isRemoved),
+                             end(bucket.adducts));
+        if (!bucket.isotopes.empty() || !bucket.adducts.empty())
+            childrenFound = true;
+    }
 
-    if (nonParentIsotopologues.empty() && nonParentAdducts.empty())
+    if (!childrenFound) {
+        compactGroups(removed);
         return;
+    }
 
-    unordered_map<Compound*, unordered_map<size_t, vector<size_t>>> metaGroups;
+    // all ghost parents created in this pass share a frozen copy of parameters
+    auto ghostParameters = make_shared<MavenParameters>(*_mavenParameters);
+
+    // lambda: given a compound and its child indexes, clubs them with their
+    // most likely parent-group if possible, otherwise adds them to a ghost
+    // parent; parents are recorded in `parentOf`
+    const size_t npos = numeric_limits<size_t>::max();
+    vector<size_t> parentOf(allgroups.size(), npos);
+    auto makeMeta = [&](const _CompoundBucket& bucket,
+                        const vector<size_t>& childIndexes,
+                        function<string(PeakGroup&)> nameFunc) {
+        if (childIndexes.empty())
+            return;
 
-    // find isotope meta-groups
-    for (auto& elem : nonParentIsotopologues) {
-        if (_mavenParameters->stop)
+        vector<size_t> orphans;
+        if (!bucket.parents.empty()) {
+            vector<string> childNames;
+            childNames.reserve(childIndexes.size());
+            for (auto index : childIndexes)
+                childNames.push_back(nameFunc(allgroups[index]));
+            orphans = _matchParentsToChildren(bucket.parents,
+                                              childIndexes,
+                                              rtKeys,
+                                              childNames,
+                                              parentOf);
+        } else {
+            orphans = childIndexes;
+        }
+        if (orphans.empty())
             return;
 
-        Compound* compound = elem.first;
-        auto& isotopeIndexes = elem.second;
-        auto metaIsotopeGroups = _makeMeta(compound,
-                                           isotopeIndexes,
-                                           parentCompounds,
-                                           [](PeakGroup* group) {
-                                               return group->isotope().name;
-                                           },
-                                           _mavenParameters);
-        metaGroups[compound] = metaIsotopeGroups;
-    }
+        // for orphans, create a ghost, that will act as an empty parent
+        Compound* compound = allgroups[childIndexes.front()].getCompound();
+        allgroups.push_back(PeakGroup(ghostParameters,
+                                      PeakGroup::IntegrationType::Ghost));
 
-    // find adduct meta-groups
-    for (auto& elem : nonParentAdducts) {
-        if (_mavenParameters->stop)
-            return;
+        // set an appropriate slice for ghost parent
+        mzSlice slice;
+        slice.compound = compound;
+        slice.calculateMzMinMax(_mavenParameters->compoundMassCutoffWindow,
+                                _mavenParameters->getCharge());
+        slice.calculateRTMinMax(false, 0.0f);
+        allgroups.back().setSlice(slice);
+        allgroups.back().setSelectedSamples(_mavenParameters->samples);
+        allgroups.back().setGroupId(groupId++);
 
-        Compound* compound = elem.first;
-        auto& adductIndexes = elem.second;
-        auto metaAdductGroups = _makeMeta(compound,
-                                          adductIndexes,
-                                          parentCompounds,
-                                          [](PeakGroup* group) {
-                                              return group->adduct()->getName();
-                                          },
-                                          _mavenParameters);
-        if (metaGroups.count(compound) > 0) {
-            auto& existingMetaGroups = metaGroups[compound];
-            for (auto& elem : metaAdductGroups) {
-                size_t parentIndex = elem.first;
-                vector<size_t>& childAdductIndexes = elem.second;
-                if (existingMetaGroups.count(parentIndex) > 0) {
-                    vector<size_t>& existingChildIndexes =
-                        existingMetaGroups[parentIndex];
-                    existingChildIndexes.insert(end(existingChildIndexes),
-                                                begin(childAdductIndexes),
-                                                end(childAdductIndexes));
-                } else {
-                    existingMetaGroups[parentIndex] = childAdductIndexes;
-                }
-            }
-        } else {
-            metaGroups[compound] = metaAdductGroups;
+        size_t ghostIndex = allgroups.size() - 1;
+        for (auto child : orphans)
+            parentOf[child] = ghostIndex;
+    };
+
+    // find isotope meta-groups
+    for (auto& bucket : buckets) {
+        if (_mavenParameters->stop) {
+            allgroups.clear();
+            return;
         }
+        makeMeta(bucket, bucket.isotopes, [](PeakGroup& group) {
+            return group.isotope().name;
+        });
     }
 
-    // perform final meta-grouping and queue children to be erased
-    vector<size_t> indexesToErase;
-    for (auto& elem : metaGroups) {
+    // find adduct meta-groups
+    for (auto& bucket : buckets) {
         if (_mavenParameters->stop) {
-            _mavenParameters->allgroups.clear();
+            allgroups.clear();
             return;
         }
+        makeMeta(bucket, bucket.adducts, [](PeakGroup& group) {
+            return group.adduct()->getName();
+        });
+    }
 
-        auto& compoundMetaGroups = elem.second;
-        for (auto& metaElement : compoundMetaGroups) {
-            PeakGroup& parent = _mavenParameters->allgroups[metaElement.first];
-            auto& childIndexes = metaElement.second;
-            for (auto childIndex : childIndexes) {
-                PeakGroup& child = _mavenParameters->allgroups[childIndex];
-                if (child.isIsotope() && barplotIsotopes) {
-                    parent.addIsotopeChildBarPlot(child);
-                } else if (child.isIsotope()) {
-                    parent.addIsotopeChild(child);
-                }
-                if (child.isAdduct())
-                    parent.addAdductChild(child);
-                indexesToErase.push_back(childIndex);
+    // a group that is both a child and a parent (e.g., an isotopologue without
+    // an adduct) can end up in a cycle of parents; each cycle is broken at its
+    // first group in container order, which stays a top-level group
+    parentOf.resize(allgroups.size(), npos);
+    vector<char> visited(allgroups.size(), 0);
+    for (size_t start = 0; start < allgroups.size(); ++start) {
+        vector<size_t> path;
+        size_t index = start;
+        while (index != npos && visited[index] == 0) {
+            visited[index] = 1;
+            path.push_back(index);
+            index = parentOf[index];
+        }
+        if (index != npos && visited[index] == 1) {
+            auto cycleStart = find(begin(path), end(path), index);
+            parentOf[*min_element(cycleStart, end(path))] = npos;
+        }
+        for (auto member : path)
+            visited[member] = 2;
+    }
+
+    // perform final meta-grouping, isotopologues before adducts, children in
+    // container order; a child is only moved into its parent once its own
+    // children have been attached to it, and the emptied slots are compacted
+    // away at the end
+    removed.resize(allgroups.size(), false);
+    vector<size_t> pendingChildren(allgroups.size(), 0);
+    auto attachChildren = [&](const vector<size_t>& childIndexes,
+                              bool isotopes) {
+        vector<size_t> deferred;
+        for (size_t childIndex : childIndexes) {
+            size_t parentIndex = parentOf[childIndex];
+            if (parentIndex == npos)
+                continue;
+            if (pendingChildren[childIndex] > 0) {
+                deferred.push_back(childIndex);
+                continue;
+            }
+
+            PeakGroup& parent = allgroups[parentIndex];
+            PeakGroup& child = allgroups[childIndex];
+            if (isotopes && barplotIsotopes) {
+                parent.addIsotopeChildBarPlot(std::move(child));
+            } else if (isotopes) {
+                parent.addIsotopeChild(std::move(child));
+            } else {
+                parent.addAdductChild(std::move(child));
             }
+            removed[childIndex] = true;
+            --pendingChildren[parentIndex];
         }
+        return deferred;
+    };
+    vector<size_t> isotopeIndexes;
+    vector<size_t> adductIndexes;
+    for (auto& bucket : buckets) {
+        isotopeIndexes.insert(end(isotopeIndexes),
+                              begin(bucket.isotopes),
+                              end(bucket.isotopes));
+        adductIndexes.insert(end(adductIndexes),
+                             begin(bucket.adducts),
+                             end(bucket.adducts));
+    }
+    sort(begin(isotopeIndexes), end(isotopeIndexes));
+    sort(begin(adductIndexes), end(adductIndexes));
+    for (size_t i = 0; i < allgroups.size(); ++i) {
+        if (parentOf[i] != npos)
+            ++pendingChildren[parentOf[i]];
     }
 
-    // the following index-overwrite removal does not preserve order
-    mzUtils::eraseIndexes(_mavenParameters->allgroups, indexesToErase);
+    // every round attaches at least the children without pending children of
+    // their own, since parents no longer form cycles
+    while (!isotopeIndexes.empty() || !adductIndexes.empty()) {
+        isotopeIndexes = attachChildren(isotopeIndexes, true);
+        adductIndexes = attachChildren(adductIndexes, false);
+    }
+
+    compactGroups(removed);
 }
 
 void PeakDetector::detectIsotopesForParent(PeakGroup& parentGroup,
                                            bool findBarplotIsotopes)
 {
-    if (!_mavenParameters->pullIsotopesFlag
-        || !parentGroup.hasCompoundLink()
-        || parentGroup.getCompound()->formula().empty()
-        || parentGroup.isIsotope()) {
+    vector<PeakGroup*> parentGroups = {&parentGroup};
+    detectIsotopesForParents(parentGroups, findBarplotIsotopes);
+}
+
+void PeakDetector::detectIsotopesForParents(vector<PeakGroup*>& parentGroups,
+                                            bool findBarplotIsotopes)
+{
+    if (!_mavenParameters->pullIsotopesFlag)
         return;
-    }
 
-    if (findBarplotIsotopes) {
-        parentGroup.deleteChildIsotopesBarPlot();
-    } else {
-        parentGroup.deleteChildIsotopes();
+    vector<PeakGroup*> linkedParents;
+    vector<PeakGroup*> detectedParents;
+    for (auto parentGroup : parentGroups) {
+        if (parentGroup == nullptr
+            || !parentGroup->hasCompoundLink()
+            || parentGroup->getCompound()->formula().empty()
+            || parentGroup->isIsotope()) {
+            continue;
+        }
+
+        if (findBarplotIsotopes) {
+            parentGroup->deleteChildIsotopesBarPlot();
+        } else {
+            parentGroup->deleteChildIsotopes();
+        }
+
+        if (parentGroup->integrationType() == PeakGroup::IntegrationType::Manual
+            && _mavenParameters->linkIsotopeRtRange) {
+            linkedParents.push_back(parentGroup);
+        } else {
+            detectedParents.push_back(parentGroup);
+        }
     }
+    if (linkedParents.empty() && detectedParents.empty())
+        return;
+
+    // compounds in order of first appearance, along with the parents that
+    // need their isotopologues
+    typedef unordered_map<Compound*, vector<PeakGroup*>> GroupsPerCompound;
+    auto groupByCompound = [](const vector<PeakGroup*>& parents,
+                              vector<Compound*>& compounds,
+                              GroupsPerCompound& parentsOf) {
+        for (auto parentGroup : parents) {
+            auto compound = parentGroup->getCompound();
+            if (parentsOf.count(compound) == 0)
+                compounds.push_back(compound);
+            parentsOf[compound].push_back(parentGroup);
+        }
+    };
 
-    if (parentGroup.integrationType() == PeakGroup::IntegrationType::Manual
-        && _mavenParameters->linkIsotopeRtRange) {
+    if (!linkedParents.empty()) {
         vector<mzSample*> visibleSamples;
         for (auto sample : _mavenParameters->samples) {
             if (sample == nullptr || !sample->isSelected)
@@ -1093,65 +1198,107 @@ void PeakDetector::detectIsotopesForParent(PeakGroup& parentGroup,
             visibleSamples.push_back(sample);
         }
 
-        auto parentSlice = parentGroup.getSlice();
+        vector<Compound*> compounds;
+        GroupsPerCompound parentsOf;
+        groupByCompound(linkedParents, compounds, parentsOf);
+
+        // all isotope slices are generated in a single pass and each of them
+        // is integrated once for every parent sharing its compound
         MassSlicer massSlicer(_mavenParameters);
-        massSlicer.generateIsotopeSlices({parentGroup.getCompound()},
-                                         findBarplotIsotopes);
+        massSlicer.generateIsotopeSlices(compounds, findBarplotIsotopes);
+        vector<pair<mzSlice*, PeakGroup*>> regions;
         for (const auto& slice : massSlicer.slices) {
-            if (_mavenParameters->stop)
-                return;
-
             if (slice->isotope.isParent())
                 continue;
+            for (auto parentGroup : parentsOf[slice->compound])
+                regions.push_back(make_pair(slice, parentGroup));
+        }
 
-            slice->rtmin = parentSlice.rtmin;
-            slice->rtmax = parentSlice.rtmax;
-            auto eics = pullEICs(slice, visibleSamples, _mavenParameters);
-            auto isotopeGroup = integrateEicRegion(eics,
-                                                   parentGroup.minRt,
-                                                   parentGroup.maxRt,
-                                                   *slice,
-                                                   visibleSamples,
-                                                   _mavenParameters,
-                                                   _mavenParameters->clsf,
-                                                   true);
+        vector<shared_ptr<PeakGroup>> isotopeGroups(regions.size());
+#ifdef OMP_PARALLEL
+#pragma omp parallel for schedule(dynamic)
+#endif
+        for (size_t i = 0; i < regions.size(); ++i) {
+            if (_mavenParameters->stop)
+                continue;
+
+            auto parentGroup = regions[i].second;
+            auto parentSlice = parentGroup->getSlice();
+            mzSlice slice = *(regions[i].first);
+            slice.rtmin = parentSlice.rtmin;
+            slice.rtmax = parentSlice.rtmax;
+            auto eics = pullEICs(&slice, visibleSamples, _mavenParameters);
+            isotopeGroups[i] = integrateEicRegion(eics,
+                                                  parentGroup->minRt,
+                                                  parentGroup->maxRt,
+                                                  slice,
+                                                  visibleSamples,
+                                                  _mavenParameters,
+                                                  _mavenParameters->clsf,
+                                                  true);
             delete_all(eics);
-            if (isotopeGroup->peakCount() == 0)
+        }
+        massSlicer.clearSlices();
+        if (_mavenParameters->stop)
+            return;
+
+        for (size_t i = 0; i < regions.size(); ++i) {
+            auto parentGroup = regions[i].second;
+            auto& isotopeGroup = isotopeGroups[i];
+            if (isotopeGroup == nullptr || isotopeGroup->peakCount() == 0)
                 continue;
 
             if (findBarplotIsotopes) {
-                parentGroup.addIsotopeChildBarPlot(*isotopeGroup);
+                parentGroup->addIsotopeChildBarPlot(std::move(*isotopeGroup));
             } else {
-                parentGroup.addIsotopeChild(*isotopeGroup);
+                parentGroup->addIsotopeChild(std::move(*isotopeGroup));
             }
         }
-        massSlicer.clearSlices();
-    } else {
-        processCompounds({parentGroup.getCompound()},
-                         false,
-                         findBarplotIsotopes);
+    }
+
+    if (!detectedParents.empty()) {
+        vector<Compound*> compounds;
+        GroupsPerCompound parentsOf;
+        groupByCompound(detectedParents, compounds, parentsOf);
+
+        // a single detection run for all compounds, whose groups are then
+        // looked up per compound instead of scanning all of them per parent
+        processCompounds(compounds, false, findBarplotIsotopes);
+        GroupsPerCompound groupsOf;
         for (auto& group : _mavenParameters->allgroups) {
-            if (_mavenParameters->stop)
-                return;
-
-            // we cannot rely here on exact matches in m/z or RT because the
-            // original "parentGroup" could have been manually integrated by the
-            // user and can be different enough than our auto-integrated
-            // "group", even if they essentially represent the same peak-group.
-            if (abs(group.meanMz - parentGroup.meanMz) < 0.001
-                && abs(group.meanRt - parentGroup.meanRt) < 0.01) {
-                if (findBarplotIsotopes) {
-                    for (auto& child : group.childIsotopesBarPlot())
-                        parentGroup.addIsotopeChildBarPlot(*child);
-                } else {
-                    for (auto& child : group.childIsotopes())
-                        parentGroup.addIsotopeChild(*child);
-                }
+            if (group.hasCompoundLink())
+                groupsOf[group.getCompound()].push_back(&group);
+        }
 
-                if (_mavenParameters->linkIsotopeRtRange)
-                    linkParentIsotopeRange(parentGroup, findBarplotIsotopes);
+        for (auto compound : compounds) {
+            for (auto parentGroup : parentsOf[compound]) {
+                for (auto group : groupsOf[compound]) {
+                    if (_mavenParameters->stop)
+                        return;
+
+                    // we cannot rely here on exact matches in m/z or RT
+                    // because the original "parentGroup" could have been
+                    // manually integrated by the user and can be different
+                    // enough than our auto-integrated "group", even if they
+                    // essentially represent the same peak-group.
+                    if (abs(group->meanMz - parentGroup->meanMz) < 0.001
+                        && abs(group->meanRt - parentGroup->meanRt) < 0.01) {
+                        if (findBarplotIsotopes) {
+                            for (auto& child : group->childIsotopesBarPlot())
+                                parentGroup->addIsotopeChildBarPlot(*child);
+                        } else {
+                            for (auto& child : group->childIsotopes())
+                                parentGroup->addIsotopeChild(*child);
+                        }
+
+                        if (_mavenParameters->linkIsotopeRtRange) {
+                            linkParentIsotopeRange(*parentGroup,
+                                                   findBarplotIsotopes);
+                        }
 
-                break;
+                        break;
+                    }
+                }
             }
         }
     }
@@ -1161,12 +1308,16 @@ void PeakDetector::detectIsotopesForParent(PeakGroup& parentGroup,
         auto childType = GroupFiltering::ChildFilterType::Isotope;
         if (findBarplotIsotopes)
             childType = GroupFiltering::ChildFilterType::BarplotIsotope;
-        groupFilter.filterBasedOnParent(
-            parentGroup,
-            childType,
-            _mavenParameters->maxIsotopeScanDiff,
-            _mavenParameters->minIsotopicCorrelation,
-            _mavenParameters->compoundMassCutoffWindow);
+        for (auto parentGroup : linkedParents)
+            detectedParents.push_back(parentGroup);
+        for (auto parentGroup : detectedParents) {
+            groupFilter.filterBasedOnParent(
+                *parentGroup,
+                childType,
+                _mavenParameters->maxIsotopeScanDiff,
+                _mavenParameters->minIsotopicCorrelation,
+                _mavenParameters->compoundMassCutoffWindow);
+        }
     }
 }
 
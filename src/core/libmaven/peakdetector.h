@@ -162,6 +162,23 @@ public:
     void detectIsotopesForParent(PeakGroup& parentGroup,
                                  bool findBarplotIsotopes = false);
 
+    /**
+     * @brief Find isotopologues for a number of parent peak-groups at once.
+     * @details Behaves like `detectIsotopesForParent` for each of the given
+     * groups, but all isotope slices are generated in one pass. Parents with
+     * linked RT ranges have their isotopic EICs pulled and integrated once per
+     * slice (in parallel), within their own RT bounds. All other parents are
+     * served by a single detection run over their compounds, whose groups are
+     * then matched to the parents compound-wise.
+     * @param parentGroups Peak-groups for unlabelled forms of metabolites.
+     * Groups that are not eligible (no linked formula, or isotopic themselves)
+     * are left untouched.
+     * @param findBarplotIsotopes If `true`, any isotopes detected will be
+     * added to the parent peak-groups' `childIsotopesBarPlot` vector.
+     */
+    void detectIsotopesForParents(std::vector<PeakGroup*>& parentGroups,
+                                  bool findBarplotIsotopes = false);
+
     void linkParentIsotopeRange(PeakGroup& parentGroup,
                                 bool findBarplotIsotopes = false);
 
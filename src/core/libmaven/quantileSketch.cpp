@@ -0,0 +1,99 @@
+#include <cstring>
+
+#include "quantileSketch.h"
+
+// positive floats are ordered like their bit patterns, keeping the exponent
+// and the leading 7 bits of the mantissa therefore gives ordered buckets
+const int _bucketShift = 16;
+
+uint32_t QuantileSketch::_bucket(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits >> _bucketShift;
+}
+
+float QuantileSketch::_bucketValue(uint32_t bucket)
+{
+    uint32_t lowerBits = bucket << _bucketShift;
+    uint32_t upperBits = lowerBits + ((1 << _bucketShift) - 1);
+    float lower, upper;
+    memcpy(&lower, &lowerBits, sizeof(lower));
+    memcpy(&upper, &upperBits, sizeof(upper));
+    return lower + (upper - lower) / 2;
+}
+
+void QuantileSketch::add(float value)
+{
+    if (!isfinite(value))
+        return;
+
+    if (_count == 0) {
+        _min = value;
+        _max = value;
+    } else {
+        _min = min(_min, value);
+        _max = max(_max, value);
+    }
+    ++_count;
+
+    if (value <= 0.0f) {
+        ++_nonPositiveCount;
+        return;
+    }
+
+    uint32_t bucket = _bucket(value);
+    if (_bucketCounts.empty()) {
+        _firstBucket = bucket;
+    } else if (bucket < _firstBucket) {
+        _bucketCounts.insert(_bucketCounts.begin(), _firstBucket - bucket, 0);
+        _firstBucket = bucket;
+    }
+    if (bucket - _firstBucket >= _bucketCounts.size())
+        _bucketCounts.resize(bucket - _firstBucket + 1, 0);
+    ++_bucketCounts[bucket - _firstBucket];
+}
+
+void QuantileSketch::clear()
+{
+    _count = 0;
+    _nonPositiveCount = 0;
+    _min = 0.0f;
+    _max = 0.0f;
+    _firstBucket = 0;
+    _bucketCounts.clear();
+}
+
+float QuantileSketch::valueAtRank(size_t rank) const
+{
+    if (_count == 0)
+        return 0.0f;
+    if (rank == 0)
+        return _min;
+    if (rank >= _count - 1)
+        return _max;
+
+    float value = 0.0f;
+    if (rank >= _nonPositiveCount) {
+        size_t seen = _nonPositiveCount;
+        for (size_t i = 0; i < _bucketCounts.size(); ++i) {
+            seen += _bucketCounts[i];
+            if (rank < seen) {
+                value = _bucketValue(_firstBucket + i);
+                break;
+            }
+        }
+    }
+    return min(max(value, _min), _max);
+}
+
+vector<float> QuantileSketch::quantileDistribution() const
+{
+    vector<float> quantiles(101, 0);
+    for (int i = 0; i < 101; i++) {
+        size_t pos = i / 100.0 * _count;
+        if (pos < _count)
+            quantiles[i] = valueAtRank(pos);
+    }
+    return quantiles;
+}
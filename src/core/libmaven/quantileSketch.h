@@ -0,0 +1,65 @@
+#ifndef QUANTILESKETCH_H
+#define QUANTILESKETCH_H
+
+#include "standardincludes.h"
+
+using namespace std;
+
+/**
+ * @brief The QuantileSketch class summarizes a stream of values so that
+ * their quantiles can be estimated without keeping the values themselves.
+ * @details Positive values are counted in buckets that split each power of
+ * two into 128 equal parts, found directly from the bits of a float, so that
+ * any estimate is within 0.4% of the value at the requested rank. Only the
+ * buckets between the smallest and largest value seen are allocated. Values
+ * that are zero or negative share a single bucket, estimated as zero, while
+ * the smallest and largest values are kept exactly.
+ */
+class QuantileSketch
+{
+public:
+    /**
+     * @brief Add a value to the sketch. Values that are not finite are
+     * ignored.
+     */
+    void add(float value);
+
+    /**
+     * @brief Remove all values.
+     */
+    void clear();
+
+    /**
+     * @brief Number of values added so far.
+     */
+    size_t count() const { return _count; }
+
+    /**
+     * @brief Estimate the value at the given rank, i.e. the value that
+     * would be found at that index if all values were sorted.
+     * @param rank Rank of the value, less than `count()`.
+     */
+    float valueAtRank(size_t rank) const;
+
+    /**
+     * @brief Estimate the percentiles of the values, in the same way as
+     * `mzUtils::quantileDistribution` finds them over sorted values.
+     * @return Vector of 101 values, one for every percentile from 0 to 100.
+     */
+    vector<float> quantileDistribution() const;
+
+private:
+    size_t _count = 0;
+    size_t _nonPositiveCount = 0;
+    float _min = 0.0f;
+    float _max = 0.0f;
+
+    // counts of positive values, for buckets starting from `_firstBucket`
+    uint32_t _firstBucket = 0;
+    vector<size_t> _bucketCounts;
+
+    static uint32_t _bucket(float value);
+    static float _bucketValue(uint32_t bucket);
+};
+
+#endif  // QUANTILESKETCH_H
@@ -32,7 +32,7 @@ void SpectralLibExport::_writePeakGroupAsMsp(PeakGroup *group)
     if (group->isGhost())
         return;
 
-    Fragment fragmentationProfile = group->fragmentationPattern;
+    Fragment fragmentationProfile = group->fragmentationPattern();
     if (fragmentationProfile.nobs() == 0)
         return;
 
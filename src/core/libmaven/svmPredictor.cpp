@@ -8,6 +8,14 @@
 svmPredictor::svmPredictor()
 {
     num_features = 8;
+    model = nullptr;
+
+    // a single node buffer, terminated by an index of -1, is shared by all
+    // predictions
+    x = (struct svm_node *)malloc((num_features + 1) * sizeof(struct svm_node));
+    for (int i = 0; i < num_features; i++)
+        x[i].index = i + 1;
+    x[num_features].index = -1;
 }
 
 svmPredictor::~svmPredictor()
@@ -18,6 +26,7 @@ svmPredictor::~svmPredictor()
 
 void svmPredictor::loadModel(string filename)
 {
+    svm_free_and_destroy_model(&model);
     model = svm_load_model(filename.c_str());
     if (!model)
     {
@@ -28,29 +37,19 @@ void svmPredictor::loadModel(string filename)
 
 void svmPredictor::predict(PeakGroup *grp)
 {
-    vector<float> features = getFeatures(grp);
-
-    max_nr_attr = 9;
     if (model)
     {
-        int svm_type = svm_get_svm_type(model);
-        int nr_class = svm_get_nr_class(model);
-        x = (struct svm_node *)malloc(max_nr_attr * sizeof(struct svm_node));
-
-        for (size_t i=0; i < num_features; i++)
-        {
-
-            x[i].index = i+1;
+        vector<float> features = getFeatures(grp);
+        for (int i = 0; i < num_features; i++)
             x[i].value = double(features[i]);
-        }
-        x[num_features].index = -1;
-        //Only predicted labels
-
-        int *labels=(int *) malloc(nr_class*sizeof(int));
 
-		svm_get_labels(model,labels);
-        grp->predictedLabel = int(svm_predict(model,x));
-
-        //cerr << endl << grp->predictedLabel << endl;
+        //Only predicted labels
+        grp->predictedLabel = int(svm_predict(model, x));
     }
 }
+
+void svmPredictor::predict(vector<PeakGroup*>& groups)
+{
+    for (auto group : groups)
+        predict(group);
+}
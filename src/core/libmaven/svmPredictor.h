@@ -2,6 +2,7 @@
 #define SVM_PREDICTOR_H
 
 #include <string>
+#include <vector>
 
 class PeakGroup;
 
@@ -11,12 +12,18 @@ class svmPredictor
     svmPredictor();
     ~svmPredictor();
     void predict(PeakGroup *grp);
+
+    /**
+     * @brief Predict labels for many groups, reusing the same buffers for
+     * each of them.
+     * @param groups Groups whose `predictedLabel` will be set.
+     */
+    void predict(vector<PeakGroup*>& groups);
     void loadModel(string filename);
 
   private:
     const string modelFile = "bin/weights/svm.model";
     struct svm_model* model;
-    int max_nr_attr = 64;
     struct svm_node *x;
     int num_features;
 };
@@ -97,9 +97,9 @@ void BackgroundOpsThread::run(void)
         pullIsotopesForFormula(_isotopeFormula,
                                _isotopeCharge);
     } else if (runFunction == "pullIsotopesForGroup") {
-        pullIsotopesForGroup(_parentGroup.get());
+        pullIsotopesForGroups(_parentGroups, false);
     } else if (runFunction == "pullIsotopesForBarPlot") {
-        pullIsotopesForBarPlot(_parentGroup.get());
+        pullIsotopesForGroups(_parentGroups, true);
     } else {
         qWarning() << QString("Unknown function: \"%1\"")
                           .arg(runFunction.c_str());
@@ -334,14 +334,14 @@ void BackgroundOpsThread::pullIsotopesForFormula(string formula, int charge)
     peakDetector->processCompounds({&tempCompound}, false);
 }
 
-void BackgroundOpsThread::pullIsotopesForGroup(PeakGroup* parentGroup)
+void BackgroundOpsThread::pullIsotopesForGroups(
+    vector<shared_ptr<PeakGroup>>& parentGroups,
+    bool findBarplotIsotopes)
 {
-    peakDetector->detectIsotopesForParent(*parentGroup);
-}
-
-void BackgroundOpsThread::pullIsotopesForBarPlot(PeakGroup* parentGroup)
-{
-    peakDetector->detectIsotopesForParent(*parentGroup, true);
+    vector<PeakGroup*> groups;
+    for (auto& group : parentGroups)
+        groups.push_back(group.get());
+    peakDetector->detectIsotopesForParents(groups, findBarplotIsotopes);
 }
 
 void BackgroundOpsThread::updateGroups(QList<shared_ptr<PeakGroup>>& groups,
@@ -48,9 +48,23 @@ public:
     void setParentGroup(shared_ptr<PeakGroup> group)
     {
         _parentGroup = make_shared<PeakGroup>(*group);
+        _parentGroups = {_parentGroup};
+    }
+
+    /**
+     * @brief Set copies of the given groups as parents whose isotopologues
+     * are all pulled together, in a single batch.
+     */
+    void setParentGroups(const vector<shared_ptr<PeakGroup>>& groups)
+    {
+        _parentGroups.clear();
+        for (auto& group : groups)
+            _parentGroups.push_back(make_shared<PeakGroup>(*group));
+        _parentGroup = _parentGroups.empty() ? nullptr : _parentGroups.front();
     }
 
     shared_ptr<PeakGroup> parentGroup() { return _parentGroup; }
+    vector<shared_ptr<PeakGroup>> parentGroups() { return _parentGroups; }
 
     void completeStop();
 
@@ -108,8 +122,8 @@ private:
     void emitGroups();
 
     void pullIsotopesForFormula(string formula, int charge);
-    void pullIsotopesForGroup(PeakGroup* parentGroup);
-    void pullIsotopesForBarPlot(PeakGroup* parentGroup);
+    void pullIsotopesForGroups(vector<shared_ptr<PeakGroup>>& parentGroups,
+                               bool findBarplotIsotopes);
 
     void computePeaks();
     void findFeatures();
@@ -118,8 +132,10 @@ private:
     string _isotopeFormula;
     int _isotopeCharge;
 
-    // argument for `pullIsotopesForGroup` and `pullIsotopesForBarplot`
+    // arguments for `pullIsotopesForGroups`, `_parentGroup` being the first
+    // of `_parentGroups`
     shared_ptr<PeakGroup> _parentGroup;
+    vector<shared_ptr<PeakGroup>> _parentGroups;
 
     // perform PolyFit alignment just after peak detection (if true)
     bool _performPolyFitAlignment;
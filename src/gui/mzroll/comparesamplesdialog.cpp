@@ -22,17 +22,6 @@ CompareSamplesDialog::CompareSamplesDialog(QWidget *parent) :
 			SLOT(updateSampleList()));
 	connect(filelist2, SIGNAL(itemSelectionChanged()),
 			SLOT(updateSampleList()));
-	/*
-
-	 float A[] = { 368, 390, 379, 260, 404, 318, 352, 359, 216, 222, 283, 332 };
-	 float B[] = { 423, 340, 392, 339, 341, 226, 320, 295, 334, 322, 297, 318 };
-	 int n1=12; int n2=12;
-	 StatisticsVector<float> setA(n1);
-	 StatisticsVector<float> setB(n2);
-	 for(int i=0; i < n1;  i++ ) setA[i]=A[i];
-	 for(int i=0; i < n2;  i++ ) setB[i]=B[i];
-	 shuffle(setA,setB);
-	 */
 }
 
 CompareSamplesDialog::~CompareSamplesDialog() {
@@ -157,38 +146,23 @@ void CompareSamplesDialog::compareSets(vector<mzSample*> sset1,
 	if (!table)
 		return;
 
-	vector<mzSample*> sampleSet;
-	for (int i = 0; i < sset1.size(); i++)
-		sampleSet.push_back(sset1[i]);
-	for (int i = 0; i < sset2.size(); i++)
-		sampleSet.push_back(sset2[i]);
-
     QList<shared_ptr<PeakGroup>> allgroups = table->getGroups();
-	compareLogic.rand_scores.clear();
 
-	for (int i = 0; i < allgroups.size(); i++) {
-		//replace missing values
-		float _missingValue = missingValue->value();
-
-        shared_ptr<PeakGroup> group = allgroups[i];
-        compareLogic.computeStats(group.get(),
-                                  sampleSet,
-                                  sset1,
-                                  sset2,
-                                  _missingValue);
-
-		//qDebug() << "CompareSamplesDialog: " << i << " " << meanA << " " << meanB;
-		Q_EMIT(setProgressBar("CompareSamples", i + 1, allgroups.size()));
-	}
+	//replace missing values
+	float _missingValue = missingValue->value();
 
 	float alpha = minPValue->value(); //alpha value //TODO: Alpha value is not being used
 
-	//calculate Pvalues
-	compareLogic.computeMinPValue(allgroups);
-
-	//correct P-values (FDR)
+	//calculate fold changes and P-values, corrected for FDR
 	int correction = correctionBox->currentIndex();
-	compareLogic.FDRCorrection(allgroups, correction);
+	compareLogic.compareGroups(allgroups,
+	                           sset1,
+	                           sset2,
+	                           _missingValue,
+	                           correction);
+	Q_EMIT(setProgressBar("CompareSamples",
+	                      allgroups.size(),
+	                      allgroups.size()));
 
 	//if (table) { table->updateTable();}
 	if (parentWidget())
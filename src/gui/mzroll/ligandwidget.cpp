@@ -317,6 +317,18 @@ void LigandWidget::showMatches(QString needle)
     if (!regexp.isValid())
         return;
 
+    // plain text is looked up in the database's search index, only actual
+    // regular expressions need to be matched against every item
+    string dbName = getDatabaseName().toStdString();
+    string query = needle.toStdString();
+    bool indexed = !needle.isEmpty()
+                   && CompoundSearchIndex::isLiteralQuery(query);
+    set<Compound*> matches;
+    if (indexed) {
+        for (const auto& match : DB.searchCompounds(query, dbName))
+            matches.insert(match.first);
+    }
+
     QTreeWidgetItemIterator itr(treeWidget);
     while (*itr) {
         QTreeWidgetItem* item = (*itr);
@@ -331,6 +343,8 @@ void LigandWidget::showMatches(QString needle)
             item->setHidden(true);
             if (needle.isEmpty()) {
                 item->setHidden(false);
+            } else if (indexed && compound->db() == dbName) {
+                item->setHidden(matches.count(compound) == 0);
             } else if (item->text(0).contains(regexp)) {
                 item->setHidden(false);
             } else {
@@ -196,12 +196,14 @@ void MassCalcWidget::setPeakGroup(PeakGroup* grp) {
     if(grp->ms2EventCount == 0)
         grp->computeFragPattern(fragPpm->value());
 
+    // scoring annotates the experimental pattern, so score against a copy
+    // instead of the group's own (shared) pattern
+    Fragment pattern = grp->fragmentationPattern();
     for(auto& m : matches) {
         Compound* cpd = m->compoundLink;
 
-        if(grp->fragmentationPattern.nobs() != 0) {
-            m->fragScore = cpd->scoreCompoundHit(&(grp->fragmentationPattern),
-                                                 fragPpm->value());
+        if(pattern.nobs() != 0) {
+            m->fragScore = cpd->scoreCompoundHit(&pattern, fragPpm->value());
         }
 
         if (cpd->expectedRt() > 0)
@@ -19,6 +19,7 @@
 #include "mzAligner.h"
 #include "mzfileio.h"
 #include "mzrolldbconverter.h"
+#include "mzrollreader.h"
 #include "mzSample.h"
 #include "mzUtils.h"
 #include "projectdatabase.h"
@@ -1059,300 +1060,12 @@ QString mzFileIO::swapFilenameExtension(QString filename, QString ext)
     return newFilename;
 }
 
-void mzFileIO::markv_0_1_5mzroll(QString fileName)
-{
-    mzrollv_0_1_5 = true;
-
-    QFile data(fileName);
-
-    if (!data.open(QFile::ReadOnly)) {
-        return;
-    }
-
-    QXmlStreamReader xml(&data);
-    while (!xml.atEnd()) {
-        xml.readNext();
-        if (xml.isStartElement()) {
-            if (xml.name() == "SamplesUsed") {
-                // mark false if <SamplesUsed> which is only in new version
-                mzrollv_0_1_5 = false;
-                break;
-            }
-        }
-    }
-
-    data.close();
-
-    return;
-}
-
-void mzFileIO::cleanString(QString& name)
-{
-    name.replace('#', '_');
-    name = 's' + name;
-}
-
-void mzFileIO::readSamplesXML(QXmlStreamReader& xml,
-                              PeakGroup* group,
-                              float mzrollVersion)
-{
-    vector<mzSample*> samples = _mainwindow->getSamples();
-
-    if (mzrollVersion == 1) {
-        if (xml.name() == "SamplesUsed") {
-            xml.readNextStartElement();
-            while (xml.name() == "sample") {
-                unsigned int id =
-                    xml.attributes().value("id").toString().toInt();
-                for (int i = 0; i < samples.size(); ++i) {
-                    mzSample* sample = samples[i];
-                    if (id == sample->getSampleId()) {
-                        group->samples.push_back(sample);
-                    }
-                }
-                xml.readNextStartElement();
-            }
-        }
-    } else {
-        for (int i = 0; i < samples.size(); ++i) {
-            QString name = QString::fromStdString(samples[i]->sampleName);
-            cleanString(name);
-            if (xml.name() == "PeakGroup" && mzrollv_0_1_5
-                && samples[i]->isSelected) {
-                /**
-                 * if mzroll is from old version, just insert sample in group
-                 * from checking whether it is selected or not at time of
-                 * exporting. This can give erroneous result for old version if
-                 * at time of exporting mzroll user has selected diffrent
-                 * samples from samples were used at time of peak finding which
-                 * was inherent problem of old version of ElMaven.
-                 */
-                group->samples.push_back(samples[i]);
-            } else if (xml.name() == "SamplesUsed"
-                       && xml.attributes().value(name).toString() == "Used") {
-                /**
-                 * if mzroll file is of new version, it's sample name will
-                 * precede by 's' and has value of <Used> or <NotUsed>
-                 */
-                group->samples.push_back(samples[i]);
-            }
-        }
-    }
-}
-
-PeakGroup* mzFileIO::readGroupXML(QXmlStreamReader& xml, PeakGroup* parent)
-{
-    PeakGroup* group = new PeakGroup(
-        make_shared<MavenParameters>(*_mainwindow->mavenParameters),
-        PeakGroup::IntegrationType::Programmatic);
-
-    group->setGroupId(xml.attributes().value("groupId").toString().toInt());
-    group->clusterId = xml.attributes().value("clusterId").toString().toInt();
-    group->groupRank = xml.attributes().value("grouRank").toString().toFloat();
-    group->tagIsotope(xml.attributes().value("tagString").toString().toStdString(),
-                      xml.attributes().value("expectedMz").toString().toFloat(),
-                      0.0f);
-    group->label = xml.attributes().value("label").toString().toInt();
-    group->setType((PeakGroup::GroupType)xml.attributes()
-                       .value("type")
-                       .toString()
-                       .toInt());
-    group->changeFoldRatio =
-        xml.attributes().value("changeFoldRatio").toString().toFloat();
-    group->changePValue =
-        xml.attributes().value("changePValue").toString().toFloat();
-
-    string compoundId =
-        xml.attributes().value("compoundId").toString().toStdString();
-    string compoundDB =
-        xml.attributes().value("compoundDB").toString().toStdString();
-    string compoundName =
-        xml.attributes().value("compoundName").toString().toStdString();
-
-    string srmId = xml.attributes().value("srmId").toString().toStdString();
-    if (!srmId.empty())
-        group->setSrmId(srmId);
-
-    if (!compoundName.empty() && !compoundDB.empty()) {
-        vector<Compound*> matches =
-            DB.findSpeciesByName(compoundName, compoundDB);
-        if (matches.size() > 0)
-            group->setCompound(matches[0]);
-    } else if (!compoundId.empty()) {
-        Compound* c = nullptr;
-
-        if (group->getCompound() && !group->getCompound()->name().empty()) {
-            c = DB.findSpeciesByIdAndName(compoundId,
-                                          group->getCompound()->name(),
-                                          DB.ANYDATABASE);
-        } else if (!compoundDB.empty()) {
-            vector<Compound*> matches = DB.findSpeciesById(compoundId, compoundDB);
-            if (matches.size())
-                c = matches[0];
-        }
-        
-        if (c)
-            group->setCompound(c);
-    }
-
-    if (!group->getCompound()) {
-        if (!compoundId.empty())
-            group->tagString = compoundId;
-        else if (!compoundName.empty())
-            group->tagString = compoundName;
-    }
-
-    if (parent) {
-        parent->addIsotopeChild(*group);
-        if (parent->childIsotopeCount() > 0)
-            group = parent->childIsotopes()[parent->childIsotopeCount() - 1].get();
-    }
-
-    return group;
-}
-
-void mzFileIO::readPeakXML(QXmlStreamReader& xml, PeakGroup* parent)
-{
-    Peak p;
-    p.pos = xml.attributes().value("pos").toString().toInt();
-    p.minpos = xml.attributes().value("minpos").toString().toInt();
-    p.maxpos = xml.attributes().value("maxpos").toString().toInt();
-    p.splineminpos = xml.attributes().value("splineminpos").toString().toInt();
-    p.splinemaxpos = xml.attributes().value("splinemaxpos").toString().toInt();
-    p.rt = xml.attributes().value("rt").toString().toDouble();
-    p.rtmin = xml.attributes().value("rtmin").toString().toDouble();
-    p.rtmax = xml.attributes().value("rtmax").toString().toDouble();
-    p.mzmin = xml.attributes().value("mzmin").toString().toDouble();
-    p.mzmax = xml.attributes().value("mzmax").toString().toDouble();
-    p.scan = xml.attributes().value("scan").toString().toInt();
-    p.minscan = xml.attributes().value("minscan").toString().toInt();
-    p.maxscan = xml.attributes().value("maxscan").toString().toInt();
-    p.peakArea = xml.attributes().value("peakArea").toString().toDouble();
-    p.peakSplineArea =
-        xml.attributes().value("peakSplineArea").toString().toDouble();
-    p.peakAreaCorrected =
-        xml.attributes().value("peakAreaCorrected").toString().toDouble();
-    p.peakAreaTop = xml.attributes().value("peakAreaTop").toString().toDouble();
-    p.peakAreaTopCorrected =
-        xml.attributes().value("peakAreaTopCorrected").toString().toDouble();
-    p.peakAreaFractional =
-        xml.attributes().value("peakAreaFractional").toString().toDouble();
-    p.peakRank = xml.attributes().value("peakRank").toString().toDouble();
-    p.peakIntensity =
-        xml.attributes().value("peakIntensity").toString().toDouble();
-    p.peakBaseLineLevel =
-        xml.attributes().value("peakBaseLineLevel").toString().toDouble();
-    p.peakMz = xml.attributes().value("peakMz").toString().toDouble();
-    p.medianMz = xml.attributes().value("medianMz").toString().toDouble();
-    p.baseMz = xml.attributes().value("baseMz").toString().toDouble();
-    p.quality = xml.attributes().value("quality").toString().toDouble();
-    p.width = xml.attributes().value("width").toString().toInt();
-    p.gaussFitSigma =
-        xml.attributes().value("gaussFitSigma").toString().toDouble();
-    p.gaussFitR2 = xml.attributes().value("gaussFitR2").toString().toDouble();
-    p.groupNum = xml.attributes().value("groupNum").toString().toInt();
-    p.noNoiseObs = xml.attributes().value("noNoiseObs").toString().toInt();
-    p.noNoiseFraction =
-        xml.attributes().value("noNoiseFraction").toString().toDouble();
-    p.symmetry = xml.attributes().value("symmetry").toString().toDouble();
-    p.signalBaselineRatio =
-        xml.attributes().value("signalBaselineRatio").toString().toDouble();
-    p.groupOverlap =
-        xml.attributes().value("groupOverlap").toString().toDouble();
-    p.groupOverlapFrac =
-        xml.attributes().value("groupOverlapFrac").toString().toDouble();
-    p.localMaxFlag = xml.attributes().value("localMaxFlag").toString().toInt();
-    p.fromBlankSample =
-        xml.attributes().value("fromBlankSample").toString().toInt();
-    p.label = xml.attributes().value("label").toString().toInt();
-    string sampleName =
-        xml.attributes().value("sample").toString().toStdString();
-    vector<mzSample*> samples = _mainwindow->getSamples();
-    for (int i = 0; i < samples.size(); i++) {
-        if (samples[i]->sampleName == sampleName) {
-            p.setSample(samples[i]);
-            break;
-        }
-    }
-
-    parent->addPeak(p);
-}
-
 vector<PeakGroup*> mzFileIO::readGroupsXML(QString fileName)
 {
-    markv_0_1_5mzroll(fileName);
-
-    QFile data(fileName);
-    vector<PeakGroup*> groups;
-    if ( !data.open(QFile::ReadOnly) ) {
-        cerr << "File open: " << fileName.toStdString() << " failed" << endl;
-        return groups;
-    }
-
-    QXmlStreamReader xml(&data);
-    PeakGroup* group = nullptr;
-    PeakGroup* parent = nullptr;
-    QStack<PeakGroup*> stack;
-
-    float mzrollVersion = 0;
-
-    while (!xml.atEnd()) {
-        if (xml.isStartElement() && xml.name() == "project") {
-            mzrollVersion = xml.attributes().value("mzrollVersion").toFloat();
-        }
-        xml.readNext();
-        if (xml.hasError()) {
-            qDebug() << "Error in xml reading: " << xml.errorString();
-        }
-        if (xml.isStartElement()) {
-            if (xml.name() == "PeakGroup") {
-                group = readGroupXML(xml, parent);
-                if (!group->isIsotope())
-                    groups.push_back(group);
-            }
-            if (xml.name() == "SamplesUsed" && group) {
-                readSamplesXML(xml, group, mzrollVersion);
-            }
-            if (xml.name() == "Peak" && group) {
-                readPeakXML(xml, group);
-            }
-            if (xml.name() == "children" && group) {
-                stack.push(group);
-                parent = stack.top();
-            }
-        }
-
-        if (xml.isEndElement()) {
-           if (xml.name() == "children") {
-                if (stack.size() > 0)
-                    parent = stack.pop();
-                if (parent && parent->childIsotopeCount()) {
-                    for (int i = 0; i < parent->childIsotopes().size(); i++) {
-                        parent->childIsotopes()[i]->minQuality =
-                            _mainwindow->mavenParameters->minQuality;
-                        parent->childIsotopes()[i]->groupStatistics();
-                    }
-                }
-                if (stack.size() == 0)
-                    parent = nullptr;
-            }
-            if (xml.name() == "PeakGroup") {
-                if (group) {
-                    group->minQuality =
-                        _mainwindow->mavenParameters->minQuality;
-                    group->groupStatistics();
-                }
-                group = nullptr;
-            }
-        }
-    }
-    for (auto group : groups) {
-        if (!group)
-            continue;
-        group->minQuality = _mainwindow->mavenParameters->minQuality;
-        group->groupStatistics();
-    }
-    return groups;
+    MzrollReader reader(_mainwindow->getSamples(),
+                        _mainwindow->mavenParameters,
+                        DB);
+    return reader.readGroups(fileName);
 }
 
 bool mzFileIO::isPeakListType(QString filename) {
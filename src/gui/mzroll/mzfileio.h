@@ -181,44 +181,11 @@ Q_OBJECT
         QString swapFilenameExtension(QString filename, QString ext);
 
         /**
-         * @brief For making old mzroll compatible, this will act as a flag
-         * whether loaded mzroll file is old or new one. this will be set by
-         * class method <markv_0_1_5mzroll>
+         * @brief Read the peak groups stored in an mzroll file, resolving
+         * their samples and compounds against those of the session.
+         * @param infile Path of the mzroll file.
+         * @return Top-level groups read from the file.
          */
-        bool mzrollv_0_1_5;
-
-        /**
-         * @brief Mark varible <mzrollv_0_1_5> true or false
-         * @details This method marks varible <mzrollv_0_1_5> true if loaded
-         * mzroll file is of v0.1.5 or older otherwise false based on one
-         * attribute <SamplesUsed> which is introduced here.
-         */
-        void markv_0_1_5mzroll(QString fileName);
-
-        /**
-         * @brief Modify name appropriate for xml attribute naming
-         * @details This method makes sample name appropriate for using in
-         * attribute naming in mzroll file It is just replacing '#' with '_' and
-         * adding 's' for letting sample name start with english letter In
-         * future, if sample name has some other special character, we have to
-         * replace those also with appropriate character Error can be seen at
-         * compilation time
-         */
-        void cleanString(QString& name);
-
-        /**
-         * @brief It will add samples used to group being generated while
-         * creating from mzroll file
-         * @details This method will add all sample to group being
-         * created from mzroll file. It will read SamplesUsed attribute of a
-         * group and if it's value is "Used", then assign this mzSample to that
-         * group
-         */
-        void readSamplesXML(QXmlStreamReader& xml,
-                            PeakGroup* group,
-                            float mzrollVersion);
-        PeakGroup* readGroupXML(QXmlStreamReader& xml, PeakGroup* parent);
-        void readPeakXML(QXmlStreamReader& xml, PeakGroup* parent);
         vector<PeakGroup*> readGroupsXML(QString infile);
 
     private Q_SLOTS:
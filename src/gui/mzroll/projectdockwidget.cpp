@@ -493,6 +493,21 @@ void ProjectDockWidget::unloadSelectedSamples() {
       QList<QTreeWidgetItem*>selected = _treeWidget->selectedItems();
       if(selected.size() == 0) return;
 
+      // peaks of the samples may still be in use by an ongoing clustering
+      QList< QPointer<TableDockWidget> > peaksTableList = _mainwindow->getPeakTableList();
+      peaksTableList.prepend(_mainwindow->getBookmarkedPeaks());
+      for (auto peaksTable : peaksTableList) {
+          if (peaksTable->isClustering()) {
+              QMessageBox::information(this,
+                                       "Clustering in progress",
+                                       "Samples cannot be removed while peak "
+                                       "groups are being clustered. Please "
+                                       "wait for clustering to finish or "
+                                       "cancel it.");
+              return;
+          }
+      }
+
      //reverse loop as size will decrease on deleting sample
      for (int index = selected.size() - 1; index >= 0; --index)
       {
@@ -914,6 +929,11 @@ void ProjectDockWidget::saveAndCloseCurrentSQLiteProject()
 
 void ProjectDockWidget::clearSession()
 {
+    QList< QPointer<TableDockWidget> > peaksTableList = _mainwindow->getPeakTableList();
+    peaksTableList.prepend(_mainwindow->getBookmarkedPeaks());
+    for (auto peaksTable : peaksTableList)
+        peaksTable->stopClustering();
+
     for (auto sample : _mainwindow->getSamples())
         unloadSample(sample);
     _mainwindow->removeAllPeakTables();
@@ -474,14 +474,15 @@ void SpectraWidget::setGroupTitle()
     if (_currentGroup.getCompound()) compoundName = QString(_currentGroup.getCompound()->name().c_str());
     
     float purity = 0;
-    if (_currentGroup.fragmentationPattern.mzValues.size()) {
-        purity = _currentGroup.fragmentationPattern.purity * 100;
+    const Fragment& pattern = _currentGroup.fragmentationPattern();
+    if (pattern.mzValues.size()) {
+        purity = pattern.purity * 100;
     }
 
     float rt = 0;
-    if (_currentGroup.fragmentationPattern.mzValues.size()) {
+    if (pattern.mzValues.size()) {
         //mean RT of all MS2 events in this group
-        rt = _currentGroup.fragmentationPattern.rt;
+        rt = pattern.rt;
     }
     else {
         //mean RT of the precursor group
@@ -115,50 +115,69 @@ bool SuggestPopup::eventFilter(QObject *obj, QEvent *ev)
 }
 
 void SuggestPopup::doSearchCompounds(QString needle) { 
+    string currentDb = _currentDatabase.toStdString();
+
+    // plain text is looked up in the database's search index, only actual
+    // regular expressions need to be matched against every compound; all
+    // matches are scored, since the index's own ranking knows nothing about
+    // search history or expected RTs
+    string query = needle.toStdString();
+    if (CompoundSearchIndex::isLiteralQuery(query)) {
+        int fields = CompoundSearchIndex::Name | CompoundSearchIndex::Id;
+        auto matches = DB.searchCompounds(query, currentDb, fields);
+        for (const auto& match : matches) {
+            scoreCompoundMatch(match.first,
+                               needle,
+                               match.second.position,
+                               match.second.length);
+        }
+        return;
+    }
+
     QRegExp regexp(needle,Qt::CaseInsensitive,QRegExp::RegExp);
     if (!needle.isEmpty() && !regexp.isValid()) return;
 
-
-    string currentDb = _currentDatabase.toStdString();
-	auto compoundsDB = DB.compoundsDB();
-    for(unsigned int i=0;  i < compoundsDB.size(); i++ ) {
-        Compound* c = compoundsDB[i];
+    for (auto c : DB.getCompoundsSubset(currentDb)) {
         QString name(c->name().c_str() );
-        QString formula(c->formula().c_str() );
         QString id(c->id().c_str() );
 
-        if ( name.length()==0) continue;
-
         //location of match
         int index = regexp.indexIn(name);
         if ( index < 0) index = regexp.indexIn(id);
         if ( index < 0) continue;
-        if ( c->db() != currentDb ) continue;
 
-       // qDebug() << "Compound: " << name << " " << currentDb.c_str() ;
+        scoreCompoundMatch(c, needle, index, regexp.matchedLength());
+    }
+}
+
+void SuggestPopup::scoreCompoundMatch(Compound* c,
+                                      QString needle,
+                                      int index,
+                                      int matchedLength) {
+        QString name(c->name().c_str() );
+        QString formula(c->formula().c_str() );
+
+        if ( name.length()==0) return;
 
         //score
         float c1=0;
         if ( searchHistory.contains(name)) c1 = searchHistory.value(name);
-        if ( c->db() == currentDb ) c1 += 10;
+        c1 += 10; // compound is from the current database
         if ( index == 0 ) c1 +=20;
         if ( formula == needle) c1 += 100;
 
         float c2=0;
-        c2 = regexp.matchedLength();
+        c2 = matchedLength;
 
         float c3=0;
         if ( c->expectedRt() > 0 ) c3=1;
 
         float score=1+c1+c2+c3;
 
-
-
         if ( !scores.contains(name) || scores[name] < score ) {
             scores[name]=score;
             compound_matches[name]=c;
         }
-    }
 }
 
 void SuggestPopup::doSearchHistory(QString needle)  {
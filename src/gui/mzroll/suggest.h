@@ -40,6 +40,10 @@ private:
 
 
 	void doSearchCompounds(QString needle);
+	void scoreCompoundMatch(Compound* c,
+	                        QString needle,
+	                        int index,
+	                        int matchedLength);
 	void doSearchHistory(QString needle);
 
 	QHash<QString,float> scores;
@@ -3,6 +3,7 @@
 #include <qtconcurrentrun.h>
 
 #include "alignmentdialog.h"
+#include "backgroundopsthread.h"
 #include "common/analytics.h"
 #include "clusterdialog.h"
 #include "Compound.h"
@@ -13,6 +14,7 @@
 #include "eicwidget.h"
 #include "globals.h"
 #include "groupClassifier.h"
+#include "groupClustering.h"
 #include "grouprtwidget.h"
 #include "groupsettingslog.h"
 #include "isotopeswidget.h"
@@ -100,12 +102,20 @@ TableDockWidget::TableDockWidget(MainWindow *mw) {
           &TableDockWidget::sortChildrenAscending);
 
   clusterDialog = new ClusterDialog(this);
+  _groupClustering = nullptr;
+  _isotopesThread = nullptr;
   connect(clusterDialog->clusterButton,
           SIGNAL(clicked(bool)),
           SLOT(clusterGroups()));
   connect(clusterDialog->clearButton,
           SIGNAL(clicked(bool)),
           SLOT(clearClusters()));
+  connect(clusterDialog->cancelButton,
+          SIGNAL(clicked(bool)),
+          SLOT(cancelClustering()));
+  connect(this,
+          SIGNAL(clusteringFinished(bool)),
+          SLOT(showClusteredGroups(bool)));
 
   connect(this,
           SIGNAL(updateProgressBar(QString, int, int, bool)),
@@ -116,6 +126,20 @@ TableDockWidget::TableDockWidget(MainWindow *mw) {
 }
 
 TableDockWidget::~TableDockWidget() {
+  if (_groupClustering != nullptr) {
+    _groupClustering->cancel();
+    _clusteringFuture.waitForFinished();
+    delete _groupClustering;
+  }
+
+  if (_isotopesThread != nullptr) {
+    disconnect(_isotopesThread, &BackgroundOpsThread::finished, nullptr, nullptr);
+    while (_isotopesThread->isRunning())
+      _isotopesThread->completeStop();
+    delete _isotopesThread->mavenParameters;
+    delete _isotopesThread;
+  }
+
   if (clusterDialog != NULL)
     delete clusterDialog;
 
@@ -256,9 +280,10 @@ void TableDockWidget::refreshParentItem(QTreeWidgetItem* item)
 }
 
 void TableDockWidget::updateTable() {
+  _scoreAllGroups();
   QTreeWidgetItemIterator it(treeWidget);
   while (*it) {
-    updateItem(*it);
+    updateItem(*it, true, false);
     ++it;
   }
   updateStatus();
@@ -289,7 +314,44 @@ void TableDockWidget::_paintClassificationDisagreement(QTreeWidgetItem *item)
     item->setBackground(0, brush);
 }
 
-void TableDockWidget::updateItem(QTreeWidgetItem *item, bool updateChildren) {
+void TableDockWidget::_scoreGroups(vector<PeakGroup*>& groups)
+{
+  vector<PeakGroup*> groupsWithPeaks;
+  for (auto group : groups) {
+    if (!group->isGhost() && group->peakCount() > 0)
+      groupsWithPeaks.push_back(group);
+  }
+  if (groupsWithPeaks.empty())
+    return;
+
+  //score group quality
+  groupClassifier* groupClsf = _mainwindow->getGroupClassifier();
+  if (groupClsf != NULL)
+    groupClsf->classify(groupsWithPeaks);
+
+  //get probability good/bad from svm
+  svmPredictor* groupPred = _mainwindow->getSVMPredictor();
+  if (groupPred != NULL)
+    groupPred->predict(groupsWithPeaks);
+}
+
+void TableDockWidget::_scoreAllGroups()
+{
+  vector<PeakGroup*> groups;
+  for (auto group : _topLevelGroups) {
+    groups.push_back(group.get());
+    for (auto child : group->childIsotopes())
+      groups.push_back(child.get());
+    for (auto child : group->childAdducts())
+      groups.push_back(child.get());
+  }
+  _scoreGroups(groups);
+}
+
+void TableDockWidget::updateItem(QTreeWidgetItem *item,
+                                 bool updateChildren,
+                                 bool scoreGroup)
+{
   shared_ptr<PeakGroup> group = groupForItem(item);
   if (group == nullptr)
     return;
@@ -303,7 +365,7 @@ void TableDockWidget::updateItem(QTreeWidgetItem *item, bool updateChildren) {
     item->setText(1, QString(group->getName().c_str()));
     if (updateChildren) {
       for (int i = 0; i < item->childCount(); ++i)
-        updateItem(item->child(i));
+        updateItem(item->child(i), true, scoreGroup);
     }
     return;
   }
@@ -311,16 +373,9 @@ void TableDockWidget::updateItem(QTreeWidgetItem *item, bool updateChildren) {
   //Find maximum number of peaks
   if (maxPeaks < group->peakCount()) maxPeaks = group->peakCount();
 
-  //score group quality
-  groupClassifier* groupClsf = _mainwindow->getGroupClassifier();
-  if (group->peakCount() > 0 && groupClsf != NULL) {
-      groupClsf->classify(group.get());
-  }
-
-  //get probability good/bad from svm
-  svmPredictor* groupPred = _mainwindow->getSVMPredictor();
-  if (group->peakCount() > 0 && groupPred != NULL) {
-      groupPred->predict(group.get());
+  if (scoreGroup) {
+    vector<PeakGroup*> groups = {group.get()};
+    _scoreGroups(groups);
   }
 
   // Updating the peakid
@@ -382,7 +437,7 @@ void TableDockWidget::updateItem(QTreeWidgetItem *item, bool updateChildren) {
 
   if (updateChildren) {
     for (int i = 0; i < item->childCount(); ++i)
-      updateItem(item->child(i));
+      updateItem(item->child(i), true, scoreGroup);
   }
 }
 
@@ -480,7 +535,9 @@ TableDockWidget::_rowDataForThisTable(size_t parentIndex,
     return rowData;
 }
 
-void TableDockWidget::addRow(RowData& indexData, QTreeWidgetItem* root)
+void TableDockWidget::addRow(RowData& indexData,
+                             QTreeWidgetItem* root,
+                             bool scoreGroups)
 {
   shared_ptr<PeakGroup> group = _topLevelGroups.at(indexData.parentIndex);
   if (root != nullptr) {
@@ -509,14 +566,14 @@ void TableDockWidget::addRow(RowData& indexData, QTreeWidgetItem* root)
   if (root == nullptr)
     treeWidget->addTopLevelItem(item);
 
-  updateItem(item, false);
+  updateItem(item, false, scoreGroups);
 
   if (group->childIsotopeCount() > 0) {
     for (size_t i = 0; i < group->childIsotopeCount(); ++i) {
       RowData rowData = _rowDataForThisTable(indexData.parentIndex,
                                              RowData::ChildType::Isotope,
                                              i);
-      addRow(rowData, item);
+      addRow(rowData, item, scoreGroups);
     }
   }
   if (group->childAdductsCount() > 0) {
@@ -524,7 +581,7 @@ void TableDockWidget::addRow(RowData& indexData, QTreeWidgetItem* root)
       RowData rowData = _rowDataForThisTable(indexData.parentIndex,
                                              RowData::ChildType::Adduct,
                                              i);
-      addRow(rowData, item);
+      addRow(rowData, item, scoreGroups);
     }
   }
 }
@@ -679,6 +736,8 @@ void TableDockWidget::showAllGroups() {
   if (viewType == groupView)
     setIntensityColName();
 
+  _scoreAllGroups();
+
   QMap<int, QTreeWidgetItem *> parents;
   for (size_t i = 0; i < _topLevelGroups.size(); ++i) {
     auto group = _topLevelGroups[i];
@@ -695,9 +754,9 @@ void TableDockWidget::showAllGroups() {
         parents[clusterId]->setExpanded(true);
       }
       QTreeWidgetItem *parent = parents[clusterId];
-      addRow(rowData, parent);
+      addRow(rowData, parent, false);
     } else {
-      addRow(rowData, nullptr);
+      addRow(rowData, nullptr, false);
     }
   }
 
@@ -856,9 +915,11 @@ void TableDockWidget::exportGroupsToSpreadsheet() {
   QList<shared_ptr<PeakGroup>> selectedGroups = getSelectedGroups();
   csvreports.setSelectionFlag(static_cast<int>(peakTableSelection));
 
+  vector<PeakGroup*> groups;
   for (auto group : selectedGroups) {
-    csvreports.addGroup(group.get());
+    groups.push_back(group.get());
   }
+  csvreports.addGroups(groups);
  
   if (csvreports.getErrorReport() != "") {
     QMessageBox msgBox(_mainwindow);
@@ -1925,6 +1986,12 @@ void TableDockWidget::contextMenuEvent(QContextMenuEvent *event) {
           this,
           &TableDockWidget::markDuplicatesAsBad);
 
+  QAction *z3 = menu.addAction("Pull isotopes for selected groups");
+  connect(z3,
+          &QAction::triggered,
+          this,
+          &TableDockWidget::pullIsotopesForSelectedGroups);
+
   QAction *z5 = menu.addAction("Delete all groups from this table");
   connect(z5, SIGNAL(triggered()), SLOT(deleteAll()));
 
@@ -1969,6 +2036,7 @@ void TableDockWidget::contextMenuEvent(QContextMenuEvent *event) {
   if (treeWidget->selectedItems().empty()) {
     // disable actions not relevant when nothing is selected
     z0->setEnabled(false);
+    z3->setEnabled(false);
   }
   if (treeWidget->selectedItems().size() != 1) {
     // disable actions not relevant to individual peak-groups
@@ -2051,96 +2119,149 @@ void TableDockWidget::clearClusters()
 
 void TableDockWidget::clusterGroups()
 {
-  sort(_topLevelGroups.begin(),
-       _topLevelGroups.end(),
-       [](shared_ptr<PeakGroup> a, shared_ptr<PeakGroup> b) {
-           return a->meanRt < b->meanRt;
-       });
-  qDebug() << "Clustering…";
-  int clusterId = 0;
+  if (_groupClustering != nullptr)
+    return;
 
   double maxRtDiff = clusterDialog->maxRtDiff_2->value();
   double minSampleCorrelation = clusterDialog->minSampleCorr->value();
   double minRtCorrelation = clusterDialog->minRt->value();
-  MassCutoff *massCutoff = _mainwindow->getUserMassCutoff();
+  MassCutoff massCutoff = *_mainwindow->getUserMassCutoff();
 
   vector<mzSample *> samples = _mainwindow->getSamples();
+  _groupClustering =
+      new GroupClustering(samples,
+                          massCutoff,
+                          _mainwindow->mavenParameters->eicType,
+                          _mainwindow->mavenParameters->filterline);
+  _groupClustering->boostSignal.connect(
+      [this](const string& text, unsigned int progress, int total) {
+        emit updateProgressBar(QString::fromStdString(text), progress, total);
+      });
 
-  // clear cluster information
-  for (auto group : _topLevelGroups)
-    group->clusterId = 0;
+  qDebug() << "Clustering…";
+  clusterDialog->clusterButton->setEnabled(false);
+  clusterDialog->clearButton->setEnabled(false);
+  clusterDialog->cancelButton->setEnabled(true);
+
+  // copies of the groups are clustered, so that the table can still be
+  // edited meanwhile; their cluster IDs are copied back once this is done
+  vector<shared_ptr<PeakGroup>> groups;
+  _clusteredGroups.clear();
+  for (auto group : _topLevelGroups) {
+    auto copy = make_shared<PeakGroup>(*group);
+    groups.push_back(copy);
+    _clusteredGroups.push_back(make_pair(group, copy));
+  }
+  _clusteringFuture = QtConcurrent::run(
+      this,
+      &TableDockWidget::_clusterGroupsInBackground,
+      groups,
+      maxRtDiff,
+      minSampleCorrelation,
+      minRtCorrelation);
+}
+
+void TableDockWidget::_clusterGroupsInBackground(
+    vector<shared_ptr<PeakGroup>> groups,
+    double maxRtDiff,
+    double minSampleCorrelation,
+    double minRtCorrelation)
+{
+  bool completed = _groupClustering->cluster(groups,
+                                             maxRtDiff,
+                                             minSampleCorrelation,
+                                             minRtCorrelation);
+  emit clusteringFinished(completed);
+}
 
-  map<int, shared_ptr<PeakGroup>> parentGroups;
-  for (int i = 0; i < _topLevelGroups.size(); ++i) {
-    auto group1 = _topLevelGroups[i];
-    if (group1->clusterId == 0) {
-      // create new cluster
-      group1->clusterId = ++clusterId;
-      parentGroups[clusterId] = group1;
-    }
+void TableDockWidget::cancelClustering()
+{
+  if (_groupClustering != nullptr)
+    _groupClustering->cancel();
+}
 
-    // cluster parent
-    shared_ptr<PeakGroup> parent = parentGroups[clusterId];
+void TableDockWidget::stopClustering()
+{
+  if (_groupClustering != nullptr) {
+    _groupClustering->cancel();
+    _clusteringFuture.waitForFinished();
+  }
+}
 
-    mzSample *largestSample = NULL;
-    double maxIntensity = 0;
+void TableDockWidget::showClusteredGroups(bool completed)
+{
+  _clusteringFuture.waitForFinished();
+  delete _groupClustering;
+  _groupClustering = nullptr;
+
+  for (auto& clustered : _clusteredGroups)
+    clustered.first->clusterId = clustered.second->clusterId;
+  _clusteredGroups.clear();
+
+  clusterDialog->clusterButton->setEnabled(true);
+  clusterDialog->clearButton->setEnabled(true);
+  clusterDialog->cancelButton->setEnabled(false);
+
+  // same order in which the groups were clustered
+  stable_sort(_topLevelGroups.begin(),
+              _topLevelGroups.end(),
+              [](shared_ptr<PeakGroup> a, shared_ptr<PeakGroup> b) {
+                  return a->meanRt < b->meanRt;
+              });
+  if (!completed) {
+    _mainwindow->setProgressBar("Clustering cancelled", 0, 0);
+  }
+  showAllGroups();
+}
 
-    for (int i = 0; i < group1->peakCount(); i++) {
-      mzSample *sample = group1->peaks[i].getSample();
-      if (group1->peaks[i].peakIntensity > maxIntensity)
-        largestSample = sample;
-    }
+void TableDockWidget::pullIsotopesForSelectedGroups()
+{
+  if (_isotopesThread != nullptr && _isotopesThread->isRunning())
+    return;
 
-    if (largestSample == NULL)
-      continue;
-    vector<float> peakIntensityA =
-        group1->getOrderedIntensityVector(samples, PeakGroup::AreaTop);
-
-    for (auto group2 : _topLevelGroups) {
-      if (group2->clusterId > 0)
-        continue;
-
-      // retention time distance
-        float rtdist = abs(parent->meanRt - group2->meanRt);
-      if (rtdist > maxRtDiff * 2)
-        continue;
-
-      // retention time overlap
-      float rtoverlap = mzUtils::checkOverlap(group1->minRt, group1->maxRt,
-                                              group2->minRt, group2->maxRt);
-      if (rtoverlap < 0.1)
-        continue;
-
-      // peak intensity correlation
-      vector<float> peakIntensityB =
-          group2->getOrderedIntensityVector(samples, PeakGroup::AreaTop);
-      float cor = correlation(peakIntensityA, peakIntensityB);
-      if (cor < minSampleCorrelation)
-        continue;
-
-      // peak shape correlation
-      float cor2 = largestSample->correlation(group1->meanMz,
-                                              group2->meanMz,
-                                              massCutoff,
-                                              group1->minRt,
-                                              group1->maxRt,
-                                              _mainwindow->mavenParameters->eicType,
-                                              _mainwindow->mavenParameters->filterline);
-      if (cor2 < minRtCorrelation)
-        continue;
-
-      // passed all the filters, group1 and group2 into a single metagroup
-      group2->clusterId = group1->clusterId;
-    }
-    if (i % 10 == 0)
-      _mainwindow->setProgressBar("Clustering…",
-                                  i + 1,
-                                  _topLevelGroups.size());
-  }
-
-  _mainwindow->setProgressBar("Clustering done!",
-                              _topLevelGroups.size(),
-                              _topLevelGroups.size());
+  _isotopeParents.clear();
+  for (auto group : getSelectedGroups()) {
+    if (group->parent == nullptr && group->hasCompoundLink())
+      _isotopeParents.push_back(group);
+  }
+  if (_isotopeParents.empty())
+    return;
+
+  if (_isotopesThread == nullptr) {
+    _isotopesThread = new BackgroundOpsThread(this);
+    _isotopesThread->setMainWindow(_mainwindow);
+    connect(_isotopesThread,
+            &BackgroundOpsThread::finished,
+            this,
+            &TableDockWidget::showPulledIsotopes);
+  }
+
+  if (_isotopesThread->mavenParameters != nullptr)
+    delete _isotopesThread->mavenParameters;
+
+  auto mp = new MavenParameters(*_mainwindow->mavenParameters);
+  mp->setSamples(_mainwindow->getVisibleSamples());
+  mp->compoundMassCutoffWindow = _mainwindow->getUserMassCutoff();
+  _isotopesThread->setMavenParameters(mp);
+  _isotopesThread->peakDetector->setMavenParameters(mp);
+
+  // copies of the groups are given isotopologues, so that the table can
+  // still be edited meanwhile
+  _isotopesThread->setParentGroups(_isotopeParents);
+  _isotopesThread->setRunFunction("pullIsotopesForGroup");
+  _isotopesThread->start();
+}
+
+void TableDockWidget::showPulledIsotopes()
+{
+  auto copies = _isotopesThread->parentGroups();
+  for (size_t i = 0; i < copies.size() && i < _isotopeParents.size(); ++i) {
+    auto& parent = _isotopeParents[i];
+    parent->deleteChildIsotopes();
+    for (auto child : copies[i]->childIsotopes())
+      parent->addIsotopeChild(*child);
+  }
+  _isotopeParents.clear();
   showAllGroups();
 }
 
@@ -1,13 +1,16 @@
 #ifndef TABLEDOCKWIDGET_H
 #define TABLEDOCKWIDGET_H
 
+#include <QFuture>
 #include <QWidgetAction>
 
 #include "pollyintegration.h"
 #include "stable.h"
 
+class BackgroundOpsThread;
 class MainWindow;
 class ClusterDialog;
+class GroupClustering;
 class PeakTableDeletionDialog;
 class NumericTreeWidgetItem;
 class ListView;
@@ -260,7 +263,9 @@ public slots:
   void pdfReadyNotification();
 
   void updateTable();
-  void updateItem(QTreeWidgetItem *item, bool updateChildren = true);
+  void updateItem(QTreeWidgetItem *item,
+                  bool updateChildren = true,
+                  bool scoreGroup = true);
   void updateStatus();
 
   //Group validation functions
@@ -280,8 +285,49 @@ public slots:
   virtual void deleteGroup(PeakGroup* group);
 
   bool deleteAll(bool askConfirmation = true);
+
+  /**
+   * @brief Cluster copies of the groups of this table in a worker thread,
+   * using the parameters set in the cluster dialog. The cluster IDs are
+   * copied back to the groups and the table is redrawn once this is done.
+   */
   void clusterGroups();
 
+  /**
+   * @brief Stop an ongoing clustering, leaving all groups unclustered.
+   */
+  void cancelClustering();
+
+  /**
+   * @brief Stop an ongoing clustering and wait for its worker thread to
+   * return, after which the samples it used may be unloaded.
+   */
+  void stopClustering();
+
+  /**
+   * @brief Whether groups of this table are currently being clustered.
+   */
+  bool isClustering() const { return _groupClustering != nullptr; }
+
+  /**
+   * @brief Bring the table up to date after clustering has finished.
+   * @param completed Whether clustering ran to completion.
+   */
+  void showClusteredGroups(bool completed);
+
+  /**
+   * @brief Pull isotopologues for copies of the selected parent groups in a
+   * worker thread, all together in a single batch. The children found replace
+   * those of the selected groups once this is done.
+   */
+  void pullIsotopesForSelectedGroups();
+
+  /**
+   * @brief Bring the table up to date after isotopologues have been pulled
+   * for the selected groups.
+   */
+  void showPulledIsotopes();
+
   void switchTableView();
 
   void setTableView(tableViewType t) { viewType = t; }
@@ -345,6 +391,7 @@ signals:
   void updateProgressBar(QString, int, int, bool = false);
   void UploadPeakBatch();
   void renderedPdf();
+  void clusteringFinished(bool);
   void ghostPeakGroupSelected(bool);
 
 private:
@@ -359,13 +406,50 @@ private:
 
   void _paintClassificationDisagreement(QTreeWidgetItem* item);
 
-  void addRow(RowData& indexData, QTreeWidgetItem *root);
+  /**
+   * @brief Compute group quality and SVM labels of the given groups, using
+   * the batch scoring methods of the classifiers.
+   * @param groups Groups to be scored. Ghost groups and groups without any
+   * peaks are skipped.
+   */
+  void _scoreGroups(vector<PeakGroup*>& groups);
+
+  /**
+   * @brief Score all groups in this table, including child isotopes and
+   * adducts, in a single batch.
+   */
+  void _scoreAllGroups();
+
+  void addRow(RowData& indexData,
+              QTreeWidgetItem *root,
+              bool scoreGroups = true);
   void heatmapBackground(QTreeWidgetItem *item);
 
   // TODO: investigate and remove this dialog if not being used
   void setupFiltersDialog();
 
   ClusterDialog *clusterDialog;
+  GroupClustering* _groupClustering;
+  QFuture<void> _clusteringFuture;
+
+  /**
+   * @brief Groups of the table being clustered, each paired with the copy
+   * that is clustered in their place.
+   */
+  vector<pair<shared_ptr<PeakGroup>, shared_ptr<PeakGroup>>> _clusteredGroups;
+
+  BackgroundOpsThread* _isotopesThread;
+
+  /**
+   * @brief Groups of the table whose isotopologues are being pulled, in the
+   * order of the copies held by `_isotopesThread`.
+   */
+  vector<shared_ptr<PeakGroup>> _isotopeParents;
+
+  void _clusterGroupsInBackground(vector<shared_ptr<PeakGroup>> groups,
+                                  double maxRtDiff,
+                                  double minSampleCorrelation,
+                                  double minRtCorrelation);
   peakTableSelectionType peakTableSelection;
   bool tableSelectionFlagUp;
   bool tableSelectionFlagDown;
@@ -1,9 +1,11 @@
 #include "connection.h"
 #include "cursor.h"
 
-Connection::Connection(const std::string& dbPath)
+Connection::Connection(const std::string& dbPath, const bool readOnly)
 {
-    int errCode = sqlite3_open(dbPath.c_str(), &_database);
+    int flags = readOnly ? SQLITE_OPEN_READONLY
+                         : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+    int errCode = sqlite3_open_v2(dbPath.c_str(), &_database, flags, nullptr);
     if (errCode) {
         std::cerr << "Cannot open database at location \""
                   << dbPath
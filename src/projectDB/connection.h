@@ -21,8 +21,11 @@ public:
     /**
      * @brief Construct a connection object for the given SQLite database.
      * @param dbPath Absolute path for SQLite database file as a string.
+     * @param readOnly Whether the database should be opened only for reading.
+     * Read-only connections can be used to query an existing database from
+     * threads other than the one using its main connection.
      */
-    Connection(const std::string& dbPath);
+    Connection(const std::string& dbPath, const bool readOnly = false);
 
     /**
      * @brief Close the connection to the database (if connected), destroy
@@ -4,6 +4,23 @@
 Cursor::Cursor(sqlite3_stmt* statement)
 {
     _statement = statement;
+    _hasRow = false;
+
+    // column indexing goes from 0 to (columnCount - 1), assigning in reverse
+    // so that the leftmost of any repeated names is kept
+    int columnCount = sqlite3_column_count(_statement);
+    while (columnCount) {
+        --columnCount;
+
+        auto param =
+            reinterpret_cast<const char*>(sqlite3_column_name(_statement,
+                                                              columnCount));
+        // if param was pointing to NULL
+        if (!param)
+            param = "";
+
+        _columns[param] = columnCount;
+    }
 }
 
 Cursor::~Cursor()
@@ -16,14 +33,15 @@ bool Cursor::execute()
 {
     int status = sqlite3_step(_statement);
     sqlite3_reset(_statement);
+    _hasRow = false;
     return status == SQLITE_DONE;
 }
 
 bool Cursor::next()
 {
     int status = sqlite3_step(_statement);
-    _extractValues();
-    return status == SQLITE_ROW;
+    _hasRow = status == SQLITE_ROW;
+    return _hasRow;
 }
 
 bool Cursor::bind(const std::string& param, int value)
@@ -62,18 +80,18 @@ bool Cursor::bind(const std::string& param, const std::string value)
 
 int Cursor::integerValue(const std::string& param)
 {
-    auto val = _currentResult[param];
-    if (val.empty())
+    auto val = _value(param);
+    if (*val == '\0')
         return 0;
     return std::stoi(val);
 }
 
 double Cursor::doubleValue(const std::string& param)
 {
-    auto val = _currentResult[param];
-    if (val.empty())
+    auto val = _value(param);
+    if (*val == '\0')
         return 0.0;
-    return std::stod(_currentResult[param]);
+    return std::stod(val);
 }
 
 float Cursor::floatValue(const std::string& param)
@@ -84,32 +102,21 @@ float Cursor::floatValue(const std::string& param)
 
 std::string Cursor::stringValue(const std::string& param)
 {
-    return _currentResult[param];
+    return _value(param);
 }
 
-void Cursor::_extractValues()
+const char* Cursor::_value(const std::string& param)
 {
-    _currentResult.clear();
-    int valueCount = sqlite3_data_count(_statement);
-
-    while (valueCount) {
-        // column indexing goes from 0 to (valueCount - 1), so decrement first
-        --valueCount;
-
-        auto param =
-            reinterpret_cast<const char*>(sqlite3_column_name(_statement,
-                                                              valueCount));
-        // if param was pointing to NULL
-        if (!param)
-            param = "";
-
-        auto value =
-            reinterpret_cast<const char*>(sqlite3_column_text(_statement,
-                                                              valueCount));
-        // if value was pointing to NULL
-        if (!value)
-            value = "";
-
-        _currentResult[param] = value;
-    }
+    auto column = _columns.find(param);
+    if (!_hasRow || column == _columns.end())
+        return "";
+
+    auto value =
+        reinterpret_cast<const char*>(sqlite3_column_text(_statement,
+                                                          column->second));
+    // if value was pointing to NULL
+    if (!value)
+        value = "";
+
+    return value;
 }
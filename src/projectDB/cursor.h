@@ -40,8 +40,8 @@ public:
      * @details While this method, like `execute` also uses the "step" SQLite
      * function, its semantically meant to be used for iterating over rows
      * returned from a suitable SQL operation (most commonly SELECT statements).
-     * Moreover, the `_extracValues` method is called to extract values stored
-     * in current row of the result set.
+     * Values of the current row remain available through the typed accessors
+     * until the next call.
      * @return True if the `next` method can be further called upon this Cursor.
      */
     bool next();
@@ -121,10 +121,17 @@ private:
     sqlite3_stmt* _statement;
 
     /**
-     * @brief A map storing values for the current result, in case the query
-     * is of a row returning type (i.e., "SELECT" statements).
+     * @brief Whether the statement currently points to a row of its result
+     * set, in case the query is of a row returning type (i.e., "SELECT"
+     * statements).
      */
-    std::map<std::string, std::string> _currentResult;
+    bool _hasRow;
+
+    /**
+     * @brief A map of column names to their indices in the result set. When
+     * names repeat, the leftmost column is used.
+     */
+    std::map<std::string, int> _columns;
 
     /**
      * @brief Constructor that can only be accessed by friend classes.
@@ -146,13 +153,19 @@ private:
     ~Cursor();
 
     /**
-     * @brief Extract values from the current iteration of result set and store
-     * it in `_currentResult` as a mapping of parameter names to their values
-     * as strings. These values are converted to the corresponding type when
-     * any of the `integerValue`, `doubleValue`, `floatValue` or `stringValue`
-     * methods are called.
+     * @brief Obtain the textual value of the given parameter in the current
+     * row of the result set. This value is converted to the corresponding type
+     * when any of the `integerValue`, `doubleValue`, `floatValue` or
+     * `stringValue` methods are called.
+     * @details The text is read directly from the statement instead of being
+     * copied for every column of every row, which makes iterating over large
+     * result sets considerably faster.
+     * @param param Name of parameter whose value is needed.
+     * @return Value as text, which is empty if there is no current row, no
+     * such parameter or if the value is NULL. It remains valid until the
+     * cursor moves to another row.
      */
-    void _extractValues();
+    const char* _value(const std::string& param);
 };
 
 #endif // CURSOR_H
@@ -1117,234 +1117,280 @@ ProjectDatabase::loadGroups(const vector<mzSample*>& loaded,
 {
     map<int, map<string, variant>> settings = loadGroupSettings();
 
-    _connection->prepare(CREATE_PEAKS_GROUP_INDEX)->execute();
-    auto groupsQuery = _connection->prepare("SELECT *         \
-                                               FROM peakgroups");
-
-    vector<PeakGroup*> groups;
-    map<int, PeakGroup*> databaseIdForGroups;
-    map<PeakGroup*, int> childParentMap;
-    while (groupsQuery->next()) {
-        PeakGroup* group = nullptr;
-
-        int databaseId = groupsQuery->integerValue("group_id");
-        auto integrationType = static_cast<PeakGroup::IntegrationType>(
-            groupsQuery->integerValue("integration_type"));
-        if (settings.count(databaseId)) {
-            auto mp = fromMaptoParameters(settings.at(databaseId),
-                                          globalParams);
-            group = new PeakGroup(make_shared<MavenParameters>(mp),
-                                  integrationType);
-        } else {
-            group = new PeakGroup(make_shared<MavenParameters>(*globalParams),
-                                  integrationType);
+    // groups refer to the first loaded sample having their sample's ID
+    unordered_map<int, mzSample*> samplesById;
+    for (auto sample : loaded)
+        samplesById.insert(make_pair(sample->getSampleId(), sample));
+
+    vector<PeakGroup*> allGroups;
+    vector<int> databaseIds;
+    vector<int> parentIds;
+    // peaks of all groups are read in one pass over their table, through a
+    // read-only connection of its own, while groups are read through the
+    // main connection
+    unordered_map<int, vector<Peak>> groupPeaks;
+    Connection peaksConnection(_connection->dbPath(), true);
+    bool concurrent = sqlite3_threadsafe() != 0
+                      && !peaksConnection.dbPath().empty();
+#pragma omp parallel sections if (concurrent)
+    {
+#pragma omp section
+        {
+            auto groupsQuery = _connection->prepare("SELECT *         \
+                                                       FROM peakgroups");
+            while (groupsQuery->next()) {
+                allGroups.push_back(_groupFromRow(groupsQuery,
+                                                  settings,
+                                                  globalParams,
+                                                  samplesById));
+                databaseIds.push_back(groupsQuery->integerValue("group_id"));
+                parentIds.push_back(
+                    groupsQuery->integerValue("parent_group_id"));
+            }
         }
-
-        group->setGroupId(groupsQuery->integerValue("table_group_id"));
-        int parentGroupId = groupsQuery->integerValue("parent_group_id");
-
-        group->groupRank = groupsQuery->floatValue("group_rank");
-        group->label = groupsQuery->stringValue("label")[0];
-        group->ms2EventCount = groupsQuery->integerValue("ms2_event_count");
-        group->fragMatchScore.mergedScore =
-            groupsQuery->doubleValue("ms2_score");
-        group->fragMatchScore.fractionMatched =
-            groupsQuery->doubleValue("fragmentation_fraction_matched");
-        group->fragMatchScore.mzFragError =
-            groupsQuery->doubleValue("fragmentation_mz_frag_error");
-        group->fragMatchScore.hypergeomScore =
-            groupsQuery->doubleValue("fragmentation_hypergeom_score");
-        group->fragMatchScore.mvhScore =
-            groupsQuery->doubleValue("fragmentation_mvh_score");
-        group->fragMatchScore.dotProduct =
-            groupsQuery->doubleValue("fragmentation_dot_product");
-        group->fragMatchScore.weightedDotProduct =
-            groupsQuery->doubleValue("fragmentation_weighted_dot_product");
-        group->fragMatchScore.spearmanRankCorrelation =
-            groupsQuery->doubleValue("fragmentation_spearman_rank_corr");
-        group->fragMatchScore.ticMatched =
-            groupsQuery->doubleValue("fragmentation_tic_matched");
-        group->fragMatchScore.numMatches =
-            groupsQuery->doubleValue("fragmentation_num_matches");
-
-        group->setType(static_cast<PeakGroup::GroupType>(groupsQuery->integerValue("type")));
-        group->setTableName(groupsQuery->stringValue("table_name"));
-        group->minQuality = groupsQuery->doubleValue("min_quality");
-
-        string compoundId = groupsQuery->stringValue("compound_id");
-        string compoundDB = groupsQuery->stringValue("compound_db");
-        string compoundName = groupsQuery->stringValue("compound_name");
-
-        string srmId = groupsQuery->stringValue("srm_id");
-        if (!srmId.empty())
-            group->setSrmId(srmId);
-
-        if (!compoundId.empty()) {
-            Compound* compound = _findSpeciesByIdAndName(compoundId,
-                                                         compoundName,
-                                                         compoundDB);
-            if (compound)
-                group->setCompound(compound);
-
-        } else if (!compoundName.empty() && !compoundDB.empty()) {
-            vector<Compound*> matches = _findSpeciesByName(compoundName,
-                                                           compoundDB);
-            if (matches.size() > 0)
-                group->setCompound(matches[0]);
+#pragma omp section
+        {
+            if (concurrent)
+                groupPeaks = _loadAllPeaks(&peaksConnection, loaded);
         }
-
-        vector<string> sample_ids;
-        sample_ids = mzUtils::split(groupsQuery->stringValue("sample_ids"), ";");
-        for (auto idString : sample_ids) {
-            if (idString.empty())
-                continue;
-
-            int sampleId = stoi(idString);
-            auto sampleIter = find_if(begin(loaded),
-                                      end(loaded),
-                                      [sampleId](mzSample* s) {
-                                          return sampleId == s->getSampleId();
-                                      });
-            if (sampleIter != end(loaded)) {
-                group->samples.push_back(*sampleIter);
-            }
+    }
+    if (!concurrent)
+        groupPeaks = _loadAllPeaks(_connection, loaded);
+
+    int numGroups = static_cast<int>(allGroups.size());
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < numGroups; ++i) {
+        auto peaks = groupPeaks.find(databaseIds[i]);
+        if (peaks != end(groupPeaks)) {
+            for (const auto& peak : peaks->second)
+                allGroups[i]->addPeak(peak);
         }
+        allGroups[i]->groupStatistics();
+    }
 
-        string adductName = groupsQuery->stringValue("adduct_name");
-        float sliceMzMin = groupsQuery->doubleValue("slice_mz_min");
-        float sliceMzMax = groupsQuery->doubleValue("slice_mz_max");
-        float sliceRtMin = groupsQuery->doubleValue("slice_rt_min");
-        float sliceRtMax = groupsQuery->doubleValue("slice_rt_max");
-        float sliceIonCount = groupsQuery->doubleValue("slice_ion_count");
-        mzSlice slice(sliceMzMin, sliceMzMax, sliceRtMin, sliceRtMax);
-        slice.ionCount = sliceIonCount;
-        slice.srmId = group->srmId;
-        slice.compound = group->getCompound();
-
-        // NOTE: the correct adduct pointer will have to be assigned later
-        if (!adductName.empty())
-            slice.adduct = new Adduct(adductName, 0, 0, 0.0f);
-
-        Isotope isotope;
-        isotope.name = groupsQuery->stringValue("tag_string");
-        isotope.mass = groupsQuery->floatValue("expected_mz");
-        isotope.abundance = groupsQuery->floatValue("expected_abundance");
-        isotope.C13 = groupsQuery->floatValue("isotope_c13_count");
-        isotope.N15 = groupsQuery->floatValue("isotope_n15_count");
-        isotope.S34 = groupsQuery->floatValue("isotope_s34_count");
-        isotope.H2 = groupsQuery->floatValue("isotope_h2_count");
-        if (!isotope.isNone())
-            slice.isotope = isotope;
-
-        group->setSlice(slice);
-
-        loadGroupPeaks(group, databaseId, loaded);
-        group->groupStatistics();
-
-        if (parentGroupId == 0) {
-            groups.push_back(group);
-        } else {
-            childParentMap[group] = parentGroupId;
-        }
-        databaseIdForGroups[databaseId] = group;
+    vector<PeakGroup*> groups;
+    unordered_map<int, PeakGroup*> databaseIdForGroups;
+    for (int i = 0; i < numGroups; ++i) {
+        if (parentIds[i] == 0)
+            groups.push_back(allGroups[i]);
+        databaseIdForGroups[databaseIds[i]] = allGroups[i];
     }
 
-    // assign parents for child groups
-    for (auto pair : childParentMap) {
-        bool foundParent = false;
-        auto child = pair.first;
-        for (auto idGroupPair : databaseIdForGroups) {
-            if (idGroupPair.first == pair.second) {
-                if (child->isIsotope()) {
-                    idGroupPair.second->addIsotopeChild(*child);
-                } else if (child->isAdduct()) {
-                    idGroupPair.second->addAdductChild(*child);
-                }
-                foundParent = true;
-                break;
-            }
-        }
+    // assign parents for child groups, in the order they were saved
+    for (int i = 0; i < numGroups; ++i) {
+        if (parentIds[i] == 0)
+            continue;
 
-        // failed to find a parent group, add standalone non-parent group
-        if (!foundParent)
+        auto child = allGroups[i];
+        auto parent = databaseIdForGroups.find(parentIds[i]);
+        if (parent != end(databaseIdForGroups)) {
+            if (child->isIsotope()) {
+                parent->second->addIsotopeChild(*child);
+            } else if (child->isAdduct()) {
+                parent->second->addAdductChild(*child);
+            }
+        } else {
+            // failed to find a parent group, add standalone non-parent group
             groups.push_back(child);
+        }
     }
 
     cerr << "Debug: Read in " << groups.size() << " groups" << endl;
     return groups;
 }
 
-void ProjectDatabase::loadGroupPeaks(PeakGroup* parentGroup,
-                                     int databaseId,
-                                     const vector<mzSample*>& loaded)
+PeakGroup* ProjectDatabase::_groupFromRow(
+    Cursor* groupsQuery,
+    const map<int, map<string, variant>>& settings,
+    const MavenParameters* globalParams,
+    const unordered_map<int, mzSample*>& samplesById)
 {
-    auto peaksQuery = _connection->prepare(
+    PeakGroup* group = nullptr;
+
+    int databaseId = groupsQuery->integerValue("group_id");
+    auto integrationType = static_cast<PeakGroup::IntegrationType>(
+        groupsQuery->integerValue("integration_type"));
+    if (settings.count(databaseId)) {
+        auto mp = fromMaptoParameters(settings.at(databaseId),
+                                      globalParams);
+        group = new PeakGroup(make_shared<MavenParameters>(mp),
+                              integrationType);
+    } else {
+        group = new PeakGroup(make_shared<MavenParameters>(*globalParams),
+                              integrationType);
+    }
+
+    group->setGroupId(groupsQuery->integerValue("table_group_id"));
+
+    group->groupRank = groupsQuery->floatValue("group_rank");
+    group->label = groupsQuery->stringValue("label")[0];
+    group->ms2EventCount = groupsQuery->integerValue("ms2_event_count");
+    group->fragMatchScore.mergedScore =
+        groupsQuery->doubleValue("ms2_score");
+    group->fragMatchScore.fractionMatched =
+        groupsQuery->doubleValue("fragmentation_fraction_matched");
+    group->fragMatchScore.mzFragError =
+        groupsQuery->doubleValue("fragmentation_mz_frag_error");
+    group->fragMatchScore.hypergeomScore =
+        groupsQuery->doubleValue("fragmentation_hypergeom_score");
+    group->fragMatchScore.mvhScore =
+        groupsQuery->doubleValue("fragmentation_mvh_score");
+    group->fragMatchScore.dotProduct =
+        groupsQuery->doubleValue("fragmentation_dot_product");
+    group->fragMatchScore.weightedDotProduct =
+        groupsQuery->doubleValue("fragmentation_weighted_dot_product");
+    group->fragMatchScore.spearmanRankCorrelation =
+        groupsQuery->doubleValue("fragmentation_spearman_rank_corr");
+    group->fragMatchScore.ticMatched =
+        groupsQuery->doubleValue("fragmentation_tic_matched");
+    group->fragMatchScore.numMatches =
+        groupsQuery->doubleValue("fragmentation_num_matches");
+
+    group->setType(static_cast<PeakGroup::GroupType>(groupsQuery->integerValue("type")));
+    group->setTableName(groupsQuery->stringValue("table_name"));
+    group->minQuality = groupsQuery->doubleValue("min_quality");
+
+    string compoundId = groupsQuery->stringValue("compound_id");
+    string compoundDB = groupsQuery->stringValue("compound_db");
+    string compoundName = groupsQuery->stringValue("compound_name");
+
+    string srmId = groupsQuery->stringValue("srm_id");
+    if (!srmId.empty())
+        group->setSrmId(srmId);
+
+    if (!compoundId.empty()) {
+        Compound* compound = _findSpeciesByIdAndName(compoundId,
+                                                     compoundName,
+                                                     compoundDB);
+        if (compound)
+            group->setCompound(compound);
+
+    } else if (!compoundName.empty() && !compoundDB.empty()) {
+        vector<Compound*> matches = _findSpeciesByName(compoundName,
+                                                       compoundDB);
+        if (matches.size() > 0)
+            group->setCompound(matches[0]);
+    }
+
+    vector<string> sample_ids;
+    sample_ids = mzUtils::split(groupsQuery->stringValue("sample_ids"), ";");
+    for (auto idString : sample_ids) {
+        if (idString.empty())
+            continue;
+
+        auto sample = samplesById.find(stoi(idString));
+        if (sample != end(samplesById))
+            group->samples.push_back(sample->second);
+    }
+
+    string adductName = groupsQuery->stringValue("adduct_name");
+    float sliceMzMin = groupsQuery->doubleValue("slice_mz_min");
+    float sliceMzMax = groupsQuery->doubleValue("slice_mz_max");
+    float sliceRtMin = groupsQuery->doubleValue("slice_rt_min");
+    float sliceRtMax = groupsQuery->doubleValue("slice_rt_max");
+    float sliceIonCount = groupsQuery->doubleValue("slice_ion_count");
+    mzSlice slice(sliceMzMin, sliceMzMax, sliceRtMin, sliceRtMax);
+    slice.ionCount = sliceIonCount;
+    slice.srmId = group->srmId;
+    slice.compound = group->getCompound();
+
+    // NOTE: the correct adduct pointer will have to be assigned later
+    if (!adductName.empty())
+        slice.adduct = new Adduct(adductName, 0, 0, 0.0f);
+
+    Isotope isotope;
+    isotope.name = groupsQuery->stringValue("tag_string");
+    isotope.mass = groupsQuery->floatValue("expected_mz");
+    isotope.abundance = groupsQuery->floatValue("expected_abundance");
+    isotope.C13 = groupsQuery->floatValue("isotope_c13_count");
+    isotope.N15 = groupsQuery->floatValue("isotope_n15_count");
+    isotope.S34 = groupsQuery->floatValue("isotope_s34_count");
+    isotope.H2 = groupsQuery->floatValue("isotope_h2_count");
+    if (!isotope.isNone())
+        slice.isotope = isotope;
+
+    group->setSlice(slice);
+
+    return group;
+}
+
+unordered_map<int, vector<Peak>>
+ProjectDatabase::_loadAllPeaks(Connection* connection,
+                               const vector<mzSample*>& loaded)
+{
+    // peaks refer to the first loaded sample having their sample's name
+    unordered_map<string, mzSample*> samplesByName;
+    for (auto sample : loaded)
+        samplesByName.insert(make_pair(sample->sampleName, sample));
+
+    auto peaksQuery = connection->prepare(
                 "SELECT peaks.*                             \
                       , samples.name AS sample_name         \
                    FROM peaks                               \
                       , samples                             \
                   WHERE peaks.sample_id = samples.sample_id \
-                    AND peaks.group_id = :parent_group_id   ");
-    peaksQuery->bind(":parent_group_id", databaseId);
+               ORDER BY peaks.peak_id                       ");
 
+    unordered_map<int, vector<Peak>> groupPeaks;
     while (peaksQuery->next()) {
-        Peak peak;
-        peak.pos = static_cast<unsigned int>(peaksQuery->integerValue("pos"));
-        peak.minpos =
-            static_cast<unsigned int>(peaksQuery->integerValue("minpos"));
-        peak.maxpos =
-            static_cast<unsigned int>(peaksQuery->integerValue("maxpos"));
-        peak.rt = peaksQuery->floatValue("rt");
-        peak.rtmin = peaksQuery->floatValue("rtmin");
-        peak.rtmax = peaksQuery->floatValue("rtmax");
-        peak.mzmin = peaksQuery->floatValue("mzmin");
-        peak.mzmax = peaksQuery->floatValue("mzmax");
-        peak.scan = static_cast<unsigned int>(peaksQuery->integerValue("scan"));
-        peak.minscan =
-            static_cast<unsigned int>(peaksQuery->integerValue("minscan"));
-        peak.maxscan =
-            static_cast<unsigned int>(peaksQuery->integerValue("maxscan"));
-        peak.peakArea = peaksQuery->floatValue("peak_area");
-        peak.peakSplineArea = peaksQuery->floatValue("peak_spline_area");
-        peak.peakAreaCorrected = peaksQuery->floatValue("peak_area_corrected");
-        peak.peakAreaTop = peaksQuery->floatValue("peak_area_top");
-        peak.peakAreaTopCorrected =
-            peaksQuery->floatValue("peak_area_top_corrected");
-        peak.peakAreaFractional =
-            peaksQuery->floatValue("peak_area_fractional");
-        peak.peakRank = peaksQuery->floatValue("peak_rank");
-        peak.peakIntensity = peaksQuery->floatValue("peak_intensity");
-        peak.peakBaseLineLevel = peaksQuery->floatValue("peak_baseline_level");
-        peak.peakMz = peaksQuery->floatValue("peak_mz");
-        peak.medianMz = peaksQuery->floatValue("median_mz");
-        peak.baseMz = peaksQuery->floatValue("base_mz");
-        peak.quality = peaksQuery->floatValue("quality");
-        peak.width =
-            static_cast<unsigned int>(peaksQuery->integerValue("width"));
-        peak.gaussFitSigma = peaksQuery->floatValue("gauss_fit_sigma");
-        peak.gaussFitR2 = peaksQuery->floatValue("gauss_fit_r2");
-        peak.noNoiseObs =
-            static_cast<unsigned int>(peaksQuery->integerValue("no_noise_obs"));
-        peak.noNoiseFraction = peaksQuery->floatValue("no_noise_fraction");
-        peak.symmetry = peaksQuery->floatValue("symmetry");
-        peak.signalBaselineRatio =
-            peaksQuery->floatValue("signal_baseline_ratio");
-        peak.groupOverlap = peaksQuery->floatValue("group_overlap");
-        peak.groupOverlapFrac = peaksQuery->floatValue("group_overlap_frac");
-        peak.localMaxFlag = peaksQuery->integerValue("local_max_flag");
-        peak.fromBlankSample = peaksQuery->integerValue("from_blank_sample");
-        peak.label = peaksQuery->stringValue("label")[0];
-
-        string sampleName = peaksQuery->stringValue("sample_name");
-
-        for (auto sample : loaded) {
-            if (sample->sampleName == sampleName) {
-                peak.setSample(sample);
-                break;
-            }
-        }
-        parentGroup->addPeak(peak);
+        Peak peak = _peakFromRow(peaksQuery);
+        auto sample = samplesByName.find(peaksQuery->stringValue("sample_name"));
+        if (sample != end(samplesByName))
+            peak.setSample(sample->second);
+        groupPeaks[peaksQuery->integerValue("group_id")].push_back(peak);
     }
+    return groupPeaks;
+}
+
+Peak ProjectDatabase::_peakFromRow(Cursor* peaksQuery)
+{
+    Peak peak;
+    peak.pos = static_cast<unsigned int>(peaksQuery->integerValue("pos"));
+    peak.minpos =
+        static_cast<unsigned int>(peaksQuery->integerValue("minpos"));
+    peak.maxpos =
+        static_cast<unsigned int>(peaksQuery->integerValue("maxpos"));
+    peak.rt = peaksQuery->floatValue("rt");
+    peak.rtmin = peaksQuery->floatValue("rtmin");
+    peak.rtmax = peaksQuery->floatValue("rtmax");
+    peak.mzmin = peaksQuery->floatValue("mzmin");
+    peak.mzmax = peaksQuery->floatValue("mzmax");
+    peak.scan = static_cast<unsigned int>(peaksQuery->integerValue("scan"));
+    peak.minscan =
+        static_cast<unsigned int>(peaksQuery->integerValue("minscan"));
+    peak.maxscan =
+        static_cast<unsigned int>(peaksQuery->integerValue("maxscan"));
+    peak.peakArea = peaksQuery->floatValue("peak_area");
+    peak.peakSplineArea = peaksQuery->floatValue("peak_spline_area");
+    peak.peakAreaCorrected = peaksQuery->floatValue("peak_area_corrected");
+    peak.peakAreaTop = peaksQuery->floatValue("peak_area_top");
+    peak.peakAreaTopCorrected =
+        peaksQuery->floatValue("peak_area_top_corrected");
+    peak.peakAreaFractional =
+        peaksQuery->floatValue("peak_area_fractional");
+    peak.peakRank = peaksQuery->floatValue("peak_rank");
+    peak.peakIntensity = peaksQuery->floatValue("peak_intensity");
+    peak.peakBaseLineLevel = peaksQuery->floatValue("peak_baseline_level");
+    peak.peakMz = peaksQuery->floatValue("peak_mz");
+    peak.medianMz = peaksQuery->floatValue("median_mz");
+    peak.baseMz = peaksQuery->floatValue("base_mz");
+    peak.quality = peaksQuery->floatValue("quality");
+    peak.width =
+        static_cast<unsigned int>(peaksQuery->integerValue("width"));
+    peak.gaussFitSigma = peaksQuery->floatValue("gauss_fit_sigma");
+    peak.gaussFitR2 = peaksQuery->floatValue("gauss_fit_r2");
+    peak.noNoiseObs =
+        static_cast<unsigned int>(peaksQuery->integerValue("no_noise_obs"));
+    peak.noNoiseFraction = peaksQuery->floatValue("no_noise_fraction");
+    peak.symmetry = peaksQuery->floatValue("symmetry");
+    peak.signalBaselineRatio =
+        peaksQuery->floatValue("signal_baseline_ratio");
+    peak.groupOverlap = peaksQuery->floatValue("group_overlap");
+    peak.groupOverlapFrac = peaksQuery->floatValue("group_overlap_frac");
+    peak.localMaxFlag = peaksQuery->integerValue("local_max_flag");
+    peak.fromBlankSample = peaksQuery->integerValue("from_blank_sample");
+    peak.label = peaksQuery->stringValue("label")[0];
+    return peak;
 }
 
 vector<Compound*> ProjectDatabase::loadCompounds(const string databaseName)
@@ -9,6 +9,7 @@
 #include <iostream>
 #include <map>
 #include <set>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -17,8 +18,10 @@
 class Adduct;
 class Compound;
 class Connection;
+class Cursor;
 class MavenParameters;
 class mzSample;
+class Peak;
 class PeakGroup;
 class Scan;
 class MavenParameters;
@@ -219,7 +222,9 @@ public:
      * @brief Load a PeakGroup object its peaks.
      * @details This method will also attempt to find the parent group of the
      * loaded group and try to associate with it. If not found, the group will
-     * be added as a top-level group itself.
+     * be added as a top-level group itself. Peaks of all groups are read in a
+     * single pass, through a read-only connection of their own, while the
+     * groups themselves are being read.
      * @param loaded A vector of loaded samples which will be associated with
      * peak groups and their peaks.
      * @param globalParams A pointer to the current global parameters object,
@@ -230,18 +235,6 @@ public:
     vector<PeakGroup*> loadGroups(const vector<mzSample*>& loaded,
                                   const MavenParameters* globalParams);
 
-    /**
-     * @brief Load peaks for a given peak group.
-     * @param group The PeakGroup for which peaks are to be loaded.
-     * @param databaseId The unique database ID for peak group whose peaks are
-     * to be loaded. This values is different from a group's local `groupId`.
-     * @param loaded A vector of loaded mzSample objects that will be iterated
-     * through to associate each peak with.
-     */
-    void loadGroupPeaks(PeakGroup* group,
-                        int databaseId,
-                        const vector<mzSample*>& loaded);
-
     /**
      * @brief Load saved compounds from the database file.
      * @details Each compound is checked whether it was previously loaded
@@ -546,6 +539,38 @@ private:
      * saved for peaks.
      */
     void _setSaveRawData(const string& filePath, const bool saveRawData);
+
+    /**
+     * @brief Create a peak group from the current row of a query over the
+     * peak groups table. The group will not have any peaks or parent yet.
+     * @param groupsQuery Cursor positioned at a row of the groups table.
+     * @param settings Parameters of groups, keyed by their database ID.
+     * @param globalParams Parameters for groups that have none saved.
+     * @param samplesById Loaded samples, keyed by their unique ID.
+     * @return A new PeakGroup object.
+     */
+    PeakGroup* _groupFromRow(Cursor* groupsQuery,
+                             const map<int, map<string, variant>>& settings,
+                             const MavenParameters* globalParams,
+                             const unordered_map<int, mzSample*>& samplesById);
+
+    /**
+     * @brief Load the peaks of all groups, in order of their database ID.
+     * @param connection Connection through which peaks will be queried.
+     * @param loaded A vector of loaded mzSample objects. Peaks of samples not
+     * present in it are still loaded, but are not assigned any sample.
+     * @return Peaks keyed by the database ID of the group they belong to.
+     */
+    unordered_map<int, vector<Peak>>
+    _loadAllPeaks(Connection* connection, const vector<mzSample*>& loaded);
+
+    /**
+     * @brief Create a peak from the current row of a query over the peaks
+     * table. The peak's sample has to be assigned by the caller.
+     * @param peaksQuery Cursor positioned at a row of the peaks table.
+     * @return The loaded Peak object.
+     */
+    Peak _peakFromRow(Cursor* peaksQuery);
 };
 
 #endif // PROJECTDATABASE_H
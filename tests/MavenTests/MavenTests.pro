@@ -74,6 +74,9 @@ HEADERS += \
     testCharge.h \
     testSRMList.h \
     testGroupFiltering.h \
+    testProjectDatabase.h \
+    testCompareSamples.h \
+    testMzrollReader.h \
     $$top_srcdir/src/cli/peakdetector/peakdetectorcli.h \
     $$top_srcdir/src/core/libmaven/classifier.h \
     $$top_srcdir/src/core/libmaven/classifierNeuralNet.h \
@@ -96,6 +99,9 @@ SOURCES += \
     testCharge.cpp \
     testSRMList.cpp \
     testGroupFiltering.cpp \
+    testProjectDatabase.cpp \
+    testCompareSamples.cpp \
+    testMzrollReader.cpp \
     main.cpp \
     $$top_srcdir/src/cli/peakdetector/peakdetectorcli.cpp  \
     $$top_srcdir/src/cli/peakdetector/options.cpp \
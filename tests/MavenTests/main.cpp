@@ -14,6 +14,9 @@
 #include "testCLI.h"
 #include "testCharge.h"
 #include "testSRMList.h"
+#include "testProjectDatabase.h"
+#include "testCompareSamples.h"
+#include "testMzrollReader.h"
 
 int readLog(QString);
 
@@ -101,6 +104,24 @@ int main(int argc, char** argv) {
     result|=readLog("testMzAligner.xml");
     mzUtils::stopTimer(timer, "testMzAligner");
 
+    timer = mzUtils::startTimer();
+    if (freopen("testProjectDatabase.xml", "w", stdout))
+        result |= QTest::qExec(new TestProjectDatabase, argc, argv);
+    result|=readLog("testProjectDatabase.xml");
+    mzUtils::stopTimer(timer, "testProjectDatabase");
+
+    timer = mzUtils::startTimer();
+    if (freopen("testCompareSamples.xml", "w", stdout))
+        result |= QTest::qExec(new TestCompareSamples, argc, argv);
+    result|=readLog("testCompareSamples.xml");
+    mzUtils::stopTimer(timer, "testCompareSamples");
+
+    timer = mzUtils::startTimer();
+    if (freopen("testMzrollReader.xml", "w", stdout))
+        result |= QTest::qExec(new TestMzrollReader, argc, argv);
+    result|=readLog("testMzrollReader.xml");
+    mzUtils::stopTimer(timer, "testMzrollReader");
+
     return result;
 }
 
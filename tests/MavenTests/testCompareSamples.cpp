@@ -0,0 +1,143 @@
+#include <omp.h>
+
+#include "testCompareSamples.h"
+#include "utilities.h"
+#include "comparesampleslogic.h"
+#include "mavenparameters.h"
+#include "mzSample.h"
+#include "mzUtils.h"
+#include "PeakGroup.h"
+
+TestCompareSamples::TestCompareSamples() {
+
+}
+
+void TestCompareSamples::initTestCase() {
+    // every fourth group differs between the two sets of samples, the rest
+    // only vary by a few percent
+    for (int s = 0; s < 12; ++s) {
+        auto sample = new mzSample();
+        sample->sampleName = "sample" + to_string(s);
+        if (s < 6) {
+            sset1.push_back(sample);
+        } else {
+            sset2.push_back(sample);
+        }
+    }
+
+    auto mp = make_shared<MavenParameters>();
+    for (int g = 0; g < 5000; ++g) {
+        auto group = make_shared<PeakGroup>(
+            mp,
+            PeakGroup::IntegrationType::Automated);
+        for (int s = 0; s < 12; ++s) {
+            Peak peak;
+            peak.setSample(s < 6 ? sset1[s] : sset2[s - 6]);
+            float level = (g % 4 == 0 && s >= 6) ? 1000.0f : 10000.0f;
+            peak.peakAreaTopCorrected = level * (1 + 0.01f * ((g + s) % 7));
+            group->addPeak(peak);
+        }
+        groups.push_back(group);
+    }
+}
+
+void TestCompareSamples::cleanupTestCase() {
+    groups.clear();
+    for (auto sample : sset1)
+        delete sample;
+    for (auto sample : sset2)
+        delete sample;
+}
+
+void TestCompareSamples::init() {
+    // This function is executed before each test
+}
+
+void TestCompareSamples::cleanup() {
+    // This function is executed after each test
+}
+
+void TestCompareSamples::testCompareGroupsFoldChange() {
+    CompareSamplesLogic compareLogic;
+    compareLogic.compareGroups(groups, sset1, sset2, 1.0f, 0);
+    QVERIFY(compareLogic.rand_scores.size() == groups.size() * 10);
+
+    for (int g = 0; g < 8; ++g) {
+        auto group = groups[g];
+        float meanA = 0;
+        float meanB = 0;
+        for (int s = 0; s < 6; ++s) {
+            meanA += group->peaks[s].peakAreaTopCorrected / 6;
+            meanB += group->peaks[s + 6].peakAreaTopCorrected / 6;
+        }
+        float foldChange = log2(meanA / meanB);
+        QVERIFY(abs(group->changeFoldRatio - foldChange) < 1e-4);
+        QVERIFY(group->changePValue >= 0 && group->changePValue <= 1);
+        if (g % 4 == 0) {
+            QVERIFY(group->changeFoldRatio > 3.0f);
+            QVERIFY(group->changePValue < groups[g + 1]->changePValue);
+        }
+    }
+}
+
+void TestCompareSamples::testCompareGroupsDeterministic() {
+    // results depend only on the seed, not on the number of threads used
+    auto compare = [&](unsigned int seed, int numThreads) {
+        int maxThreads = omp_get_max_threads();
+        omp_set_num_threads(numThreads);
+        CompareSamplesLogic compareLogic;
+        compareLogic.compareGroups(groups, sset1, sset2, 1.0f, 0, seed, 20);
+        omp_set_num_threads(maxThreads);
+
+        vector<float> pValues;
+        for (auto group : groups)
+            pValues.push_back(group->changePValue);
+        return pValues;
+    };
+    auto pValues = compare(7, 1);
+    QVERIFY(compare(7, 4) == pValues);
+    QVERIFY(compare(7, 1) == pValues);
+    QVERIFY(compare(8, 4) != pValues);
+}
+
+void TestCompareSamples::testTScore() {
+    // scores derived from moments agree with `mzUtils::ttest`, including
+    // groups whose intensities are all equal in one of the sets
+    vector<vector<float>> groupA = {{1.0f, 1.0f, 1.0f}};
+    vector<vector<float>> groupB = {{2.0f, 5.0f, 3.0f, 4.0f}};
+    for (int g = 0; g < 12; ++g) {
+        vector<float> intensities = groups[g]->getOrderedIntensityVector(
+            PeakGroup::sampleOrderTable(sset1),
+            sset1.size(),
+            PeakGroup::AreaTop);
+        groupA.push_back(intensities);
+        intensities = groups[g]->getOrderedIntensityVector(
+            PeakGroup::sampleOrderTable(sset2),
+            sset2.size(),
+            PeakGroup::AreaTop);
+        groupB.push_back(intensities);
+    }
+    groupA.push_back({1000.0f});
+    groupB.push_back({10.0f, 20.0f, 15.0f});
+
+    for (size_t g = 0; g < groupA.size(); ++g) {
+        StatisticsVector<float> a;
+        StatisticsVector<float> b;
+        a.assign(begin(groupA[g]), end(groupA[g]));
+        b.assign(begin(groupB[g]), end(groupB[g]));
+        float expected = abs(mzUtils::ttest(a, b));
+        float score = CompareSamplesLogic::tScore(groupA[g], groupB[g]);
+        QVERIFY(abs(score - expected) <= 1e-4 * expected + 1e-4);
+    }
+}
+
+void TestCompareSamples::benchmarkCompareGroups() {
+    if (!TestUtils::benchmarksEnabled())
+        QSKIP("Set MAVEN_BENCHMARKS to run benchmarks");
+
+    CompareSamplesLogic compareLogic;
+    QBENCHMARK {
+        compareLogic.compareGroups(groups, sset1, sset2, 1.0f, 3, 0, 100);
+    }
+    QVERIFY(compareLogic.rand_scores.size() == groups.size() * 100);
+}
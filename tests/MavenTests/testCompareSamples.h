@@ -0,0 +1,39 @@
+#ifndef TESTCOMPARESAMPLES_H
+#define TESTCOMPARESAMPLES_H
+#include <iostream>
+#include <memory>
+#include <QtTest>
+#include <string>
+#include <sstream>
+
+class mzSample;
+class PeakGroup;
+
+class TestCompareSamples : public QObject {
+    Q_OBJECT
+
+    public:
+        TestCompareSamples();
+    private:
+        std::vector<mzSample*> sset1;
+        std::vector<mzSample*> sset2;
+        QList<std::shared_ptr<PeakGroup>> groups;
+
+    private Q_SLOTS:
+        // functions executed by QtTest before and after test suite
+        void initTestCase();
+        void cleanupTestCase();
+
+        // functions executed by QtTest before and after each test
+        void init();
+        void cleanup();
+
+        // test functions - all functions prefixed with "test" will be ran as tests
+        // this is automatically detected thanks to Qt's meta-information about QObjects
+        void testCompareGroupsFoldChange();
+        void testCompareGroupsDeterministic();
+        void testTScore();
+        void benchmarkCompareGroups();
+};
+
+#endif // TESTCOMPARESAMPLES_H
@@ -1,3 +1,7 @@
+#include <numeric>
+#include <random>
+#include <omp.h>
+
 #include "testEIC.h"
 #include "datastructures/mzSlice.h"
 #include "EIC.h"
@@ -6,6 +10,7 @@
 #include "mzMassCalculator.h"
 #include "mzSample.h"
 #include "PeakGroup.h"
+#include "Scan.h"
 #include "peakdetector.h"
 #include "utilities.h"
 
@@ -62,6 +67,49 @@ void TestEIC::testgetEICms2() {
     QVERIFY(e3->maxIntensity == 2500);
 }
 
+void TestEIC::testgetEICms2Indexed() {
+    mzSample* mzsample = maventests::samples.ms2TestSamples[1];
+
+    // a sample sharing the same scans, but without an index over them
+    mzSample unindexed;
+    unindexed.scans = mzsample->scans;
+    unindexed.srmScans = mzsample->srmScans;
+
+    set<float> precursorMzs;
+    set<float> productMzs;
+    for (auto scan : mzsample->scans) {
+        if (scan->mslevel != 2)
+            continue;
+        precursorMzs.insert(scan->precursorMz);
+        productMzs.insert(begin(scan->mz), end(scan->mz));
+    }
+    precursorMzs.insert(0.0f);
+    QVERIFY(precursorMzs.size() > 1);
+
+    string filterline = mzsample->srmScans.begin()->first;
+    for (auto precursorMz : precursorMzs) {
+        for (auto productMz : productMzs) {
+            for (auto amu : {0.5f, 2.0f}) {
+                for (auto line : {string(""), filterline}) {
+                    EIC* e1 = mzsample->getEIC(precursorMz, 0, productMz,
+                                               EIC::MAX, line, amu, amu);
+                    EIC* e2 = unindexed.getEIC(precursorMz, 0, productMz,
+                                               EIC::MAX, line, amu, amu);
+                    QVERIFY(e1->scannum == e2->scannum);
+                    QVERIFY(e1->rt == e2->rt);
+                    QVERIFY(e1->intensity == e2->intensity);
+                    QVERIFY(e1->mz == e2->mz);
+                    delete e1;
+                    delete e2;
+                }
+            }
+        }
+    }
+
+    // scans are owned by the loaded sample
+    unindexed.scans.clear();
+}
+
 void TestEIC::testcomputeSpline()
 {
     EIC* e = maventests::samples.ms1TestSamples[0]->getEIC(402.9929f,
@@ -397,3 +445,226 @@ void TestEIC:: testeicMerge() {
     QVERIFY(17.039 < m->rtmax < 17.040);
 }
 
+// EICs of many samples, with sorted retention times spread over a few minutes
+// and a share of them smoothed
+vector<EIC*> _syntheticEICs(int numEICs)
+{
+    mt19937 generator(numEICs);
+    uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    vector<EIC*> eics;
+    for (int i = 0; i < numEICs; i++) {
+        EIC* eic = new EIC();
+        unsigned int length = 50 + generator() % 400;
+        float rt = uniform(generator) * 0.5f;
+        float rtStep = 0.002f + uniform(generator) * 0.01f;
+        for (unsigned int j = 0; j < length; j++) {
+            eic->rt.push_back(rt + j * rtStep);
+            eic->intensity.push_back(uniform(generator) < 0.2f
+                                         ? 0.0f
+                                         : uniform(generator) * 1e5f);
+            eic->mz.push_back(uniform(generator) < 0.1f
+                                  ? 0.0f
+                                  : 300.0f + uniform(generator) * 0.01f);
+            eic->scannum.push_back(j);
+        }
+        eic->rtmin = eic->rt.front();
+        eic->rtmax = eic->rt.back();
+        if (i % 3 == 0) {
+            eic->spline = new float[length];
+            for (unsigned int j = 0; j < length; j++)
+                eic->spline[j] = uniform(generator) < 0.3f
+                                     ? 0.0f
+                                     : uniform(generator) * 1e5f;
+        }
+        eics.push_back(eic);
+    }
+    return eics;
+}
+
+// merged EIC built serially, summing every point into its bin, as
+// `EIC::eicMerge` did before it merged ranges of bins in parallel
+EIC* _baselineEicMerge(const vector<EIC*>& eics,
+                       const vector<float>& weights = {})
+{
+    EIC* m = new EIC();
+    unsigned int maxlen = 0;
+    float minRt = DBL_MAX;
+    float maxRt = DBL_MIN;
+    for (auto eic : eics) {
+        maxlen = max(maxlen, eic->size());
+        minRt = min(minRt, eic->rtmin);
+        maxRt = max(maxRt, eic->rtmax);
+    }
+    m->rtmin = minRt;
+    m->rtmax = maxRt;
+    m->intensity.assign(maxlen, 0.0f);
+    m->mz.assign(maxlen, 0.0f);
+    vector<int> mzcount(maxlen, 0);
+    for (size_t i = 0; i < eics.size(); i++) {
+        EIC* eic = eics[i];
+        for (unsigned int j = 0; j < eic->size(); j++) {
+            unsigned int bin = ((eic->rt[j] - minRt) / (maxRt - minRt) * maxlen);
+            if (bin >= maxlen)
+                bin = maxlen - 1;
+            float value = eic->spline && eic->spline[j] > 0 ? eic->spline[j]
+                                                            : eic->intensity[j];
+            m->intensity[bin] += weights.empty() ? value : weights[i] * value;
+            if (eic->mz[j] > 0) {
+                m->mz[bin] += eic->mz[j];
+                mzcount[bin]++;
+            }
+        }
+    }
+
+    float totalWeight = eics.size();
+    if (!weights.empty())
+        totalWeight = accumulate(weights.begin(), weights.end(), 0.0f);
+    for (unsigned int i = 0; i < maxlen; i++) {
+        m->intensity[i] /= totalWeight;
+        if (mzcount[i])
+            m->mz[i] /= mzcount[i];
+    }
+    return m;
+}
+
+void TestEIC::testeicMergeSynthetic() {
+    vector<EIC*> eics = _syntheticEICs(40);
+    EIC* m = EIC::eicMerge(eics);
+    EIC* baseline = _baselineEicMerge(eics);
+
+    QVERIFY(m->size() == baseline->size());
+    QVERIFY(m->rtmin == baseline->rtmin);
+    QVERIFY(m->rtmax == baseline->rtmax);
+    for (unsigned int i = 0; i < m->size(); i++) {
+        QCOMPARE(m->intensity[i], baseline->intensity[i]);
+        QCOMPARE(m->mz[i], baseline->mz[i]);
+    }
+
+    delete baseline;
+    delete m;
+    for (auto eic : eics)
+        delete eic;
+}
+
+void TestEIC::testeicMergeWeighted() {
+    vector<EIC*> eics = _syntheticEICs(40);
+    vector<float> weights;
+    for (size_t i = 0; i < eics.size(); i++)
+        weights.push_back(0.5f + i % 4);
+    EIC* m = EIC::eicMerge(eics, weights);
+    EIC* baseline = _baselineEicMerge(eics, weights);
+
+    QVERIFY(m->size() == baseline->size());
+    for (unsigned int i = 0; i < m->size(); i++) {
+        QCOMPARE(m->intensity[i], baseline->intensity[i]);
+        QCOMPARE(m->mz[i], baseline->mz[i]);
+    }
+
+    // equal weights give the plain average
+    EIC* unweighted = EIC::eicMerge(eics);
+    EIC* equal = EIC::eicMerge(eics, vector<float>(eics.size(), 2.0f));
+    for (unsigned int i = 0; i < m->size(); i++)
+        QCOMPARE(equal->intensity[i], unweighted->intensity[i]);
+
+    delete equal;
+    delete unweighted;
+    delete baseline;
+    delete m;
+    for (auto eic : eics)
+        delete eic;
+}
+
+void TestEIC::testeicMergeParallel() {
+    // enough points for the merge to be split into ranges of bins, with one
+    // EIC whose retention times are not sorted
+    vector<EIC*> eics = _syntheticEICs(600);
+    reverse(eics[1]->rt.begin(), eics[1]->rt.end());
+    size_t numPoints = 0;
+    for (auto eic : eics)
+        numPoints += eic->size();
+    QVERIFY(numPoints > 100000);
+
+    int maxThreads = omp_get_max_threads();
+    omp_set_num_threads(1);
+    EIC* serial = EIC::eicMerge(eics);
+    omp_set_num_threads(4);
+    EIC* parallel = EIC::eicMerge(eics);
+    omp_set_num_threads(maxThreads);
+
+    QVERIFY(parallel->size() == serial->size());
+    for (unsigned int i = 0; i < serial->size(); i++) {
+        QVERIFY(parallel->rt[i] == serial->rt[i]);
+        QVERIFY(parallel->intensity[i] == serial->intensity[i]);
+        QVERIFY(parallel->mz[i] == serial->mz[i]);
+    }
+    QVERIFY(parallel->maxIntensity == serial->maxIntensity);
+    QVERIFY(parallel->totalIntensity == serial->totalIntensity);
+
+    delete parallel;
+    delete serial;
+    for (auto eic : eics)
+        delete eic;
+}
+
+void TestEIC::testComputeAvgBlankArea() {
+    mzSample blank;
+    blank.isBlank = true;
+    EIC eic;
+    eic.sample = &blank;
+    for (int i = 0; i < 100; ++i) {
+        eic.rt.push_back(0.1f * i);
+        eic.intensity.push_back(i % 7 == 0 ? 0.0f : 100.0f + i);
+    }
+
+    // points within a quarter minute of the group's peaks count
+    float sum = 0;
+    int count = 0;
+    for (int i = 0; i < 100; ++i) {
+        if (eic.rt[i] >= 1.75f && eic.rt[i] <= 3.25f && eic.intensity[i] > 0) {
+            sum += eic.intensity[i];
+            ++count;
+        }
+    }
+
+    auto mp = make_shared<MavenParameters>();
+    PeakGroup group(mp, PeakGroup::IntegrationType::Automated);
+    Peak peak;
+    peak.rtmin = 2.0f;
+    peak.rtmax = 3.0f;
+    group.addPeak(peak);
+    group.computeAvgBlankArea({&eic});
+    QVERIFY(count > 0);
+    QVERIFY(TestUtils::floatCompare(group.blankMean, sum / count));
+
+    // retention times need not be sorted, as after alignment
+    reverse(eic.rt.begin(), eic.rt.end());
+    reverse(eic.intensity.begin(), eic.intensity.end());
+    group.blankMean = 0;
+    group.computeAvgBlankArea({&eic});
+    QVERIFY(TestUtils::floatCompare(group.blankMean, sum / count));
+}
+
+void TestEIC::benchmarkeicMerge() {
+    if (!TestUtils::benchmarksEnabled())
+        QSKIP("Set MAVEN_BENCHMARKS to run benchmarks");
+
+    vector<EIC*> eics = _syntheticEICs(600);
+    QBENCHMARK {
+        delete EIC::eicMerge(eics);
+    }
+    for (auto eic : eics)
+        delete eic;
+}
+
+void TestEIC::benchmarkeicMergeBaseline() {
+    if (!TestUtils::benchmarksEnabled())
+        QSKIP("Set MAVEN_BENCHMARKS to run benchmarks");
+
+    // same EICs as `benchmarkeicMerge`, merged serially
+    vector<EIC*> eics = _syntheticEICs(600);
+    QBENCHMARK {
+        delete _baselineEicMerge(eics);
+    }
+    for (auto eic : eics)
+        delete eic;
+}
@@ -25,6 +25,7 @@ class TestEIC : public QObject {
         // this is automatically detected thanks to Qt's meta-information about QObjects
         void testgetEIC();
         void testgetEICms2();
+        void testgetEICms2Indexed();
         void testcomputeSpline();
         void testgetPeakPositions();
         void testcomputeBaselineThreshold();
@@ -35,6 +36,12 @@ class TestEIC : public QObject {
         void testGetPeakDetails();
         void testgroupPeaks();
         void testeicMerge();
+        void testeicMergeSynthetic();
+        void testeicMergeWeighted();
+        void testeicMergeParallel();
+        void testComputeAvgBlankArea();
+        void benchmarkeicMerge();
+        void benchmarkeicMergeBaseline();
 };
 
 #endif // TESTEIC_H
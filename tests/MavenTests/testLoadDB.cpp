@@ -1,3 +1,5 @@
+#include <random>
+
 #include "testLoadDB.h"
 #include "Compound.h"
 #include "database.h"
@@ -174,6 +176,174 @@ void TestLoadDB::testloadCompoundCSVFileWithRep() {
         QVERIFY(numberofCompounds == 7);
 }
 
+void TestLoadDB::benchmarkLoadNISTLibrary() {
+    if (!TestUtils::benchmarksEnabled())
+        QSKIP("Set MAVEN_BENCHMARKS to run benchmarks");
+
+    // build a large library by repeating the records of a small one under
+    // different names
+    ifstream input("tests/test-libmaven/test_NISTLibrary.msp");
+    QVERIFY(input.is_open());
+    vector<string> lines;
+    string line;
+    while (getline(input, line))
+        lines.push_back(line);
+
+    string libraryPath = QDir::tempPath().toStdString()
+                         + "/benchmark_NISTLibrary.msp";
+    ofstream library(libraryPath);
+    for (int copy = 0; copy < 10000; ++copy) {
+        for (const auto& line : lines) {
+            library << line;
+            if (line.compare(0, 6, "Name: ") == 0)
+                library << " #" << copy;
+            library << "\n";
+        }
+    }
+    library.close();
+
+    int numberofCompounds = 0;
+    QBENCHMARK {
+        Database database;
+        numberofCompounds = database.loadNISTLibrary(libraryPath);
+    }
+    QVERIFY(numberofCompounds == 100000);
+    remove(libraryPath.c_str());
+}
+
+void TestLoadDB::benchmarkFindSpecies() {
+    if (!TestUtils::benchmarksEnabled())
+        QSKIP("Set MAVEN_BENCHMARKS to run benchmarks");
+
+    // 100k compounds spread over a few databases
+    Database database;
+    vector<string> dbNames = {"db0", "db1", "db2", "db3"};
+    for (int i = 0; i < 100000; ++i) {
+        database.addCompound(new Compound("ID" + to_string(i),
+                                          "compound" + to_string(i),
+                                          "C6H12O6",
+                                          1,
+                                          -1,
+                                          0,
+                                          dbNames[i % dbNames.size()]));
+    }
+    QVERIFY(database.compoundsDB().size() == 100000);
+
+    mt19937 random(42);
+    vector<int> queries;
+    for (int i = 0; i < 2000; ++i)
+        queries.push_back(random() % 100000);
+
+    size_t numMatches = 0;
+    QBENCHMARK {
+        numMatches = 0;
+        for (int i : queries) {
+            const string& dbName = dbNames[i % dbNames.size()];
+            numMatches += database.findSpeciesById("ID" + to_string(i),
+                                                   dbName).size();
+            numMatches += database.findSpeciesByName("compound" + to_string(i),
+                                                     dbName).size();
+        }
+    }
+    QVERIFY(numMatches == 2 * queries.size());
+
+    for (const auto& dbName : dbNames)
+        database.removeDatabase(dbName);
+}
+
+void TestLoadDB::testSearchCompounds() {
+    Database database;
+    database.loadCompoundCSVFile("bin/methods/qe3_v11_2016_04_29.csv");
+    string dbName = "qe3_v11_2016_04_29";
+    vector<Compound*> compounds = database.getCompoundsSubset(dbName);
+    QVERIFY(compounds.size() > 0);
+
+    QVERIFY(CompoundSearchIndex::isLiteralQuery("glucose"));
+    QVERIFY(CompoundSearchIndex::isLiteralQuery("glu.*6-phosphate"));
+    QVERIFY(!CompoundSearchIndex::isLiteralQuery("^glu"));
+    QVERIFY(!CompoundSearchIndex::isLiteralQuery("glu.se"));
+    QVERIFY(!CompoundSearchIndex::isLiteralQuery("\xc3\x9f-alanine"));
+
+    // indexed searches must find the same compounds, at the same positions,
+    // as regular expressions do
+    vector<string> queries = {"coa",
+                              "CoA",
+                              "nad",
+                              "nadp",
+                              "hmdb014",
+                              "c21h",
+                              "acet.*coa",
+                              "yl-.*a",
+                              "no such compound"};
+    for (const auto& query : queries) {
+        QRegExp regexp(QString::fromStdString(query), Qt::CaseInsensitive);
+        map<Compound*, int> expected;
+        for (auto compound : compounds) {
+            QStringList fields;
+            fields << compound->name().c_str() << compound->id().c_str()
+                   << compound->formula().c_str();
+            for (const auto& category : compound->category())
+                fields << category.c_str();
+            for (const auto& field : fields) {
+                int index = regexp.indexIn(field);
+                if (index >= 0) {
+                    expected[compound] = index;
+                    break;
+                }
+            }
+        }
+
+        auto matches = database.searchCompounds(query, dbName);
+        QVERIFY(matches.size() == expected.size());
+        for (const auto& match : matches) {
+            QVERIFY(expected.count(match.first) > 0);
+            QVERIFY(static_cast<int>(match.second.position)
+                    == expected[match.first]);
+        }
+
+        // top matches are the first ones of a complete search
+        auto topMatches = database.searchCompounds(query, dbName,
+                                                   CompoundSearchIndex::AllFields,
+                                                   3);
+        QVERIFY(topMatches.size() == min<size_t>(3, matches.size()));
+        for (size_t i = 0; i < topMatches.size(); ++i)
+            QVERIFY(topMatches[i].first == matches[i].first);
+    }
+}
+
+void TestLoadDB::benchmarkSearchCompounds() {
+    if (!TestUtils::benchmarksEnabled())
+        QSKIP("Set MAVEN_BENCHMARKS to run benchmarks");
+
+    // synthetic library of a million entries, made of random words
+    mt19937 random(42);
+    uniform_int_distribution<int> letter(0, 25);
+    auto word = [&]() {
+        string text(4 + random() % 8, 'a');
+        for (auto& c : text)
+            c = 'a' + letter(random);
+        return text;
+    };
+    CompoundSearchIndex index;
+    for (int i = 0; i < 1000000; ++i) {
+        index.addEntry(word() + "-" + word() + " " + word(),
+                       "ID" + to_string(i),
+                       "C" + to_string(random() % 40) + "H"
+                           + to_string(random() % 80),
+                       {"class" + to_string(random() % 50)});
+    }
+    index.search("warm up");
+
+    size_t numMatches = 0;
+    QBENCHMARK {
+        numMatches = 0;
+        for (string query : {"a", "ab", "abc", "abcd", "abc.*def", "id12345"})
+            numMatches += index.search(query, CompoundSearchIndex::AllFields,
+                                       100).size();
+    }
+    QVERIFY(numMatches > 0);
+}
+
 /* void TestLoadDB::testloadCompoundCSVFileWithRepNoId() {
         int numberofCompounds = maventests::database.loadCompoundCSVFile("bin/methods/compoundlist_rep_with_noId.csv");
         QVERIFY(numberofCompounds == 7);
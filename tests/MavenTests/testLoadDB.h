@@ -30,6 +30,10 @@ class TestLoadDB : public QObject {
         void testExtractCompoundfromEachLineWithCompoundField();
         void testloadCompoundCSVFileWithIssues();
         void testloadCompoundCSVFileWithRep();
+        void benchmarkLoadNISTLibrary();
+        void benchmarkFindSpecies();
+        void testSearchCompounds();
+        void benchmarkSearchCompounds();
         //void testloadCompoundCSVFileWithRepNoId();
 };
 
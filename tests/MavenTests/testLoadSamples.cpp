@@ -1,6 +1,10 @@
+#include <QElapsedTimer>
+
 #include "testLoadSamples.h"
+#include "EIC.h"
 #include "mavenparameters.h"
 #include "mzSample.h"
+#include "PeakGroup.h"
 #include "Scan.h"
 #include "utilities.h"
 
@@ -142,6 +146,62 @@ void TestLoadSamples:: testBlankSample() {
     QVERIFY(!mzsample.isBlank);
 }
 
+void TestLoadSamples::testSampleIndexes() {
+    vector<mzSample*> samples;
+    for (int i = 0; i < 3; ++i)
+        samples.push_back(new mzSample());
+
+    // the index of a deleted sample is free to be taken by a new one, which
+    // never shares its index with a live sample
+    unsigned int freedIndex = samples[1]->getSampleIndex();
+    delete samples[1];
+    samples[1] = new mzSample();
+    QVERIFY(samples[1]->getSampleIndex() <= freedIndex);
+    QVERIFY(samples[1]->getSampleIndex() != samples[0]->getSampleIndex());
+    QVERIFY(samples[1]->getSampleIndex() != samples[2]->getSampleIndex());
+    QVERIFY(samples[0]->getSampleIndex() != samples[2]->getSampleIndex());
+
+    for (auto sample : samples)
+        delete sample;
+}
+
+void TestLoadSamples::testGetPeak() {
+    vector<mzSample*> samples;
+    for (int i = 0; i < 4; ++i)
+        samples.push_back(new mzSample());
+
+    auto mp = make_shared<MavenParameters>();
+    PeakGroup group(mp, PeakGroup::IntegrationType::Automated);
+    for (int i = 0; i < 3; ++i) {
+        Peak peak;
+        peak.setSample(samples[i]);
+        group.addPeak(peak);
+    }
+    for (int i = 0; i < 3; ++i)
+        QVERIFY(group.getPeak(samples[i])->getSample() == samples[i]);
+    QVERIFY(group.getPeak(samples[3]) == nullptr);
+
+    // a peak added after the peaks were erased from directly is found, even
+    // though the number of peaks is the same as when they were last indexed
+    group.peaks.erase(group.peaks.begin());
+    Peak peak;
+    peak.setSample(samples[3]);
+    group.addPeak(peak);
+    QVERIFY(group.getPeak(samples[0]) == nullptr);
+    QVERIFY(group.getPeak(samples[3]) != nullptr);
+    QVERIFY(group.getPeak(samples[3])->getSample() == samples[3]);
+
+    // as is a peak assigned in-place
+    peak.setSample(samples[0]);
+    group.peaks[0] = peak;
+    QVERIFY(group.getPeak(samples[0]) != nullptr);
+    QVERIFY(group.getPeak(samples[0])->getSample() == samples[0]);
+    QVERIFY(group.getPeak(samples[1]) == nullptr);
+
+    for (auto sample : samples)
+        delete sample;
+}
+
 void TestLoadSamples::testParseMzMLInjectionTimeStamp() {
 
     // Different format of time stamps
@@ -194,3 +254,218 @@ void TestLoadSamples::testParseMzMLInjectionTimeStamp() {
     }
 
 }
+
+void TestLoadSamples::testIntensitySummaries() {
+    mzSample mzsample;
+    mzsample.loadSample(loadFile);
+    int mslevel = mzsample.scans[0]->mslevel;
+
+    // chromatograms and intensities as found by going over every peak
+    vector<float> rts, tics, bics, bicMzs, intensities;
+    for (auto scan : mzsample.scans) {
+        if (scan->mslevel != mslevel)
+            continue;
+        float maxMz = 0;
+        float maxIntensity = 0;
+        for (unsigned int i = 0; i < scan->intensity.size(); i++) {
+            if (scan->intensity[i] > maxIntensity) {
+                maxIntensity = scan->intensity[i];
+                maxMz = scan->mz[i];
+            }
+            intensities.push_back(scan->intensity[i]);
+        }
+        rts.push_back(scan->rt);
+        tics.push_back(scan->totalIntensity());
+        bics.push_back(maxIntensity);
+        bicMzs.push_back(maxMz);
+    }
+
+    EIC* tic = mzsample.getTIC(0, 0, mslevel);
+    QVERIFY(tic->rt == rts);
+    QVERIFY(tic->intensity == tics);
+    QVERIFY(tic->maxIntensity == *max_element(tics.begin(), tics.end()));
+    delete tic;
+
+    EIC* bic = mzsample.getBIC(0, 0, mslevel);
+    QVERIFY(bic->rt == rts);
+    QVERIFY(bic->intensity == bics);
+    QVERIFY(bic->mz == bicMzs);
+    delete bic;
+
+    vector<float> expected = mzUtils::quantileDistribution(intensities);
+    vector<float> estimated = mzsample.getIntensityDistribution(mslevel);
+    QVERIFY(estimated.size() == expected.size());
+    for (unsigned int i = 0; i < expected.size(); i++)
+        QVERIFY(abs(estimated[i] - expected[i]) <= 0.004 * abs(expected[i]));
+
+    // retention times are always those of the scans
+    for (auto scan : mzsample.scans)
+        scan->rt *= 2;
+    tic = mzsample.getTIC(0, 0, mslevel);
+    QVERIFY(tic->rt.size() == rts.size());
+    for (unsigned int i = 0; i < rts.size(); i++)
+        QVERIFY(tic->rt[i] == rts[i] * 2);
+    delete tic;
+
+    // summaries follow scans that are added afterwards
+    Scan* scan = new Scan(&mzsample, 0, mslevel, 1000.0f, 0.0f, 1);
+    scan->mz = {100.0f, 200.0f};
+    scan->intensity = {5.0f, 3.0f};
+    mzsample.addScan(scan);
+    bic = mzsample.getBIC(0, 0, mslevel);
+    QVERIFY(bic->intensity.size() == bics.size() + 1);
+    QVERIFY(bic->intensity.back() == 5.0f);
+    QVERIFY(bic->mz.back() == 100.0f);
+    delete bic;
+}
+
+void TestLoadSamples::testAverageScan() {
+    mzSample mzsample;
+    mzsample.loadSample(loadFile);
+    int mslevel = mzsample.scans[0]->mslevel;
+    int polarity = mzsample.scans[0]->getPolarity();
+    float midRt = mzsample.minRt + (mzsample.maxRt - mzsample.minRt) / 2;
+
+    for (float resolution : {100.0f, 10000.0f}) {
+        for (float rtWindow : {0.1f, mzsample.maxRt}) {
+            float rtmin = midRt - rtWindow;
+            float rtmax = midRt + rtWindow;
+
+            // points of all scans in the window, averaged per m/z bin
+            map<float, double> intensities;
+            map<float, double> weightedMzs;
+            map<float, int> counts;
+            for (auto scan : mzsample.scans) {
+                if (scan->getPolarity() != polarity
+                    || scan->mslevel != mslevel
+                    || scan->rt < rtmin
+                    || scan->rt > rtmax)
+                    continue;
+                for (unsigned int i = 0; i < scan->mz.size(); i++) {
+                    float bin = FLOATROUND(scan->mz[i], resolution);
+                    intensities[bin] += scan->intensity[i];
+                    weightedMzs[bin] += scan->intensity[i] * scan->mz[i];
+                    counts[bin]++;
+                }
+            }
+
+            Scan* avgScan = mzsample.getAverageScan(rtmin,
+                                                    rtmax,
+                                                    mslevel,
+                                                    polarity,
+                                                    resolution);
+            QVERIFY(avgScan->mz.size() == intensities.size());
+            QVERIFY(avgScan->intensity.size() == intensities.size());
+            unsigned int i = 0;
+            for (auto& bin : intensities) {
+                if (bin.second == 0) {
+                    i++;
+                    continue;
+                }
+                float mz = weightedMzs[bin.first] / bin.second;
+                float intensity = bin.second / counts[bin.first];
+                QVERIFY(TestUtils::floatCompare(avgScan->mz[i], mz));
+                QVERIFY(abs(avgScan->intensity[i] - intensity)
+                        <= 1e-5 * intensity);
+                i++;
+            }
+            delete avgScan;
+        }
+    }
+}
+
+void TestLoadSamples::benchmarkAverageScan() {
+    if (!TestUtils::benchmarksEnabled())
+        QSKIP("Set MAVEN_BENCHMARKS to run benchmarks");
+
+    mzSample mzsample;
+    mzsample.loadSample(loadFile);
+    int mslevel = mzsample.scans[0]->mslevel;
+    int polarity = mzsample.scans[0]->getPolarity();
+
+    size_t numScans = 0;
+    size_t numPoints = 0;
+    for (auto scan : mzsample.scans) {
+        if (scan->mslevel == mslevel && scan->getPolarity() == polarity) {
+            numScans++;
+            numPoints += scan->mz.size();
+        }
+    }
+
+    // every scan of the sample is averaged in each iteration, the throughput
+    // being reported over all iterations
+    size_t numAveraged = 0;
+    int iterations = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QBENCHMARK {
+        Scan* avgScan = mzsample.getAverageScan(mzsample.minRt,
+                                                mzsample.maxRt,
+                                                mslevel,
+                                                polarity,
+                                                10000.0f);
+        numAveraged = avgScan->mz.size();
+        delete avgScan;
+        iterations++;
+    }
+    double seconds = max(timer.nsecsElapsed() / 1e9, 1e-9);
+    qDebug() << "averaged" << iterations * numScans / seconds << "scans/s,"
+             << iterations * numPoints / seconds << "points/s";
+    QVERIFY(numAveraged > 0);
+    QVERIFY(numAveraged <= numPoints);
+}
+
+void TestLoadSamples::testMzCSVRoundTrip() {
+    string csvPath = QDir::tempPath().toStdString() + "/roundtrip.mzCSV";
+    mzSample mzxmlSample;
+    mzxmlSample.loadSample(loadFile);
+    vector<mzSample*> samples = {&mzxmlSample,
+                                 maventests::samples.ms2TestSamples[0]};
+    for (auto sample : samples) {
+        sample->writeMzCSV(csvPath.c_str());
+        mzSample csvSample;
+        csvSample.parseMzCSV(csvPath.c_str());
+
+        // values are written with enough digits to be read back exactly,
+        // except for retention times that are stored in minutes
+        QVERIFY(csvSample.scans.size() == sample->scans.size());
+        for (unsigned int i = 0; i < sample->scans.size(); i++) {
+            Scan* scan = sample->scans[i];
+            Scan* csvScan = csvSample.scans[i];
+            QVERIFY(csvScan->mz == scan->mz);
+            QVERIFY(csvScan->intensity == scan->intensity);
+            QVERIFY(csvScan->mslevel == scan->mslevel);
+            QVERIFY(csvScan->precursorMz == scan->precursorMz);
+            QVERIFY(csvScan->getPolarity() == scan->getPolarity());
+            QVERIFY(csvScan->filterLine == scan->filterLine);
+            QVERIFY(abs(csvScan->rt - scan->rt) <= 1e-6 * scan->rt);
+        }
+    }
+    remove(csvPath.c_str());
+}
+
+void TestLoadSamples::benchmarkMzCSV() {
+    if (!TestUtils::benchmarksEnabled())
+        QSKIP("Set MAVEN_BENCHMARKS to run benchmarks");
+
+    mzSample mzsample;
+    mzsample.loadSample(loadFile);
+    size_t numPoints = 0;
+    for (auto scan : mzsample.scans)
+        numPoints += scan->nobs();
+
+    // a sample is written out and read back in each iteration
+    string csvPath = QDir::tempPath().toStdString() + "/benchmark.mzCSV";
+    size_t numParsed = 0;
+    QBENCHMARK {
+        mzsample.writeMzCSV(csvPath.c_str());
+        mzSample csvSample;
+        csvSample.parseMzCSV(csvPath.c_str());
+        numParsed = 0;
+        for (auto scan : csvSample.scans)
+            numParsed += scan->nobs();
+    }
+    QVERIFY(numParsed == numPoints);
+    QVERIFY(QFileInfo(QString::fromStdString(csvPath)).size() > 0);
+    remove(csvPath.c_str());
+}
@@ -35,7 +35,14 @@ class TestLoadSamples : public QObject {
         void testSampleName();
 #endif
         void testBlankSample();
+        void testSampleIndexes();
+        void testGetPeak();
         void testParseMzMLInjectionTimeStamp();
+        void testIntensitySummaries();
+        void testAverageScan();
+        void benchmarkAverageScan();
+        void testMzCSVRoundTrip();
+        void benchmarkMzCSV();
 };
 
 #endif // TESTLOADSAMPLES_H
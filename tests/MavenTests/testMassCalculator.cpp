@@ -1,8 +1,10 @@
 #include "testMassCalculator.h"
 #include "database.h"
 #include "datastructures/isotope.h"
+#include "masscutofftype.h"
 #include "mzMassCalculator.h"
 #include "mzSample.h"
+#include "mzUtils.h"
 #include "utilities.h"
 
 TestMassCalculator::TestMassCalculator() {
@@ -137,9 +139,91 @@ void TestMassCalculator::testComputeIsotopes() {
 }
 
 void TestMassCalculator::testenumerateMasses() {
-    //TODO: have to add a test case for ennumurate mass
-    // MassCalculator masCal;
-    // masCal.enumerateMasses()
+    MassCutoff massCutoff;
+    massCutoff.setMassCutoffAndType(5, "ppm");
+
+    // glucose, [M+H]+
+    double mz = MassCalculator::computeMass("C6H12O6", 1);
+    auto matches = MassCalculator::enumerateMasses(mz, 1, &massCutoff);
+    QVERIFY(!matches.empty());
+
+    bool foundGlucose = false;
+    for (size_t i = 0; i < matches.size(); ++i) {
+        QVERIFY(matches[i].diff < massCutoff.getMassCutoff());
+        QVERIFY(matches[i].compoundLink == nullptr);
+        if (i > 0)
+            QVERIFY(matches[i - 1].diff <= matches[i].diff);
+        if (matches[i].name == "C6H12O6")
+            foundGlucose = true;
+    }
+    QVERIFY(foundGlucose);
+
+    // the legacy interface should report the same formulae
+    MassCalculator massCalc;
+    vector<MassCalculator::Match*> legacyMatches;
+    massCalc.enumerateMasses(mz, 1, &massCutoff, legacyMatches);
+    QVERIFY(legacyMatches.size() == matches.size());
+    for (size_t i = 0; i < matches.size(); ++i)
+        QVERIFY(legacyMatches[i]->name == matches[i].name);
+    mzUtils::delete_all(legacyMatches);
+}
+
+void TestMassCalculator::testRepeatedFormulas() {
+    // parsed formulas are cached, results must not change on later lookups
+    string formula = "C6H12O6";
+    map<string, int> composition = MassCalculator::getComposition(formula);
+    double neutralMass = MassCalculator::computeNeutralMass(formula);
+    vector<Isotope> isotopes =
+        MassCalculator::computeIsotopes(formula, 1, true, true, true, true);
+    for (int i = 0; i < 3; i++) {
+        QVERIFY(MassCalculator::getComposition(formula) == composition);
+        QVERIFY(MassCalculator::computeNeutralMass(formula) == neutralMass);
+
+        auto repeated =
+            MassCalculator::computeIsotopes(formula, 1, true, true, true, true);
+        QVERIFY(repeated.size() == isotopes.size());
+        for (size_t j = 0; j < isotopes.size(); j++) {
+            QVERIFY(repeated[j].name == isotopes[j].name);
+            QVERIFY(repeated[j].mass == isotopes[j].mass);
+            QVERIFY(repeated[j].abundance == isotopes[j].abundance);
+        }
+    }
+
+    // formulas differing in a single count must not share cached results
+    QVERIFY(MassCalculator::computeNeutralMass("C6H12O5") < neutralMass);
+    QVERIFY(MassCalculator::getComposition("C6H12O5")["O"] == 5);
+}
 
-    QVERIFY(true);
+void TestMassCalculator::benchmarkFormulaMasses() {
+    if (!TestUtils::benchmarksEnabled())
+        QSKIP("Set MAVEN_BENCHMARKS to run benchmarks");
+
+    vector<string> formulas;
+    for (int c = 1; c <= 50; c++) {
+        for (int h = 0; h < 100; h++) {
+            for (int n = 0; n < 10; n++) {
+                formulas.push_back("C" + to_string(c)
+                                   + "H" + to_string(h)
+                                   + "N" + to_string(n)
+                                   + "O" + to_string(c % 7)
+                                   + "S");
+            }
+        }
+    }
+
+    double totalMass = 0.0;
+    size_t totalIsotopes = 0;
+    QBENCHMARK {
+        for (const auto& formula : formulas) {
+            totalMass += MassCalculator::computeMass(formula, 1);
+            totalIsotopes += MassCalculator::computeIsotopes(formula,
+                                                             1,
+                                                             true,
+                                                             true,
+                                                             true,
+                                                             false).size();
+        }
+    }
+    QVERIFY(totalMass > 0.0);
+    QVERIFY(totalIsotopes > formulas.size());
 }
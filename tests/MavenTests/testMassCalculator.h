@@ -28,6 +28,8 @@ class TestMassCalculator : public QObject {
         void testComputeMass();
         void testComputeIsotopes();
         void testenumerateMasses();
+        void testRepeatedFormulas();
+        void benchmarkFormulaMasses();
 };
 
 #endif // TESTMASSCALCULATOR_H
@@ -1,3 +1,5 @@
+#include <omp.h>
+
 #include "testMzAligner.h"
 #include "classifierNeuralNet.h"
 #include "masscutofftype.h"
@@ -6,6 +8,7 @@
 #include "mzSample.h"
 #include "obiwarp.h"
 #include "peakdetector.h"
+#include "PolyAligner.h"
 #include "PeakGroup.h"
 #include "Scan.h"
 #include "utilities.h"
@@ -102,3 +105,101 @@ void TestMzAligner::testSaveFit(){
     QVERIFY(aligner.fit.size());
 
 }
+
+// retention times of a sample drifting smoothly from the reference ones,
+// with every tenth point being an outlier
+void _driftingRts(StatisticsVector<float>& subj, StatisticsVector<float>& ref)
+{
+    for (int i = 0; i < 2000; i++) {
+        float rt = 1.0f + 20.0f * i / 2000;
+        float drift = 0.3f * sin(rt / 5) + 0.01f * ((i * 7919) % 11 - 5);
+        if (i % 10 == 0)
+            drift += 1.5f;
+        ref.push_back(rt);
+        subj.push_back(rt + drift);
+    }
+}
+
+void TestMzAligner::testOptimalPolynomialSeed()
+{
+    StatisticsVector<float> subj;
+    StatisticsVector<float> ref;
+    _driftingRts(subj, ref);
+    PolyAligner polyAligner(subj, ref);
+
+    auto optimalPolynomial = [&](unsigned int seed, int numThreads) {
+        int maxThreads = omp_get_max_threads();
+        omp_set_num_threads(numThreads);
+        AlignmentStats* stats = polyAligner.optimalPolynomial(1, 5, 40, seed);
+        omp_set_num_threads(maxThreads);
+
+        vector<double> coefficients = stats->getCoeffients();
+        delete stats;
+        return coefficients;
+    };
+    auto coefficients = optimalPolynomial(3, 1);
+    QVERIFY(!coefficients.empty());
+    QVERIFY(optimalPolynomial(3, 4) == coefficients);
+    QVERIFY(optimalPolynomial(3, 1) == coefficients);
+
+    // the fitted polynomial should bring retention times closer
+    AlignmentStats* stats = polyAligner.optimalPolynomial(1, 5, 40, 3);
+    QVERIFY(stats->transformImproved());
+    delete stats;
+}
+
+void TestMzAligner::testFitDegrees()
+{
+    StatisticsVector<float> subj;
+    StatisticsVector<float> ref;
+    _driftingRts(subj, ref);
+    PolyAligner polyAligner(subj, ref);
+
+    // inliers of the initial fit, all points and a random subset
+    for (int pass = 0; pass < 3; pass++) {
+        if (pass == 1)
+            polyAligner.outlierVector.clear();
+        if (pass == 2)
+            polyAligner.randomOutliers(0.35);
+
+        auto fitted = polyAligner._fitDegrees(polyAligner.outlierVector, 1, 6);
+        QVERIFY(fitted.size() == 5);
+        for (int deg = 1; deg < 6; deg++) {
+            AlignmentStats* expected = polyAligner.align(deg);
+            AlignmentStats* stats = fitted[deg - 1];
+            QVERIFY(stats->N == expected->N);
+            QVERIFY(stats->poly_align_degree == expected->poly_align_degree);
+            QVERIFY(stats->transformedFailed == expected->transformedFailed);
+            QVERIFY(abs(stats->R_after - expected->R_after)
+                    <= 1e-6 * expected->R_after);
+
+            auto coefficients = stats->getCoeffients();
+            auto expectedCoefficients = expected->getCoeffients();
+            QVERIFY(coefficients.size() == expectedCoefficients.size());
+            for (size_t k = 0; k < coefficients.size(); k++) {
+                QVERIFY(abs(coefficients[k] - expectedCoefficients[k])
+                        <= 1e-6 * abs(expectedCoefficients[k]) + 1e-12);
+            }
+            delete expected;
+            delete stats;
+        }
+    }
+}
+
+void TestMzAligner::benchmarkOptimalPolynomial()
+{
+    if (!TestUtils::benchmarksEnabled())
+        QSKIP("Set MAVEN_BENCHMARKS to run benchmarks");
+
+    StatisticsVector<float> subj;
+    StatisticsVector<float> ref;
+    _driftingRts(subj, ref);
+    PolyAligner polyAligner(subj, ref);
+    int degree = 0;
+    QBENCHMARK {
+        AlignmentStats* stats = polyAligner.optimalPolynomial(1, 5, 10);
+        degree = stats->poly_align_degree;
+        delete stats;
+    }
+    QVERIFY(degree >= 1 && degree < 5);
+}
@@ -34,6 +34,19 @@ class TestMzAligner : public QObject {
          */
         void testObiWarp();
 
+        /**
+         * @brief Tests that the polynomial found for the same points and
+         * seed is identical, regardless of the number of threads used.
+         */
+        void testOptimalPolynomialSeed();
+
+        /**
+         * @brief Tests that polynomials fitted from shared normal-equation
+         * sums match the ones fitted by `PolyAligner::align`.
+         */
+        void testFitDegrees();
+        void benchmarkOptimalPolynomial();
+
 };
 
 #endif // TESTMZALIGNER_H
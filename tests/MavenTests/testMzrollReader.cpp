@@ -0,0 +1,165 @@
+#include <fstream>
+
+#include "testMzrollReader.h"
+#include "Compound.h"
+#include "mavenparameters.h"
+#include "mzrollreader.h"
+#include "mzSample.h"
+#include "PeakGroup.h"
+#include "utilities.h"
+
+TestMzrollReader::TestMzrollReader() {
+    numGroups = 300;
+}
+
+void TestMzrollReader::initTestCase() {
+    // a small mzroll file is written with groups that refer to compounds by
+    // name or by ID, some of which have isotope children
+    mzrollPath = QDir::tempPath().toStdString() + "/groups.mzroll";
+
+    vector<string> sampleNames = {"sample0", "sample1", "sample2", "run#3"};
+    for (size_t s = 0; s < sampleNames.size(); ++s) {
+        auto sample = new mzSample();
+        sample->sampleName = sampleNames[s];
+        sample->setSampleId(s + 1);
+        samples.push_back(sample);
+    }
+    for (int c = 0; c < 20; ++c) {
+        db.addCompound(new Compound("id" + to_string(c),
+                                    "compound" + to_string(c),
+                                    "",
+                                    0,
+                                    -1,
+                                    100.0f + c,
+                                    "test_db"));
+    }
+
+    auto writePeaks = [&](ofstream& out, int seed) {
+        for (auto& peak : TestUtils::syntheticPeaks(samples, seed)) {
+            out << "<Peak pos=\"" << peak.pos << "\""
+                << " rt=\"" << peak.rt << "\""
+                << " rtmin=\"" << peak.rtmin << "\""
+                << " rtmax=\"" << peak.rtmax << "\""
+                << " mzmin=\"" << peak.mzmin << "\""
+                << " mzmax=\"" << peak.mzmax << "\""
+                << " peakIntensity=\"" << peak.peakIntensity << "\""
+                << " peakAreaTop=\"" << peak.peakAreaTop << "\""
+                << " peakMz=\"" << peak.peakMz << "\""
+                << " baseMz=\"" << peak.baseMz << "\""
+                << " quality=\"" << peak.quality << "\""
+                << " sample=\"" << peak.getSample()->sampleName << "\"/>\n";
+        }
+    };
+    auto writeSamplesUsed = [&](ofstream& out, int seed) {
+        out << "<SamplesUsed";
+        for (size_t s = 0; s < samples.size(); ++s) {
+            QString name = QString::fromStdString(samples[s]->sampleName);
+            MzrollReader::cleanString(name);
+            out << " " << name.toStdString() << "=\""
+                << ((seed + s) % 3 == 0 ? "NotUsed" : "Used") << "\"";
+        }
+        out << "/>\n";
+    };
+
+    ofstream out(mzrollPath);
+    out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        << "<project>\n"
+        << "<!-- <PeakGroup groupId=\"0\"> is not a group -->\n"
+        << "<PeakGroups>\n";
+    for (int g = 0; g < numGroups; ++g) {
+        int label = g % 2 == 0 ? 'g' : 'b';
+        out << "<PeakGroup groupId=\"" << g + 1 << "\""
+            << " clusterId=\"" << g / 7 << "\""
+            << " label=\"" << label << "\""
+            << " type=\"0\"";
+        string compound = to_string(g % 20);
+        if (g % 4 == 0) {
+            out << " compoundName=\"compound" << compound << "\""
+                << " compoundDB=\"test_db\"";
+        } else if (g % 4 == 1) {
+            out << " compoundId=\"id" << compound << "\""
+                << " compoundDB=\"test_db\"";
+        } else if (g % 4 == 2) {
+            out << " compoundId=\"unknown" << compound << "\"";
+        }
+        out << ">\n";
+        writeSamplesUsed(out, g);
+        writePeaks(out, g);
+        if (g % 3 > 0) {
+            out << "<children>\n";
+            for (int c = 0; c < g % 3; ++c) {
+                out << "<PeakGroup groupId=\"" << g + 1 << "\""
+                    << " tagString=\"C13-label-" << c + 1 << "\""
+                    << " expectedMz=\"" << 101.0f + g % 20 + c << "\""
+                    << " type=\"2\">\n";
+                writeSamplesUsed(out, g + c + 1);
+                writePeaks(out, g + c + 1);
+                out << "</PeakGroup>\n";
+            }
+            out << "</children>\n";
+        }
+        out << "</PeakGroup>\n";
+    }
+    out << "</PeakGroups>\n"
+        << "</project>\n";
+}
+
+void TestMzrollReader::cleanupTestCase() {
+    remove(mzrollPath.c_str());
+    for (auto sample : samples)
+        delete sample;
+}
+
+void TestMzrollReader::init() {
+    // This function is executed before each test
+}
+
+void TestMzrollReader::cleanup() {
+    // This function is executed after each test
+}
+
+void TestMzrollReader::testReadGroups() {
+    MavenParameters mp;
+    MzrollReader reader(samples, &mp, db);
+    auto groups = reader.readGroups(QString::fromStdString(mzrollPath));
+    QVERIFY(!reader.isV015());
+
+    // the whole file read at once, as a single fragment, gives the groups
+    // that mzroll files used to be read into sequentially
+    QFile file(QString::fromStdString(mzrollPath));
+    QVERIFY(file.open(QFile::ReadOnly));
+    auto sequential = reader._readGroupFragmentXML(file.readAll(), 0);
+
+    QVERIFY(groups.size() == static_cast<size_t>(numGroups));
+    QVERIFY(sequential.size() == groups.size());
+    for (int g = 0; g < numGroups; ++g) {
+        auto group = groups[g];
+        auto expected = sequential[g];
+        QVERIFY(group->groupId() == g + 1);
+        QVERIFY(group->clusterId == expected->clusterId);
+        QVERIFY(group->label == expected->label);
+        QVERIFY(group->getCompound() == expected->getCompound());
+        QVERIFY(group->tagString == expected->tagString);
+        if (g % 4 < 2) {
+            QVERIFY(group->getCompound() != nullptr);
+            QVERIFY(group->getCompound()->id() == "id" + to_string(g % 20));
+        } else if (g % 4 == 2) {
+            QVERIFY(group->tagString == "unknown" + to_string(g % 20));
+        }
+        QVERIFY(group->childIsotopes().size() == static_cast<size_t>(g % 3));
+        QVERIFY(group->meanMz == expected->meanMz);
+        QVERIFY(group->meanRt == expected->meanRt);
+        QVERIFY(TestUtils::compareGroups(expected, group));
+        for (auto& peak : group->peaks)
+            QVERIFY(peak.getSample() != nullptr);
+        for (auto child : group->childIsotopes()) {
+            QVERIFY(child->isIsotope());
+            QVERIFY(child->tagString.find("C13-label-") == 0);
+        }
+    }
+
+    for (auto group : groups)
+        delete group;
+    for (auto group : sequential)
+        delete group;
+}
@@ -0,0 +1,37 @@
+#ifndef TESTMZROLLREADER_H
+#define TESTMZROLLREADER_H
+#include <iostream>
+#include <QtTest>
+#include <string>
+#include <sstream>
+
+#include "database.h"
+
+class mzSample;
+
+class TestMzrollReader : public QObject {
+    Q_OBJECT
+
+    public:
+        TestMzrollReader();
+    private:
+        std::string mzrollPath;
+        std::vector<mzSample*> samples;
+        Database db;
+        int numGroups;
+
+    private Q_SLOTS:
+        // functions executed by QtTest before and after test suite
+        void initTestCase();
+        void cleanupTestCase();
+
+        // functions executed by QtTest before and after each test
+        void init();
+        void cleanup();
+
+        // test functions - all functions prefixed with "test" will be ran as tests
+        // this is automatically detected thanks to Qt's meta-information about QObjects
+        void testReadGroups();
+};
+
+#endif // TESTMZROLLREADER_H
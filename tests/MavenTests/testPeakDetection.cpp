@@ -8,6 +8,12 @@
 #include "peakdetector.h"
 #include "mavenparameters.h"
 #include "classifierNeuralNet.h"
+#include "constants.h"
+#include "Compound.h"
+#include "datastructures/adduct.h"
+#include "datastructures/isotope.h"
+#include "mzMassCalculator.h"
+#include "groupClustering.h"
 
 TestPeakDetection::TestPeakDetection() {
     loadCompoundDB = "bin/methods/qe3_v11_2016_04_29.csv";
@@ -96,3 +102,458 @@ void TestPeakDetection::testprocessSlices() {
     QVERIFY(allgroups.size() > 0);
 
 }
+
+// creates a group for the given compound, with an adduct and isotope tag
+static PeakGroup makeTaggedGroup(shared_ptr<MavenParameters> mp,
+                                 Compound* compound,
+                                 Adduct* adduct,
+                                 Isotope isotope,
+                                 float rt)
+{
+    PeakGroup group(mp, PeakGroup::IntegrationType::Automated);
+    mzSlice slice;
+    slice.compound = compound;
+    slice.adduct = adduct;
+    slice.isotope = isotope;
+    group.setSlice(slice);
+    group.meanRt = rt;
+    return group;
+}
+
+// fills `mp->allgroups` with two parents, one isotopologue and one adduct per
+// compound, with the children eluting close to the second parent
+static void makeMetaGroupingInput(MavenParameters* mp,
+                                  vector<Compound*>& compounds,
+                                  Adduct* sodiumAdduct)
+{
+    auto sharedParameters = make_shared<MavenParameters>(*mp);
+    Isotope parentIsotope(C12_PARENT_LABEL, 100.0);
+    Isotope c13Isotope("C13-label-1", 101.0, 1);
+    mp->allgroups.clear();
+    mp->allgroups.reserve(compounds.size() * 4);
+    for (size_t i = 0; i < compounds.size(); ++i) {
+        float rt = static_cast<float>(i % 20);
+        mp->allgroups.push_back(makeTaggedGroup(sharedParameters,
+                                                compounds[i],
+                                                MassCalculator::PlusHAdduct,
+                                                parentIsotope,
+                                                rt));
+        mp->allgroups.push_back(makeTaggedGroup(sharedParameters,
+                                                compounds[i],
+                                                MassCalculator::PlusHAdduct,
+                                                parentIsotope,
+                                                rt + 5.0f));
+        mp->allgroups.push_back(makeTaggedGroup(sharedParameters,
+                                                compounds[i],
+                                                MassCalculator::PlusHAdduct,
+                                                c13Isotope,
+                                                rt + 4.9f));
+        mp->allgroups.push_back(makeTaggedGroup(sharedParameters,
+                                                compounds[i],
+                                                sodiumAdduct,
+                                                parentIsotope,
+                                                rt + 5.1f));
+    }
+}
+
+void TestPeakDetection::testPerformMetaGrouping() {
+    MavenParameters* mavenparameters = new MavenParameters();
+    mavenparameters->compoundMassCutoffWindow->setMassCutoffAndType(10, "ppm");
+    Adduct* sodiumAdduct = new Adduct("[M+Na]+", 1, 1, 22.989218f);
+    vector<Compound*> compounds;
+    for (int i = 0; i < 3; ++i) {
+        compounds.push_back(new Compound("id" + to_string(i),
+                                         "compound" + to_string(i),
+                                         "C6H12O6",
+                                         0));
+    }
+    makeMetaGroupingInput(mavenparameters, compounds, sodiumAdduct);
+
+    PeakDetector peakDetector;
+    peakDetector.setMavenParameters(mavenparameters);
+    peakDetector.performMetaGrouping(false);
+
+    // children are absorbed by the closest parent, parent order is kept
+    auto& allgroups = mavenparameters->allgroups;
+    QVERIFY(allgroups.size() == 6);
+    for (size_t i = 0; i < allgroups.size(); ++i) {
+        PeakGroup& group = allgroups[i];
+        QVERIFY(group.getCompound() == compounds[i / 2]);
+        QVERIFY(group.groupId() == static_cast<int>((i / 2) * 4 + i % 2 + 1));
+        if (i % 2 == 0) {
+            QVERIFY(group.childIsotopeCount() == 0);
+            QVERIFY(group.childAdductsCount() == 0);
+        } else {
+            QVERIFY(group.childIsotopeCount() == 1);
+            QVERIFY(group.childAdductsCount() == 1);
+            QVERIFY(group.childIsotopes()[0]->parent == &group);
+            QVERIFY(group.childIsotopes()[0]->metaGroupId() == group.groupId());
+            QVERIFY(group.childAdducts()[0]->parent == &group);
+        }
+    }
+
+    // only the best ranked parent is kept, orphans get a ghost parent
+    makeMetaGroupingInput(mavenparameters, compounds, sodiumAdduct);
+    for (size_t i = 0; i < allgroups.size(); ++i)
+        allgroups[i].groupRank = (i % 4 == 0) ? 0.0f : 1.0f;
+    mavenparameters->eicMaxGroups = 1;
+    compounds.push_back(new Compound("id3", "compound3", "C5H10O5", 0));
+    allgroups.push_back(makeTaggedGroup(
+        make_shared<MavenParameters>(*mavenparameters),
+        compounds.back(),
+        MassCalculator::PlusHAdduct,
+        Isotope("C13-label-1", 101.0, 1),
+        1.0f));
+    peakDetector.performMetaGrouping(true);
+    QVERIFY(allgroups.size() == 4);
+    for (size_t i = 0; i < 3; ++i) {
+        QVERIFY(!allgroups[i].isGhost());
+        QVERIFY(allgroups[i].childIsotopeCount() == 1);
+        QVERIFY(allgroups[i].childAdductsCount() == 1);
+    }
+    QVERIFY(allgroups[3].isGhost());
+    QVERIFY(allgroups[3].childIsotopeCount() == 1);
+
+    // an isotopologue without adduct is both a child and a parent; it is not
+    // its own parent and keeps its children when attached to its parent
+    auto sharedParameters = make_shared<MavenParameters>(*mavenparameters);
+    allgroups.clear();
+    allgroups.push_back(makeTaggedGroup(sharedParameters,
+                                        compounds[0],
+                                        MassCalculator::PlusHAdduct,
+                                        Isotope(C12_PARENT_LABEL, 100.0),
+                                        1.0f));
+    allgroups.push_back(makeTaggedGroup(sharedParameters,
+                                        compounds[0],
+                                        nullptr,
+                                        Isotope("C13-label-1", 101.0, 1),
+                                        5.0f));
+    allgroups.push_back(makeTaggedGroup(sharedParameters,
+                                        compounds[0],
+                                        sodiumAdduct,
+                                        Isotope(C12_PARENT_LABEL, 100.0),
+                                        5.1f));
+    allgroups.push_back(makeTaggedGroup(sharedParameters,
+                                        compounds[0],
+                                        MassCalculator::PlusHAdduct,
+                                        Isotope("C13-label-2", 102.0, 2),
+                                        4.9f));
+    peakDetector.performMetaGrouping(false);
+    QVERIFY(allgroups.size() == 1);
+    QVERIFY(allgroups[0].childIsotopeCount() == 1);
+    QVERIFY(allgroups[0].childAdductsCount() == 0);
+    auto child = allgroups[0].childIsotopes()[0];
+    QVERIFY(child->isotope().name == "C13-label-1");
+    QVERIFY(child->parent == &allgroups[0]);
+    QVERIFY(child->childIsotopeCount() == 1);
+    QVERIFY(child->childAdductsCount() == 1);
+    QVERIFY(child->childIsotopes()[0]->isotope().name == "C13-label-2");
+    QVERIFY(child->childIsotopes()[0]->parent == child.get());
+    QVERIFY(child->childAdducts()[0]->parent == child.get());
+
+    // two such groups that would be each other's parent: the first one stays
+    allgroups.clear();
+    allgroups.push_back(makeTaggedGroup(sharedParameters,
+                                        compounds[0],
+                                        nullptr,
+                                        Isotope("C13-label-1", 101.0, 1),
+                                        5.0f));
+    allgroups.push_back(makeTaggedGroup(sharedParameters,
+                                        compounds[0],
+                                        nullptr,
+                                        Isotope("C13-label-2", 102.0, 2),
+                                        5.05f));
+    peakDetector.performMetaGrouping(false);
+    QVERIFY(allgroups.size() == 1);
+    QVERIFY(allgroups[0].isotope().name == "C13-label-1");
+    QVERIFY(allgroups[0].childIsotopeCount() == 1);
+    QVERIFY(allgroups[0].childIsotopes()[0]->isotope().name == "C13-label-2");
+
+    delete_all(compounds);
+    delete sodiumAdduct;
+    delete mavenparameters;
+}
+
+void TestPeakDetection::benchmarkPerformMetaGrouping() {
+    if (!TestUtils::benchmarksEnabled())
+        QSKIP("Set MAVEN_BENCHMARKS to run benchmarks");
+
+    MavenParameters* mavenparameters = new MavenParameters();
+    mavenparameters->compoundMassCutoffWindow->setMassCutoffAndType(10, "ppm");
+    Adduct* sodiumAdduct = new Adduct("[M+Na]+", 1, 1, 22.989218f);
+    vector<Compound*> compounds;
+    for (int i = 0; i < 2500; ++i) {
+        compounds.push_back(new Compound("id" + to_string(i),
+                                         "compound" + to_string(i),
+                                         "C6H12O6",
+                                         0));
+    }
+
+    // 10k groups in total
+    PeakDetector peakDetector;
+    peakDetector.setMavenParameters(mavenparameters);
+    QBENCHMARK {
+        makeMetaGroupingInput(mavenparameters, compounds, sodiumAdduct);
+        peakDetector.performMetaGrouping(false);
+    }
+    QVERIFY(mavenparameters->allgroups.size() == 5000);
+
+    delete_all(compounds);
+    delete sodiumAdduct;
+    delete mavenparameters;
+}
+
+void TestPeakDetection::testCopyPeakGroup() {
+    vector<PeakGroup> allgroups = TestUtils::getGroupsFromProcessCompounds();
+    QVERIFY(allgroups.size() > 0);
+
+    PeakGroup& original = allgroups[0];
+    PeakGroup copy(original);
+    QVERIFY(copy.parameters() == original.parameters());
+    QVERIFY(copy.peakCount() == original.peakCount());
+    QVERIFY(copy.childIsotopeCount() == original.childIsotopeCount());
+    QVERIFY(copy.fragmentationPattern().mzValues
+            == original.fragmentationPattern().mzValues);
+
+    // modifying the parameters of a copy must not affect the original
+    bool linkIsotopeRtRange = original.parameters()->linkIsotopeRtRange;
+    copy.mutableParameters()->linkIsotopeRtRange = !linkIsotopeRtRange;
+    QVERIFY(copy.parameters() != original.parameters());
+    QVERIFY(original.parameters()->linkIsotopeRtRange == linkIsotopeRtRange);
+    QVERIFY(copy.parameters()->linkIsotopeRtRange != linkIsotopeRtRange);
+
+    // a group that is the sole owner of its parameters modifies them in place
+    auto parameters = copy.parameters().get();
+    QVERIFY(copy.mutableParameters() == parameters);
+
+    // moving hands over the payload instead of copying it
+    unsigned int peakCount = copy.peakCount();
+    PeakGroup moved(std::move(copy));
+    QVERIFY(moved.parameters().get() == parameters);
+    QVERIFY(moved.peakCount() == peakCount);
+    QVERIFY(copy.peakCount() == 0);
+}
+
+void TestPeakDetection::benchmarkCopyPeakGroup() {
+    if (!TestUtils::benchmarksEnabled())
+        QSKIP("Set MAVEN_BENCHMARKS to run benchmarks");
+
+    vector<PeakGroup> allgroups = TestUtils::getGroupsFromProcessCompounds();
+    QVERIFY(allgroups.size() > 0);
+
+    // clone detected groups over and over, as peak tables and projects do
+    vector<PeakGroup> copies;
+    QBENCHMARK {
+        copies.clear();
+        for (int i = 0; i < 100; ++i)
+            copies.insert(copies.end(), allgroups.begin(), allgroups.end());
+    }
+    QVERIFY(copies.size() == allgroups.size() * 100);
+}
+
+void TestPeakDetection::testBatchPeakScoring() {
+    vector<PeakGroup> allgroups = TestUtils::getGroupsFromProcessCompounds();
+    QVERIFY(allgroups.size() > 0);
+
+    ClassifierNeuralNet clsf;
+    clsf.loadModel("bin/default.model");
+    QVERIFY(clsf.hasModel());
+
+    vector<float> expected;
+    vector<PeakGroup*> groups;
+    for (auto& group : allgroups) {
+        for (auto& peak : group.peaks)
+            expected.push_back(clsf.scorePeak(peak));
+        groups.push_back(&group);
+    }
+    QVERIFY(expected.size() > 0);
+
+    // batch scores must be identical to those of the per-peak path
+    clsf.classify(groups);
+    size_t index = 0;
+    for (auto& group : allgroups) {
+        for (auto& peak : group.peaks)
+            QVERIFY(peak.quality == expected[index++]);
+    }
+}
+
+void TestPeakDetection::testDetectIsotopesForParents() {
+    vector<Compound*> compounds = TestUtils::getCompoudDataBaseWithRT();
+    vector<mzSample*> samples;
+    MavenParameters* mavenparameters = new MavenParameters();
+    TestUtils::loadSamplesAndParameters(samples, mavenparameters);
+
+    PeakDetector peakDetector;
+    peakDetector.setMavenParameters(mavenparameters);
+    peakDetector.processCompounds(compounds);
+
+    // every other parent is manually integrated, so that both the detected
+    // and the linked RT range paths are taken
+    vector<PeakGroup> parents;
+    for (auto& group : mavenparameters->allgroups) {
+        if (!group.hasCompoundLink()
+            || group.getCompound()->formula().empty()
+            || group.isIsotope()
+            || group.isAdduct()) {
+            continue;
+        }
+        auto type = parents.size() % 2 == 0
+                        ? PeakGroup::IntegrationType::Inherit
+                        : PeakGroup::IntegrationType::Manual;
+        parents.push_back(PeakGroup(group, type));
+    }
+    QVERIFY(parents.size() > 1);
+
+    mavenparameters->pullIsotopesFlag = true;
+    mavenparameters->C13Labeled_BPE = true;
+    mavenparameters->linkIsotopeRtRange = true;
+    vector<PeakGroup> singleParents = parents;
+    for (auto& parent : singleParents)
+        peakDetector.detectIsotopesForParent(parent);
+    vector<PeakGroup*> batchParents;
+    for (auto& parent : parents)
+        batchParents.push_back(&parent);
+    peakDetector.detectIsotopesForParents(batchParents);
+
+    // the batch call attaches the same isotopologues as single calls do
+    size_t numChildren = 0;
+    for (size_t i = 0; i < parents.size(); ++i) {
+        auto& children = parents[i].childIsotopes();
+        auto& expected = singleParents[i].childIsotopes();
+        QVERIFY(children.size() == expected.size());
+        for (size_t j = 0; j < children.size(); ++j) {
+            QVERIFY(children[j]->parent == &parents[i]);
+            QVERIFY(children[j]->getName() == expected[j]->getName());
+            QVERIFY(children[j]->peakCount() == expected[j]->peakCount());
+            QVERIFY(TestUtils::floatCompare(children[j]->meanMz,
+                                            expected[j]->meanMz));
+            QVERIFY(TestUtils::floatCompare(children[j]->meanRt,
+                                            expected[j]->meanRt));
+        }
+        numChildren += children.size();
+    }
+    QVERIFY(numChildren > 0);
+
+    delete_all(samples);
+    delete mavenparameters;
+}
+
+// clusters groups by comparing each visited group with every other unclustered
+// group, pulling fresh EICs through `mzSample::correlation`, as clustering was
+// done before it moved into `GroupClustering`
+static void clusterPairwise(vector<shared_ptr<PeakGroup>>& groups,
+                            vector<mzSample*> samples,
+                            MassCutoff* massCutoff,
+                            double maxRtDiff,
+                            double minSampleCorrelation,
+                            double minRtCorrelation)
+{
+    stable_sort(begin(groups),
+                end(groups),
+                [](shared_ptr<PeakGroup> a, shared_ptr<PeakGroup> b) {
+                    return a->meanRt < b->meanRt;
+                });
+    for (auto group : groups)
+        group->clusterId = 0;
+
+    int clusterId = 0;
+    map<int, shared_ptr<PeakGroup>> parentGroups;
+    for (auto group1 : groups) {
+        if (group1->clusterId == 0) {
+            group1->clusterId = ++clusterId;
+            parentGroups[clusterId] = group1;
+        }
+        auto parent = parentGroups[clusterId];
+
+        mzSample* largestSample = nullptr;
+        float maxIntensity = 0;
+        for (auto& peak : group1->peaks) {
+            if (peak.peakIntensity > maxIntensity) {
+                maxIntensity = peak.peakIntensity;
+                largestSample = peak.getSample();
+            }
+        }
+        if (largestSample == nullptr)
+            continue;
+
+        auto intensities1 = group1->getOrderedIntensityVector(samples,
+                                                              PeakGroup::AreaTop);
+        for (auto group2 : groups) {
+            if (group2->clusterId > 0)
+                continue;
+            if (abs(parent->meanRt - group2->meanRt) > maxRtDiff * 2)
+                continue;
+            if (mzUtils::checkOverlap(group1->minRt,
+                                      group1->maxRt,
+                                      group2->minRt,
+                                      group2->maxRt)
+                < 0.1) {
+                continue;
+            }
+            auto intensities2 =
+                group2->getOrderedIntensityVector(samples, PeakGroup::AreaTop);
+            if (mzUtils::correlation(intensities1, intensities2)
+                < minSampleCorrelation) {
+                continue;
+            }
+            float cor = largestSample->correlation(group1->meanMz,
+                                                   group2->meanMz,
+                                                   massCutoff,
+                                                   group1->minRt,
+                                                   group1->maxRt,
+                                                   EIC::MAX,
+                                                   "");
+            if (cor < minRtCorrelation)
+                continue;
+            group2->clusterId = group1->clusterId;
+        }
+    }
+}
+
+void TestPeakDetection::testClusterGroups() {
+    vector<PeakGroup> allgroups = TestUtils::getGroupsFromProcessCompounds();
+    QVERIFY(allgroups.size() > 0);
+
+    set<mzSample*> sampleSet;
+    vector<shared_ptr<PeakGroup>> groups;
+    for (auto& group : allgroups) {
+        for (auto& peak : group.peaks)
+            sampleSet.insert(peak.getSample());
+        groups.push_back(make_shared<PeakGroup>(group));
+    }
+    vector<mzSample*> samples(begin(sampleSet), end(sampleSet));
+
+    MassCutoff massCutoff;
+    massCutoff.setMassCutoffAndType(10, "ppm");
+    GroupClustering clustering(samples, massCutoff, EIC::MAX, "");
+    QVERIFY(clustering.cluster(groups, 0.5, 0.5, 0.5));
+
+    // the same clusters are found by comparing all pairs of groups
+    vector<shared_ptr<PeakGroup>> expected;
+    for (auto& group : allgroups)
+        expected.push_back(make_shared<PeakGroup>(group));
+    clusterPairwise(expected, samples, &massCutoff, 0.5, 0.5, 0.5);
+    QVERIFY(expected.size() == groups.size());
+    for (size_t i = 0; i < groups.size(); ++i) {
+        QVERIFY(groups[i]->meanMz == expected[i]->meanMz);
+        QVERIFY(groups[i]->clusterId == expected[i]->clusterId);
+    }
+
+    // groups are sorted by RT and clusters are numbered in order of their
+    // first member
+    int lastClusterId = 0;
+    for (size_t i = 0; i < groups.size(); ++i) {
+        if (i > 0)
+            QVERIFY(groups[i - 1]->meanRt <= groups[i]->meanRt);
+        QVERIFY(groups[i]->clusterId > 0);
+        QVERIFY(groups[i]->clusterId <= lastClusterId + 1);
+        lastClusterId = max(lastClusterId, groups[i]->clusterId);
+    }
+
+    // a cancel request sent before clustering starts is not lost
+    GroupClustering cancelled(samples, massCutoff, EIC::MAX, "");
+    cancelled.cancel();
+    QVERIFY(!cancelled.cluster(groups, 0.5, 0.5, 0.5));
+    for (auto group : groups)
+        QVERIFY(group->clusterId == 0);
+}
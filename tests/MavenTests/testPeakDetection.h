@@ -30,6 +30,13 @@ class TestPeakDetection : public QObject {
         void testProcessCompound();
         void testPullEICs();
         void testprocessSlices();
+        void testPerformMetaGrouping();
+        void benchmarkPerformMetaGrouping();
+        void testCopyPeakGroup();
+        void benchmarkCopyPeakGroup();
+        void testBatchPeakScoring();
+        void testDetectIsotopesForParents();
+        void testClusterGroups();
 };
 
 #endif // TESTPEAKDETECTION_H
@@ -0,0 +1,118 @@
+#include "testProjectDatabase.h"
+#include "utilities.h"
+#include "datastructures/isotope.h"
+#include "datastructures/mzSlice.h"
+#include "mavenparameters.h"
+#include "mzSample.h"
+#include "PeakGroup.h"
+#include "projectDB/projectdatabase.h"
+
+TestProjectDatabase::TestProjectDatabase() {
+
+}
+
+void TestProjectDatabase::initTestCase() {
+    // a project with a few thousand groups, some of which have isotope
+    // children, is saved once and loaded back by each test
+    projectPath = QDir::tempPath().toStdString() + "/groups.emDB";
+    remove(projectPath.c_str());
+
+    for (int s = 0; s < 8; ++s) {
+        auto sample = new mzSample();
+        sample->sampleName = "sample" + to_string(s);
+        sample->fileName = "/samples/sample" + to_string(s) + ".mzXML";
+        sample->setSampleId(s + 1);
+        samples.push_back(sample);
+    }
+
+    auto mp = make_shared<MavenParameters>();
+    auto addPeaks = [&](PeakGroup* group, int seed) {
+        for (auto& peak : TestUtils::syntheticPeaks(samples, seed))
+            group->addPeak(peak);
+    };
+    for (int g = 0; g < 2000; ++g) {
+        auto group = new PeakGroup(mp, PeakGroup::IntegrationType::Automated);
+        group->setGroupId(g + 1);
+        group->minQuality = 0.2;
+        group->samples = {samples[g % samples.size()]};
+        mzSlice slice(100.0f + g * 0.01f, 100.01f + g * 0.01f, 1.0f, 20.0f);
+        group->setSlice(slice);
+        addPeaks(group, g);
+        for (int c = 0; c < g % 3; ++c) {
+            PeakGroup child(mp, PeakGroup::IntegrationType::Automated);
+            child.setGroupId(g + 1);
+            mzSlice childSlice = slice;
+            childSlice.isotope = Isotope("C13-label-" + to_string(c + 1),
+                                         101 + c,
+                                         c + 1,
+                                         0,
+                                         0,
+                                         0);
+            child.setSlice(childSlice);
+            child.setType(PeakGroup::GroupType::Isotope);
+            addPeaks(&child, g + c + 1);
+            group->addIsotopeChild(child);
+        }
+        group->groupStatistics();
+        groups.push_back(group);
+    }
+
+    ProjectDatabase project(projectPath, "v0.12.0");
+    project.saveSamples(samples);
+    project.saveGroups(groups, "groups");
+}
+
+void TestProjectDatabase::cleanupTestCase() {
+    remove(projectPath.c_str());
+    for (auto group : groups)
+        delete group;
+    for (auto sample : samples)
+        delete sample;
+}
+
+void TestProjectDatabase::init() {
+    // This function is executed before each test
+}
+
+void TestProjectDatabase::cleanup() {
+    // This function is executed after each test
+}
+
+void TestProjectDatabase::testLoadGroups() {
+    ProjectDatabase project(projectPath, "v0.12.0");
+    MavenParameters mp;
+    auto loaded = project.loadGroups(samples, &mp);
+
+    // groups and their children are loaded in the order they were saved
+    QVERIFY(loaded.size() == groups.size());
+    for (size_t i = 0; i < groups.size(); ++i) {
+        auto group = groups[i];
+        auto loadedGroup = loaded[i];
+        QVERIFY(loadedGroup->groupId() == group->groupId());
+        QVERIFY(loadedGroup->tableName() == "groups");
+        QVERIFY(TestUtils::compareGroups(group, loadedGroup));
+        for (size_t c = 0; c < group->childIsotopes().size(); ++c) {
+            QVERIFY(loadedGroup->childIsotopes()[c]->isotope().name
+                    == group->childIsotopes()[c]->isotope().name);
+        }
+    }
+
+    for (auto group : loaded)
+        delete group;
+}
+
+void TestProjectDatabase::benchmarkLoadGroups() {
+    if (!TestUtils::benchmarksEnabled())
+        QSKIP("Set MAVEN_BENCHMARKS to run benchmarks");
+
+    ProjectDatabase project(projectPath, "v0.12.0");
+    MavenParameters mp;
+    size_t numLoaded = 0;
+    QBENCHMARK {
+        auto loaded = project.loadGroups(samples, &mp);
+        numLoaded = loaded.size();
+        for (auto group : loaded)
+            delete group;
+    }
+    QVERIFY(numLoaded == groups.size());
+}
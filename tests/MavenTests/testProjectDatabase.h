@@ -0,0 +1,36 @@
+#ifndef TESTPROJECTDATABASE_H
+#define TESTPROJECTDATABASE_H
+#include <iostream>
+#include <QtTest>
+#include <string>
+#include <sstream>
+
+class mzSample;
+class PeakGroup;
+
+class TestProjectDatabase : public QObject {
+    Q_OBJECT
+
+    public:
+        TestProjectDatabase();
+    private:
+        std::string projectPath;
+        std::vector<mzSample*> samples;
+        std::vector<PeakGroup*> groups;
+
+    private Q_SLOTS:
+        // functions executed by QtTest before and after test suite
+        void initTestCase();
+        void cleanupTestCase();
+
+        // functions executed by QtTest before and after each test
+        void init();
+        void cleanup();
+
+        // test functions - all functions prefixed with "test" will be ran as tests
+        // this is automatically detected thanks to Qt's meta-information about QObjects
+        void testLoadGroups();
+        void benchmarkLoadGroups();
+};
+
+#endif // TESTPROJECTDATABASE_H
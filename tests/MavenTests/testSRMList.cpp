@@ -1,4 +1,8 @@
 #include "testSRMList.h"
+#include "Compound.h"
+#include "datastructures/mzSlice.h"
+#include "mzSample.h"
+#include "Scan.h"
 #include "SRMList.h"
 #include "utilities.h"
 
@@ -52,3 +56,136 @@ void TestSRMList::testGetProductOfSrm() {
     QVERIFY(productMz2 == 140);
     QVERIFY(productMz3 == 435);
 }
+
+void TestSRMList::testGetSrmSlices() {
+    vector<mzSample*> samples = maventests::samples.ms2TestSamples;
+
+    // most intense scan of every filterline, the first one winning ties
+    map<string, Scan*> expectedScans;
+    for (auto sample : samples) {
+        for (auto scan : sample->scans) {
+            if (scan->totalIntensity() == 0 || scan->filterLine.empty())
+                continue;
+            auto seen = expectedScans.find(scan->filterLine);
+            if (seen == expectedScans.end()
+                || scan->intensity[0] > seen->second->intensity[0])
+                expectedScans[scan->filterLine] = scan;
+        }
+    }
+    QVERIFY(expectedScans.size() > 1);
+
+    // a library around the bundled transitions, with neighbours that only
+    // differ in their polarity, collision energy or m/z
+    deque<Compound*> compoundsDB;
+    int count = 0;
+    for (auto& entry : expectedScans) {
+        Scan* scan = entry.second;
+        float precursorMz = scan->precursorMz;
+        float productMz = scan->productMz;
+        for (float delta : {0.0f, 0.2f, -0.3f, 0.7f}) {
+            for (int charge : {0, 1, -1}) {
+                for (float ce : {0.0f, scan->collisionEnergy + 2.0f}) {
+                    string id = "compound" + to_string(count++);
+                    auto compound = new Compound(id, id, "", charge);
+                    compound->setPrecursorMz(precursorMz + delta);
+                    compound->setProductMz(productMz - delta / 2);
+                    compound->setCollisionEnergy(ce);
+                    compound->setExpectedRt(count % 5);
+                    compoundsDB.push_back(compound);
+                }
+            }
+        }
+    }
+
+    // nearest compound as found by comparing against every one of them
+    auto nearest = [&](float precursorMz,
+                       float productMz,
+                       float rt,
+                       int polarity,
+                       double amu,
+                       float collisionEnergy) {
+        Compound* best = nullptr;
+        float distMz = FLT_MAX;
+        float distRt = FLT_MAX;
+        for (auto compound : compoundsDB) {
+            if (compound->charge() != polarity && compound->charge() != 0)
+                continue;
+            if (collisionEnergy != 0.0f
+                && compound->collisionEnergy() != 0.0f
+                && abs(compound->collisionEnergy() - collisionEnergy) > 0.5)
+                continue;
+            float a = abs(compound->precursorMz() - precursorMz);
+            float b = abs(compound->productMz() - productMz);
+            if (a > amu || b > amu)
+                continue;
+            float dMz = sqrt(a * a + b * b);
+            float dRt = abs(compound->expectedRt() - rt);
+            if (dMz < distMz || (dMz == distMz && dRt < distRt)) {
+                best = compound;
+                distMz = dMz;
+                distRt = dRt;
+            }
+        }
+        return best;
+    };
+
+    for (double amu : {0.1, 0.5, 1.0}) {
+        for (int userPolarity : {0, 1, -1}) {
+            SRMList srmList(samples, compoundsDB);
+            vector<mzSlice*> slices = srmList.getSrmSlices(amu,
+                                                           amu,
+                                                           userPolarity,
+                                                           true);
+            QVERIFY(slices.size() == expectedScans.size());
+
+            auto slice = slices.begin();
+            for (auto& entry : expectedScans) {
+                Scan* scan = entry.second;
+                QVERIFY((*slice)->srmId == entry.first);
+
+                int polarity = userPolarity;
+                if (polarity == 0)
+                    polarity = scan->getPolarity();
+                if (polarity == 0)
+                    polarity = entry.first[0] == '+' ? 1 : -1;
+                float precursorMz = scan->precursorMz;
+                if (precursorMz == 0)
+                    precursorMz = SRMList::getPrecursorOfSrm(entry.first);
+                float productMz = scan->productMz;
+                if (productMz == 0)
+                    productMz = SRMList::getProductOfSrm(entry.first);
+
+                Compound* expected = nearest(precursorMz,
+                                             productMz,
+                                             scan->rt,
+                                             polarity,
+                                             amu,
+                                             scan->collisionEnergy);
+                QVERIFY(expected != nullptr);
+                QVERIFY((*slice)->compound == expected);
+
+                // compounds within tolerance of the filterline's transition
+                float srmPrecursorMz = SRMList::getPrecursorOfSrm(entry.first);
+                float srmProductMz = SRMList::getProductOfSrm(entry.first);
+                deque<Compound*> expectedMatches;
+                for (auto compound : compoundsDB) {
+                    if (compound->charge() != polarity
+                        && compound->charge() != 0)
+                        continue;
+                    if (abs(compound->precursorMz() - srmPrecursorMz) > amu
+                        || abs(compound->productMz() - srmProductMz) > amu)
+                        continue;
+                    expectedMatches.push_back(compound);
+                }
+                QVERIFY(srmList.getMatchedCompounds(entry.first,
+                                                    amu,
+                                                    amu,
+                                                    polarity)
+                        == expectedMatches);
+                ++slice;
+            }
+            delete_all(slices);
+        }
+    }
+    delete_all(compoundsDB);
+}
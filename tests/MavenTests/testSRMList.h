@@ -31,6 +31,11 @@ class TestSRMList : public QObject {
          */
         void testGetProductOfSrm();
 
+        /**
+         * @see SRMList
+         */
+        void testGetSrmSlices();
+
     private:
         string filterline1;
         string filterline2;
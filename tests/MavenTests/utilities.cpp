@@ -18,6 +18,11 @@ bool TestUtils::floatCompare(float a, float b)
     return fabs(a - b) < EPSILON;
 }
 
+bool TestUtils::benchmarksEnabled()
+{
+    return qEnvironmentVariableIsSet("MAVEN_BENCHMARKS");
+}
+
 float TestUtils::roundTo(float value, int numPlaces)
 {
     float factor = powf(10.0f, numPlaces);
@@ -47,6 +52,60 @@ bool TestUtils::compareMaps(const map<string, int>& l,
     return true;
 }
 
+vector<Peak> TestUtils::syntheticPeaks(const vector<mzSample*>& samples,
+                                       int seed)
+{
+    vector<Peak> peaks;
+    for (int p = 0; p < 1 + seed % 4; ++p) {
+        Peak peak;
+        peak.setSample(samples[(seed + p) % samples.size()]);
+        peak.pos = seed + p;
+        peak.rt = 1.0f + seed % 17 + 0.1f * p;
+        peak.rtmin = peak.rt - 0.2f;
+        peak.rtmax = peak.rt + 0.2f;
+        peak.baseMz = 100.0f + seed % 20 + 0.001f * p;
+        peak.peakMz = peak.baseMz;
+        peak.mzmin = peak.baseMz - 0.005f;
+        peak.mzmax = peak.baseMz + 0.005f;
+        peak.peakIntensity = 1000 * (1 + (seed + p) % 13);
+        peak.peakAreaTop = 800 * (1 + (seed + p) % 11);
+        peak.quality = 0.1f * (p + 1);
+        peaks.push_back(peak);
+    }
+    return peaks;
+}
+
+bool TestUtils::compareGroups(PeakGroup* expected, PeakGroup* group)
+{
+    if (group->samples != expected->samples
+        || group->peakCount() != expected->peakCount()
+        || group->childIsotopes().size() != expected->childIsotopes().size()) {
+        return false;
+    }
+
+    for (size_t p = 0; p < expected->peaks.size(); ++p) {
+        auto& peak = expected->peaks[p];
+        auto& other = group->peaks[p];
+        if (other.getSample() != peak.getSample()
+            || other.pos != peak.pos
+            || other.rt != peak.rt
+            || other.peakIntensity != peak.peakIntensity
+            || other.peakAreaTop != peak.peakAreaTop
+            || other.groupNum != peak.groupNum) {
+            return false;
+        }
+    }
+
+    for (size_t c = 0; c < expected->childIsotopes().size(); ++c) {
+        auto child = group->childIsotopes()[c].get();
+        if (child->parent != group
+            || !compareGroups(expected->childIsotopes()[c].get(), child)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 vector<Compound*> TestUtils::getCompoudDataBaseWithRT()
 {
     const char* loadCompoundDB = "bin/methods/qe3_v11_2016_04_29.csv";
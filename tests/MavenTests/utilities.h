@@ -7,6 +7,7 @@
 #include "database.h"
 #include "mzSample.h"
 
+class Peak;
 class PeakGroup;
 class MavenParameters;
 
@@ -67,9 +68,21 @@ class TestUtils {
 
     public:
         static bool floatCompare(float a, float b);
+
+        // benchmarks are slow, and only run if MAVEN_BENCHMARKS is set
+        static bool benchmarksEnabled();
         static float roundTo(float a, int numPlaces);
         static double roundTo(double a, int numPlaces);
         static bool compareMaps(const map<string,int> & l, const map<string,int> & k);
+
+        // peaks of a synthetic group, varying with the seed and spread over
+        // the given samples
+        static vector<Peak> syntheticPeaks(const vector<mzSample*>& samples,
+                                           int seed);
+
+        // whether two groups have the same samples and peaks, as do their
+        // isotope children in turn
+        static bool compareGroups(PeakGroup* expected, PeakGroup* group);
         static vector<Compound*> getCompoudDataBaseWithRT();
         static vector<Compound*> getCompoudDataBaseWithNORT();
         static vector<Compound*> getFaltyCompoudDataBase();
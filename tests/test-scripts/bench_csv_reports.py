@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+
+# coding: utf-8
+
+import argparse
+import filecmp
+import os.path as path
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+
+bin_path = path.abspath(path.join(path.dirname(__file__), '..', '..', 'bin'))
+peakdetector_path = path.join(bin_path, "peakdetector")
+samples_path = path.join(bin_path, "methods", "091215_120*.mzXML")
+settings_path = path.join(path.dirname(__file__), "settings.xml")
+
+csv_time_pattern = re.compile(r"Execution time \(Saving CSV\): ([0-9.eE+-]+)")
+
+
+def export_csv(binary_path, output_dir):
+    """
+    Run untargeted detection using the given "peakdetector" binary and return
+    the path of the CSV group report along with the time it took to be saved.
+    """
+    result = subprocess.run(" ".join([binary_path,
+                                      "-x", settings_path,
+                                      "-e", "1",
+                                      "-i", "1500000",
+                                      "-I", "1.0",
+                                      "-o", output_dir,
+                                      samples_path]),
+                            shell=True,
+                            check=True,
+                            stdout=subprocess.PIPE,
+                            universal_newlines=True)
+
+    report_path = path.join(output_dir, "compounds.csv")
+    if not path.isfile(report_path):
+        print("Error: CSV report was not found where expected.")
+        sys.exit(1)
+
+    match = csv_time_pattern.search(result.stdout)
+    if not match:
+        print("Error: time taken to save CSV was not reported.")
+        sys.exit(1)
+    return report_path, float(match.group(1))
+
+
+def benchmark(binary_path, repeats):
+    """
+    Export the CSV report `repeats` times and return the path of the last
+    report generated, along with the best time observed.
+    """
+    best_time = None
+    output_dir = tempfile.mkdtemp()
+    for _ in range(repeats):
+        report_path, time_taken = export_csv(binary_path, output_dir)
+        if best_time is None or time_taken < best_time:
+            best_time = time_taken
+    return report_path, best_time
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Benchmark CSV group report export of peakdetector, "
+                    "optionally comparing it against a reference build.")
+    parser.add_argument("-r", "--reference",
+                        help="path to a reference peakdetector binary, whose "
+                             "CSV report must be byte-identical")
+    parser.add_argument("-n", "--repeats",
+                        type=int,
+                        default=3,
+                        help="number of exports per binary (default: 3)")
+    args = parser.parse_args()
+
+    print("=== Benchmarking CSV group report export ===")
+    report_path, best_time = benchmark(peakdetector_path, args.repeats)
+    print("peakdetector: {:.3f} seconds".format(best_time))
+
+    if args.reference:
+        ref_report_path, ref_best_time = benchmark(args.reference,
+                                                   args.repeats)
+        print("reference: {:.3f} seconds".format(ref_best_time))
+        if ref_best_time > 0 and best_time > 0:
+            print("speedup: {:.2f}x".format(ref_best_time / best_time))
+
+        same = filecmp.cmp(report_path, ref_report_path, shallow=False)
+        shutil.rmtree(path.dirname(ref_report_path))
+        if not same:
+            shutil.rmtree(path.dirname(report_path))
+            print("Error: CSV reports are not byte-identical.")
+            sys.exit(1)
+        print("CSV reports are byte-identical.")
+
+    shutil.rmtree(path.dirname(report_path))
+
+
+if __name__ == "__main__":
+    main()